@@ -0,0 +1,947 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+
+#ifndef K2TREES_ALGORITHMS_HPP
+#define K2TREES_ALGORITHMS_HPP
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Utility.hpp"
+
+/**
+ * Generic algorithms on K2Trees and RowTrees.
+ *
+ * The algorithms are templated on the tree type, which only has to provide the methods that are called on it.
+ * When instantiated with a concrete (final) tree type like BasicK2Tree<E>, all calls are resolved statically,
+ * so the compiler can inline them and fuse callbacks into the traversal loops.
+ * Instantiated with K2Tree<E> or RowTree<E>, they work on any implementation via the virtual interface
+ * (the corresponding member functions of K2Tree and RowTree are thin adaptors of this kind).
+ */
+
+
+/*
+ * Parallelisation
+ */
+
+// calls func(c) for all chunks c = 0, ..., numChunks - 1 using numThreads threads
+template<typename Func>
+void runChunks(size_type numChunks, unsigned numThreads, Func func) {
+
+    if (numThreads <= 1) {
+
+        for (size_type c = 0; c < numChunks; c++) {
+            func(c);
+        }
+
+        return;
+
+    }
+
+    std::atomic<size_type> nextChunk(0);
+    std::vector<std::thread> workers;
+
+    for (unsigned w = 0; w < numThreads; w++) {
+        workers.emplace_back([&]() {
+            for (size_type c = nextChunk++; c < numChunks; c = nextChunk++) {
+                func(c);
+            }
+        });
+    }
+
+    for (auto& w : workers) {
+        w.join();
+    }
+
+}
+
+
+/*
+ * Comparisons
+ */
+
+// compares two K2Trees (of possibly different types) by checking that all queries yield the same results
+template<typename TreeA, typename TreeB>
+bool compareK2Trees(const TreeA& a, const TreeB& b, bool silent) {
+
+    typedef typename TreeA::elem_type elem_type;
+
+
+    bool overallEqual = true;
+    bool equal;
+    unsigned long cnt;
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+        for (size_type j = 0; j < a.getNumCols(); j++) {
+            equal = equal && (a.isNotNull(i, j) == b.isNotNull(i, j));
+        }
+    }
+    if (!silent) std::cout << "isNotNull: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+        for (size_type j = 0; j < a.getNumCols(); j++) {
+            equal = equal && (a.getElement(i, j) == b.getElement(i, j));
+        }
+    }
+    if (!silent) std::cout << "getElement: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+
+        auto otherSuccs = b.getSuccessorElements(i);
+        auto treeSuccs = a.getSuccessorElements(i);
+
+        equal = equal && (otherSuccs.size() == treeSuccs.size());
+        if (equal) {
+            for (size_type k = 0; k < treeSuccs.size(); k++) {
+                equal = equal && (otherSuccs[k] == treeSuccs[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getSuccessorElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+
+        auto otherSuccs = b.getSuccessorPositions(i);
+        auto treeSuccs = a.getSuccessorPositions(i);
+
+        equal = equal && (otherSuccs.size() == treeSuccs.size());
+        if (equal) {
+            for (size_type k = 0; k < treeSuccs.size(); k++) {
+                equal = equal && (otherSuccs[k] == treeSuccs[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getSuccessorPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+
+        auto otherSuccs = b.getSuccessorValuedPositions(i);
+        auto treeSuccs = a.getSuccessorValuedPositions(i);
+
+        equal = equal && (otherSuccs.size() == treeSuccs.size());
+        if (equal) {
+            for (size_type k = 0; k < treeSuccs.size(); k++) {
+                equal = equal && (otherSuccs[k] == treeSuccs[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getSuccessorValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t j = 0; j < a.getNumCols(); j++) {
+
+        auto otherPreds = b.getPredecessorElements(j);
+        auto treePreds = a.getPredecessorElements(j);
+
+        equal = equal && (otherPreds.size() == treePreds.size());
+        if (equal) {
+            for (size_type k = 0; k < treePreds.size(); k++) {
+                equal = equal && (otherPreds[k] == treePreds[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getPredecessorElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t j = 0; j < a.getNumCols(); j++) {
+
+        auto otherPreds = b.getPredecessorPositions(j);
+        auto treePreds = a.getPredecessorPositions(j);
+
+        equal = equal && (otherPreds.size() == treePreds.size());
+        if (equal) {
+            for (size_type k = 0; k < treePreds.size(); k++) {
+                equal = equal && (otherPreds[k] == treePreds[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getPredecessorPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t j = 0; j < a.getNumCols(); j++) {
+
+        auto otherPreds = b.getPredecessorValuedPositions(j);
+        auto treePreds = a.getPredecessorValuedPositions(j);
+
+        equal = equal && (otherPreds.size() == treePreds.size());
+        if (equal) {
+            for (size_type k = 0; k < treePreds.size(); k++) {
+                equal = equal && (otherPreds[k] == treePreds[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getPredecessorValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    cnt = 0;
+    if (!silent) std::cout << "getElementsInRange: " << std::flush;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    cnt++;
+                    if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
+                        std::cout << "." << std::flush;
+                    }
+
+                    auto otherPairs = b.getElementsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end());
+                    auto treePairs = a.getElementsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end());
+
+                    equal = equal && (otherPairs.size() == treePairs.size());
+                    if (equal) {
+                        for (size_type k = 0; k < treePairs.size(); k++) {
+                            equal = equal && (otherPairs[k] == treePairs[k]);
+                        }
+                    }
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "\rgetElementsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+
+#if 1
+    equal = true;
+    cnt = 0;
+    if (!silent) std::cout << "getPositionsInRange: " << std::flush;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    cnt++;
+                    if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
+                        std::cout << "." << std::flush;
+                    }
+
+                    auto otherPairs = b.getPositionsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortPairs<size_type, size_type>());
+                    auto treePairs = a.getPositionsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortPairs<size_type, size_type>());
+
+                    equal = equal && (otherPairs.size() == treePairs.size());
+                    if (equal) {
+                        for (size_type k = 0; k < treePairs.size(); k++) {
+                            equal = equal && (otherPairs[k] == treePairs[k]);
+                        }
+                    }
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "\rgetPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+
+#if 1
+    equal = true;
+    cnt = 0;
+    if (!silent) std::cout << "getValuedPositionsInRange: " << std::flush;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    cnt++;
+                    if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
+                        std::cout << "." << std::flush;
+                    }
+
+                    auto otherPairs = b.getValuedPositionsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortValuedPositions<elem_type>());
+                    auto treePairs = a.getValuedPositionsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortValuedPositions<elem_type>());
+
+                    equal = equal && (otherPairs.size() == treePairs.size());
+                    if (equal) {
+                        for (size_type k = 0; k < treePairs.size(); k++) {
+                            equal = equal && (otherPairs[k] == treePairs[k]);
+                        }
+                    }
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "\rgetValuedPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto otherElems = b.getAllElements(); std::sort(otherElems.begin(), otherElems.end());
+        auto treeElems = a.getAllElements(); std::sort(treeElems.begin(), treeElems.end());
+
+        equal = equal && (otherElems.size() == treeElems.size());
+        if (equal) {
+            for (size_type k = 0; k < treeElems.size(); k++) {
+                equal = equal && (otherElems[k] == treeElems[k]);
+            }
+        }
+    }
+    if (!silent) std::cout << "getAllElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto otherElems = b.getAllPositions(); std::sort(otherElems.begin(), otherElems.end(), sortPairs<size_type, size_type>());
+        auto treeElems = a.getAllPositions(); std::sort(treeElems.begin(), treeElems.end(), sortPairs<size_type, size_type>());
+
+        equal = equal && (otherElems.size() == treeElems.size());
+        if (equal) {
+            for (size_type k = 0; k < treeElems.size(); k++) {
+                equal = equal && (otherElems[k] == treeElems[k]);
+            }
+        }
+    }
+    if (!silent) std::cout << "getAllPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto otherElems = b.getAllValuedPositions(); std::sort(otherElems.begin(), otherElems.end(), sortValuedPositions<elem_type>());
+        auto treeElems = a.getAllValuedPositions(); std::sort(treeElems.begin(), treeElems.end(), sortValuedPositions<elem_type>());
+
+        equal = equal && (otherElems.size() == treeElems.size());
+        if (equal) {
+            for (size_type k = 0; k < treeElems.size(); k++) {
+                equal = equal && (otherElems[k] == treeElems[k]);
+            }
+        }
+    }
+    if (!silent) std::cout << "getAllValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    bool otherFlag = b.containsElement(i1, i2, j1, j2);
+                    bool treeFlag = a.containsElement(i1, i2, j1, j2);
+
+                    equal = equal && (otherFlag == treeFlag);
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "containsElement: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        size_type otherCnt = b.countElements();
+        size_type treeCnt = a.countElements();
+
+        equal = (otherCnt == treeCnt);
+    }
+    if (!silent) std::cout << "countElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getNumRows(); i++) {
+        for (size_type j = 0; j < a.getNumCols(); j++) {
+            equal = equal && (a.areRelated(i, j) == b.areRelated(i, j));
+        }
+    }
+    if (!silent) std::cout << "areRelated: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t i = 0; i < a.getNumRows(); i++) {
+
+        auto otherSuccs = b.getSuccessors(i);
+        auto treeSuccs = a.getSuccessors(i);
+
+        equal = equal && (otherSuccs.size() == treeSuccs.size());
+        if (equal) {
+            for (size_type k = 0; k < treeSuccs.size(); k++) {
+                equal = equal && (otherSuccs[k] == treeSuccs[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getSuccessors: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t j = 0; j < a.getNumCols(); j++) {
+
+        auto otherPreds = b.getPredecessors(j);
+        auto treePreds = a.getPredecessors(j);
+
+        equal = equal && (otherPreds.size() == treePreds.size());
+        if (equal) {
+            for (size_type k = 0; k < treePreds.size(); k++) {
+                equal = equal && (otherPreds[k] == treePreds[k]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getPredecessors: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    cnt = 0;
+    if (!silent) std::cout << "getRange: " << std::flush;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    cnt++;
+                    if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
+                        std::cout << "." << std::flush;
+                    }
+
+                    auto otherPairs = b.getRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortPairs<size_type, size_type>());
+                    auto treePairs = a.getRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortPairs<size_type, size_type>());
+
+                    equal = equal && (otherPairs.size() == treePairs.size());
+                    if (equal) {
+                        for (size_type k = 0; k < treePairs.size(); k++) {
+                            equal = equal && (otherPairs[k] == treePairs[k]);
+                        }
+                    }
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "\rgetRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t i1 = 0; i1 < a.getNumRows(); i1++) {
+        for (size_t i2 = i1; i2 < a.getNumRows(); i2++) {
+            for (size_t j1 = 0; j1 < a.getNumCols(); j1++) {
+                for (size_t j2 = j1; j2 < a.getNumCols(); j2++) {
+
+                    bool otherFlag = b.containsLink(i1, i2, j1, j2);
+                    bool treeFlag = a.containsLink(i1, i2, j1, j2);
+
+                    equal = equal && (otherFlag == treeFlag);
+
+                }
+            }
+        }
+    }
+    if (!silent) std::cout << "containsLink: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        size_type otherCnt = b.countLinks();
+        size_type treeCnt = a.countLinks();
+
+        equal = (otherCnt == treeCnt);
+    }
+    if (!silent) std::cout << "countLinks: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+    return overallEqual;
+
+}
+
+// compares two RowTrees (of possibly different types) by checking that all queries yield the same results
+template<typename TreeA, typename TreeB>
+bool compareRowTrees(const TreeA& a, const TreeB& b, bool silent) {
+
+    typedef typename TreeA::elem_type elem_type;
+
+
+    bool overallEqual = true;
+    bool equal;
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getLength(); i++) {
+        equal = equal && (a.isNotNull(i) == b.isNotNull(i));
+    }
+    if (!silent) std::cout << "isNotNull: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_type i = 0; i < a.getLength(); i++) {
+        equal = equal && (a.getElement(i) == b.getElement(i));
+    }
+    if (!silent) std::cout << "getElement: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t l = 0; l < a.getLength(); l++) {
+        for (size_t r = l; r < a.getLength(); r++) {
+
+            auto elems = a.getElementsInRange(l, r); std::sort(elems.begin(), elems.end());
+            auto otherElems = b.getElementsInRange(l, r); std::sort(otherElems.begin(), otherElems.end());
+
+            equal = equal && (elems.size() == otherElems.size());
+            if (equal) {
+                for (size_type i = 0; i < elems.size(); i++) {
+                    equal = equal && (elems[i] == otherElems[i]);
+                }
+            }
+
+        }
+    }
+    if (!silent) std::cout << "getElementsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t l = 0; l < a.getLength(); l++) {
+        for (size_t r = l; r < a.getLength(); r++) {
+
+            auto positions = a.getPositionsInRange(l, r); std::sort(positions.begin(), positions.end());
+            auto otherPositions = b.getPositionsInRange(l, r); std::sort(otherPositions.begin(), otherPositions.end());
+
+            equal = equal && (positions.size() == otherPositions.size());
+            if (equal) {
+                for (size_type i = 0; i < positions.size(); i++) {
+                    equal = equal && (positions[i] == otherPositions[i]);
+                }
+            }
+
+        }
+    }
+    if (!silent) std::cout << "getPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t l = 0; l < a.getLength(); l++) {
+        for (size_t r = l; r < a.getLength(); r++) {
+
+            auto positions = a.getValuedPositionsInRange(l, r); std::sort(positions.begin(), positions.end(), sortPairs<size_type, elem_type>());
+            auto otherPositions = b.getValuedPositionsInRange(l, r); std::sort(otherPositions.begin(), otherPositions.end(), sortPairs<size_type, elem_type>());
+
+            equal = equal && (positions.size() == otherPositions.size());
+            if (equal) {
+                for (size_type i = 0; i < positions.size(); i++) {
+                    equal = equal && (positions[i] == otherPositions[i]);
+                }
+            }
+
+        }
+    }
+    if (!silent) std::cout << "getValuedPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto elems = a.getAllElements(); std::sort(elems.begin(), elems.end());
+        auto otherElems = b.getAllElements(); std::sort(otherElems.begin(), otherElems.end());
+
+        equal = equal && (elems.size() == otherElems.size());
+        if (equal) {
+            for (size_type i = 0; i < elems.size(); i++) {
+                equal = equal && (elems[i] == otherElems[i]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getAllElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto positions = a.getAllPositions(); std::sort(positions.begin(), positions.end());
+        auto otherPositions = b.getAllPositions(); std::sort(otherPositions.begin(), otherPositions.end());
+
+        equal = equal && (positions.size() == otherPositions.size());
+        if (equal) {
+            for (size_type i = 0; i < positions.size(); i++) {
+                equal = equal && (positions[i] == otherPositions[i]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getAllPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        auto positions = a.getAllValuedPositions(); std::sort(positions.begin(), positions.end(), sortPairs<size_type, elem_type>());
+        auto otherPositions = b.getAllValuedPositions(); std::sort(otherPositions.begin(), otherPositions.end(), sortPairs<size_type, elem_type>());
+
+        equal = equal && (positions.size() == otherPositions.size());
+        if (equal) {
+            for (size_type i = 0; i < positions.size(); i++) {
+                equal = equal && (positions[i] == otherPositions[i]);
+            }
+        }
+
+    }
+    if (!silent) std::cout << "getAllValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    for (size_t l = 0; l < a.getLength(); l++) {
+        for (size_t r = l; r < a.getLength(); r++) {
+
+            bool flag = a.containsElement(l, r);
+            bool otherFlag = b.containsElement(l, r);
+
+            equal = equal && (flag == otherFlag);
+
+        }
+    }
+    if (!silent) std::cout << "containsElement: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+#if 1
+    equal = true;
+    {
+        size_type cnt = a.countElements();
+        size_type otherCnt = b.countElements();
+        equal = (cnt == otherCnt);
+    }
+    if (!silent) std::cout << "countElements: " << (equal ? "OK" : "NOT OK") << std::endl;
+    overallEqual = overallEqual && equal;
+#endif
+
+    return overallEqual;
+
+}
+
+
+/*
+ * Traversal
+ */
+
+// functor appending the column of every reported pair to a vector (cf. expandFrontier())
+struct AppendColumn {
+
+    std::vector<size_type>& cols;
+
+    AppendColumn(std::vector<size_type>& c) : cols(c) {
+        // nothing to do here
+    }
+
+    void operator()(size_type, size_type j) const {
+        cols.push_back(j);
+    }
+
+};
+
+// appends the column numbers of all pairs in the rows rows[first], ..., rows[last - 1] (sorted ascending) to succs
+// using the batched traversal getSuccessorPositionsBatch() of trees that provide one (selected via overload resolution) ...
+template<typename Tree>
+auto expandFrontier(const Tree& tree, const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs, QueryContext& ctx, int)
+        -> decltype(tree.getSuccessorPositionsBatch(rows, first, last, AppendColumn(succs)), void()) {
+    tree.getSuccessorPositionsBatch(rows, first, last, AppendColumn(succs));
+}
+
+// ... and row by row for all other trees
+template<typename Tree>
+void expandFrontier(const Tree& tree, const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs, QueryContext& ctx, long) {
+
+    for (size_type t = first; t < last; t++) {
+        tree.getSuccessorPositions(rows[t], succs, ctx);
+    }
+
+}
+
+// regards the relation of tree as the edges of a directed graph (cf. K2Tree::breadthFirstSearch()) and returns the BFS level
+// of every node, -1 (the largest size_type) for unreachable nodes; expand(rows, first, last, succs, ctx) has to append
+// the successors of rows[first], ..., rows[last - 1] to succs (rows is sorted ascending and only contains valid row numbers)
+template<typename Tree, typename Expand>
+std::vector<size_type> breadthFirstSearch(const Tree& tree, const std::vector<size_type>& sources, bool directionOptimizing, unsigned numThreads, Expand expand) {
+
+    size_type numRows = tree.getNumRows();
+    size_type numCols = tree.getNumCols();
+    size_type n = std::max(numRows, numCols);
+
+    std::vector<size_type> dist(n, size_type(-1));
+    std::vector<bool> visited(n, false);
+    std::vector<bool> inFrontier(n, false); // membership of the current frontier (only maintained on bottom-up levels)
+    std::vector<size_type> frontier;
+
+    for (auto s : sources) {
+        if ((s < n) && !visited[s]) {
+
+            visited[s] = true;
+            dist[s] = 0;
+            frontier.push_back(s);
+
+        }
+    }
+
+    size_type unvisited = n - frontier.size();
+    bool bottomUp = false;
+    numThreads = std::max(numThreads, 1u);
+
+    // every chunk has its own scratch memory for the queries
+    size_type numChunks = numThreads * 4;
+    std::vector<QueryContext> contexts(numChunks);
+
+    for (size_type level = 1; !frontier.empty(); level++) {
+
+        // heuristic of Beamer et al. with node counts instead of edge counts (alpha = 14, beta = 24)
+        if (directionOptimizing) {
+            bottomUp = bottomUp ? (frontier.size() * 24 >= n) : (frontier.size() * 14 > unvisited);
+        }
+
+        // every thread collects the newly found nodes of some chunks, visited is only read until all threads are done
+        std::vector<std::vector<size_type>> found(numChunks);
+
+        if (bottomUp) {
+
+            for (auto i : frontier) {
+                inFrontier[i] = true;
+            }
+
+            size_type chunkSize = (numCols + numChunks - 1) / numChunks;
+
+            // a node is found as soon as one of its parents is in the frontier, the rest of its column is skipped
+            runChunks(numChunks, numThreads, [&](size_type c) {
+
+                for (size_type j = c * chunkSize; j < std::min(numCols, (c + 1) * chunkSize); j++) {
+
+                    if (!visited[j] && (tree.getFirstPredecessorIn(j, inFrontier, contexts[c]) < numRows)) {
+                        found[c].push_back(j);
+                    }
+
+                }
+
+            });
+
+            for (auto i : frontier) {
+                inFrontier[i] = false;
+            }
+
+        } else {
+
+            // nodes beyond the last row have no successors
+            std::sort(frontier.begin(), frontier.end());
+            size_type len = std::lower_bound(frontier.begin(), frontier.end(), numRows) - frontier.begin();
+            size_type chunkSize = (len + numChunks - 1) / numChunks;
+
+            runChunks(numChunks, numThreads, [&](size_type c) {
+
+                size_type first = std::min(len, c * chunkSize);
+                size_type last = std::min(len, (c + 1) * chunkSize);
+
+                if (first < last) {
+
+                    expand(frontier, first, last, found[c], contexts[c]);
+                    found[c].erase(std::remove_if(found[c].begin(), found[c].end(), [&](size_type j) { return visited[j]; }), found[c].end());
+
+                }
+
+            });
+
+        }
+
+        frontier.clear();
+
+        for (auto& chunk : found) {
+            for (auto j : chunk) {
+                if (!visited[j]) {
+
+                    visited[j] = true;
+                    dist[j] = level;
+                    frontier.push_back(j);
+
+                }
+            }
+        }
+
+        unvisited -= frontier.size();
+
+    }
+
+    return dist;
+
+}
+
+// like breadthFirstSearch(tree, sources, directionOptimizing, numThreads, expand) with the successor queries
+// of the tree itself (batched if it provides getSuccessorPositionsBatch(), cf. expandFrontier())
+template<typename Tree>
+std::vector<size_type> breadthFirstSearch(const Tree& tree, const std::vector<size_type>& sources, bool directionOptimizing = false, unsigned numThreads = 1) {
+
+    auto expand = [&tree](const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs, QueryContext& ctx) {
+        expandFrontier(tree, rows, first, last, succs, ctx, 0);
+    };
+
+    return breadthFirstSearch(tree, sources, directionOptimizing, numThreads, expand);
+
+}
+
+
+
+/*
+ * Set operations on RowTrees (based on the successor searches nextGEQ())
+ */
+
+// returns the (sorted) positions of all elements that are contained in every one of the given RowTrees;
+// the RowTrees are asked in turn for their next element >= the current candidate until all of them agree on it,
+// so elements that are missing in one of the RowTrees are skipped without enumerating them
+template<typename Tree>
+std::vector<size_type> intersect(const std::vector<Tree*>& trees) {
+
+    std::vector<size_type> res;
+    std::vector<RowTreeCursor> cursors(trees.size());
+
+    size_type x = 0; // current candidate
+    size_type cnt = 0; // number of RowTrees that have confirmed x
+
+    for (size_type t = 0; !trees.empty(); t = (t + 1) % trees.size()) {
+
+        auto y = trees[t]->nextGEQ(x, cursors[t]);
+        if (y == size_type(-1)) break;
+
+        if (y == x) {
+            cnt++;
+        } else {
+
+            x = y;
+            cnt = 1;
+
+        }
+
+        if (cnt == trees.size()) {
+
+            res.push_back(x);
+            x++;
+            cnt = 0;
+
+        }
+
+    }
+
+    return res;
+
+}
+
+// returns the (sorted) positions of all elements that are contained in at least one of the given RowTrees;
+// merges the RowTrees by repeatedly taking the smallest of their next elements
+template<typename Tree>
+std::vector<size_type> unite(const std::vector<Tree*>& trees) {
+
+    std::vector<size_type> res;
+    std::vector<RowTreeCursor> cursors(trees.size());
+
+    // next element of every RowTree
+    std::vector<size_type> next(trees.size());
+    for (size_type t = 0; t < trees.size(); t++) {
+        next[t] = trees[t]->nextGEQ(0, cursors[t]);
+    }
+
+    while (!trees.empty()) {
+
+        auto x = *std::min_element(next.begin(), next.end());
+        if (x == size_type(-1)) break;
+
+        res.push_back(x);
+
+        for (size_type t = 0; t < trees.size(); t++) {
+            if (next[t] == x) {
+                next[t] = trees[t]->nextGEQ(x + 1, cursors[t]);
+            }
+        }
+
+    }
+
+    return res;
+
+}
+
+#endif //K2TREES_ALGORITHMS_HPP
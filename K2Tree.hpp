@@ -22,6 +22,7 @@
 #ifndef K2TREES_K2TREE_HPP
 #define K2TREES_K2TREE_HPP
 
+#include "Algorithms.hpp"
 #include "Utility.hpp"
 
 /**
@@ -33,6 +34,12 @@
  * and one value is designated the null element ("unrelated").
  *
  * The data structure is static (with the exception of the setNull() method).
+ * All other methods are const and leave the internal state untouched (any scratch memory is local
+ * to the call), so const methods may be called concurrently on the same object by any number of threads.
+ * setNull() must not run concurrently with any other method.
+ *
+ * All implementations are final, so calls on a concrete type are resolved statically
+ * (cf. the generic algorithms in Algorithms.hpp, which are templated on the tree type).
  *
  * Adapted from:
  * Brisaboa, N. R., Ladra, S., & Navarro, G. (2014).
@@ -62,72 +69,72 @@ public:
     virtual ~K2Tree() { }
 
     // returns the number of rows of the relation (n)
-    virtual size_type getNumRows() = 0;
+    virtual size_type getNumRows() const = 0;
 
     // returns the number of columns of the relation (m)
-    virtual size_type getNumCols() = 0;
+    virtual size_type getNumCols() const = 0;
 
     // returns the null element of the relation
-    virtual elem_type getNull() = 0;
+    virtual elem_type getNull() const = 0;
 
 
     // checks whether (i,j) is in R
-    virtual bool isNotNull(size_type i, size_type j) = 0;
+    virtual bool isNotNull(size_type i, size_type j) const = 0;
 
     // returns the value of (i,j), if the pair is in R, null otherwise
-    virtual elem_type getElement(size_type i, size_type j) = 0;
+    virtual elem_type getElement(size_type i, size_type j) const = 0;
 
     // returns the values of all pairs in R whose first component is i
-    virtual std::vector<elem_type> getSuccessorElements(size_type i) = 0;
+    virtual std::vector<elem_type> getSuccessorElements(size_type i) const = 0;
 
     // returns the column numbers of all pairs in R whose first component is i
-    virtual std::vector<size_type> getSuccessorPositions(size_type i) = 0;
+    virtual std::vector<size_type> getSuccessorPositions(size_type i) const = 0;
 
     // returns all valued pairs in R whose first component is i
-    virtual pairs_type getSuccessorValuedPositions(size_type i) = 0;
+    virtual pairs_type getSuccessorValuedPositions(size_type i) const = 0;
 
     // returns the values of all pairs in R whose second component is j
-    virtual std::vector<elem_type> getPredecessorElements(size_type j) = 0;
+    virtual std::vector<elem_type> getPredecessorElements(size_type j) const = 0;
 
     // returns the row numbers of all pairs in R whose second component is j
-    virtual std::vector<size_type> getPredecessorPositions(size_type j) = 0;
+    virtual std::vector<size_type> getPredecessorPositions(size_type j) const = 0;
 
     // returns all valued pairs in R whose second component is j
-    virtual pairs_type getPredecessorValuedPositions(size_type j) = 0;
+    virtual pairs_type getPredecessorValuedPositions(size_type j) const = 0;
 
     // returns the values of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the positions of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the positions and values of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the values of all pairs in R
-    virtual std::vector<elem_type> getAllElements() = 0;
+    virtual std::vector<elem_type> getAllElements() const = 0;
 
     // returns the positions of all pairs in R
-    virtual positions_type getAllPositions() = 0;
+    virtual positions_type getAllPositions() const = 0;
 
     // returns all valued pairs in R
-    virtual pairs_type getAllValuedPositions() = 0;
+    virtual pairs_type getAllValuedPositions() const = 0;
 
     // checks whether R contains a pair (i,j) with i1 <= i <= i2 and j1 <= j <= j2
-    virtual bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the number of pairs in R
-    virtual size_type countElements() = 0;
+    virtual size_type countElements() const = 0;
 
 
     // creates a deep copy
     virtual K2Tree* clone() const = 0;
 
     // prints the parameters (and contents) of the K2Tree
-    virtual void print(bool all = false) = 0;
+    virtual void print(bool all = false) const = 0;
 
     // compares the K2Tree with a given (relation) matrix
-    virtual bool compare(matrix_type& mat, elem_type null, bool silent) {
+    virtual bool compare(matrix_type& mat, elem_type null, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -567,475 +574,185 @@ public:
 
     }
 
-    // compares the K2Tree with another K2Tree
-    virtual bool compare(K2Tree& other, bool silent) {
-
-        bool overallEqual = true;
-        bool equal;
-        unsigned long cnt;
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
-            for (size_type j = 0; j < getNumCols(); j++) {
-                equal = equal && (isNotNull(i, j) == other.isNotNull(i, j));
-            }
-        }
-        if (!silent) std::cout << "isNotNull: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
-            for (size_type j = 0; j < getNumCols(); j++) {
-                equal = equal && (getElement(i, j) == other.getElement(i, j));
-            }
-        }
-        if (!silent) std::cout << "getElement: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
-
-            auto otherSuccs = other.getSuccessorElements(i);
-            auto treeSuccs = getSuccessorElements(i);
-
-            equal = equal && (otherSuccs.size() == treeSuccs.size());
-            if (equal) {
-                for (size_type k = 0; k < treeSuccs.size(); k++) {
-                    equal = equal && (otherSuccs[k] == treeSuccs[k]);
-                }
-            }
-
-        }
-        if (!silent) std::cout << "getSuccessorElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
-
-            auto otherSuccs = other.getSuccessorPositions(i);
-            auto treeSuccs = getSuccessorPositions(i);
-
-            equal = equal && (otherSuccs.size() == treeSuccs.size());
-            if (equal) {
-                for (size_type k = 0; k < treeSuccs.size(); k++) {
-                    equal = equal && (otherSuccs[k] == treeSuccs[k]);
-                }
-            }
+    // compares the K2Tree with another K2Tree (cf. compareK2Trees())
+    virtual bool compare(const K2Tree& other, bool silent) const {
+        return compareK2Trees(*this, other, silent);
+    }
 
-        }
-        if (!silent) std::cout << "getSuccessorPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    // sets the value of the pair (i,j) to null, i.e. removes it from the relation
+    virtual void setNull(size_type i, size_type j) = 0;
 
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
+    // returns the smallest column number j such that (i,j) is in R, or a value >= n if no such pairs exists
+    virtual size_type getFirstSuccessor(size_type i) const = 0;
 
-            auto otherSuccs = other.getSuccessorValuedPositions(i);
-            auto treeSuccs = getSuccessorValuedPositions(i);
+    // appends the column numbers of all pairs of the i-th row to succs, using the scratch memory of the context
+    // (not used by this default implementation)
+    virtual void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext&) const {
 
-            equal = equal && (otherSuccs.size() == treeSuccs.size());
-            if (equal) {
-                for (size_type k = 0; k < treeSuccs.size(); k++) {
-                    equal = equal && (otherSuccs[k] == treeSuccs[k]);
-                }
-            }
+        auto succsOfRow = getSuccessorPositions(i);
+        succs.insert(succs.end(), succsOfRow.begin(), succsOfRow.end());
 
-        }
-        if (!silent) std::cout << "getSuccessorValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    }
 
-#if 1
-        equal = true;
-        for (size_t j = 0; j < getNumCols(); j++) {
+    // appends the row numbers of all pairs of the j-th column to preds, using the scratch memory of the context
+    // (not used by this default implementation)
+    virtual void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const {
 
-            auto otherPreds = other.getPredecessorElements(j);
-            auto treePreds = getPredecessorElements(j);
+        auto predsOfCol = getPredecessorPositions(j);
+        preds.insert(preds.end(), predsOfCol.begin(), predsOfCol.end());
 
-            equal = equal && (otherPreds.size() == treePreds.size());
-            if (equal) {
-                for (size_type k = 0; k < treePreds.size(); k++) {
-                    equal = equal && (otherPreds[k] == treePreds[k]);
-                }
-            }
-
-        }
-        if (!silent) std::cout << "getPredecessorElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    }
 
-#if 1
-        equal = true;
-        for (size_t j = 0; j < getNumCols(); j++) {
+    // returns a row number i with rows[i] such that (i,j) is in R, or a value >= getNumRows() if there is none;
+    // rows needs an entry for every row (implementations stop enumerating the j-th column at the first such i)
+    virtual size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext& ctx) const {
 
-            auto otherPreds = other.getPredecessorPositions(j);
-            auto treePreds = getPredecessorPositions(j);
+        std::vector<size_type> preds;
+        getPredecessorPositions(j, preds, ctx);
 
-            equal = equal && (otherPreds.size() == treePreds.size());
-            if (equal) {
-                for (size_type k = 0; k < treePreds.size(); k++) {
-                    equal = equal && (otherPreds[k] == treePreds[k]);
-                }
+        for (auto i : preds) {
+            if (rows[i]) {
+                return i;
             }
-
         }
-        if (!silent) std::cout << "getPredecessorPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t j = 0; j < getNumCols(); j++) {
-
-            auto otherPreds = other.getPredecessorValuedPositions(j);
-            auto treePreds = getPredecessorValuedPositions(j);
-
-            equal = equal && (otherPreds.size() == treePreds.size());
-            if (equal) {
-                for (size_type k = 0; k < treePreds.size(); k++) {
-                    equal = equal && (otherPreds[k] == treePreds[k]);
-                }
-            }
 
-        }
-        if (!silent) std::cout << "getPredecessorValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+        return getNumRows();
 
-#if 1
-        equal = true;
-        cnt = 0;
-        if (!silent) std::cout << "getElementsInRange: " << std::flush;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
+    }
 
-                        cnt++;
-                        if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
-                            std::cout << "." << std::flush;
-                        }
+    // like getFirstSuccessor(i), using the scratch memory of the context (not used by this default implementation)
+    virtual size_type getFirstSuccessor(size_type i, QueryContext&) const {
+        return getFirstSuccessor(i);
+    }
 
-                        auto otherPairs = other.getElementsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end());
-                        auto treePairs = getElementsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end());
+    // computes y = A * x for the relation matrix A (null entries count as zero);
+    // x needs an entry for every column and y for every row that contains a pair of R (y is overwritten)
+    virtual void multiply(const std::vector<double>& x, std::vector<double>& y) const {
 
-                        equal = equal && (otherPairs.size() == treePairs.size());
-                        if (equal) {
-                            for (size_type k = 0; k < treePairs.size(); k++) {
-                                equal = equal && (otherPairs[k] == treePairs[k]);
-                            }
-                        }
+        std::fill(y.begin(), y.end(), 0.0);
 
-                    }
-                }
-            }
+        for (auto& p : getAllValuedPositions()) {
+            y[p.row] += p.val * x[p.col];
         }
-        if (!silent) std::cout << "\rgetElementsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
 
+    }
 
-#if 1
-        equal = true;
-        cnt = 0;
-        if (!silent) std::cout << "getPositionsInRange: " << std::flush;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
-
-                        cnt++;
-                        if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
-                            std::cout << "." << std::flush;
-                        }
-
-                        auto otherPairs = other.getPositionsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortPairs<size_type, size_type>());
-                        auto treePairs = getPositionsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortPairs<size_type, size_type>());
+    // computes y = A^T * x for the relation matrix A (null entries count as zero);
+    // x needs an entry for every row and y for every column that contains a pair of R (y is overwritten)
+    virtual void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y) const {
 
-                        equal = equal && (otherPairs.size() == treePairs.size());
-                        if (equal) {
-                            for (size_type k = 0; k < treePairs.size(); k++) {
-                                equal = equal && (otherPairs[k] == treePairs[k]);
-                            }
-                        }
+        std::fill(y.begin(), y.end(), 0.0);
 
-                    }
-                }
-            }
+        for (auto& p : getAllValuedPositions()) {
+            y[p.col] += p.val * x[p.row];
         }
-        if (!silent) std::cout << "\rgetPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-
-#if 1
-        equal = true;
-        cnt = 0;
-        if (!silent) std::cout << "getValuedPositionsInRange: " << std::flush;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
 
-                        cnt++;
-                        if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
-                            std::cout << "." << std::flush;
-                        }
-
-                        auto otherPairs = other.getValuedPositionsInRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortValuedPositions<elem_type>());
-                        auto treePairs = getValuedPositionsInRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortValuedPositions<elem_type>());
+    }
 
-                        equal = equal && (otherPairs.size() == treePairs.size());
-                        if (equal) {
-                            for (size_type k = 0; k < treePairs.size(); k++) {
-                                equal = equal && (otherPairs[k] == treePairs[k]);
-                            }
-                        }
+    // stores R in compressed sparse row format: offsets gets getNumRows() + 1 entries and the column numbers (and values,
+    // if vals is not null) of the pairs in row i are cols[offsets[i]], ..., cols[offsets[i + 1] - 1] (sorted by column)
+    virtual void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const {
+        compress(false, offsets, cols, vals);
+    }
 
-                    }
-                }
-            }
-        }
-        if (!silent) std::cout << "\rgetValuedPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    // stores R in compressed sparse column format: offsets gets getNumCols() + 1 entries and the row numbers (and values,
+    // if vals is not null) of the pairs in column j are rows[offsets[j]], ..., rows[offsets[j + 1] - 1] (sorted by row)
+    virtual void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const {
+        compress(true, offsets, rows, vals);
+    }
 
-#if 1
-        equal = true;
-        {
-            auto otherElems = other.getAllElements(); std::sort(otherElems.begin(), otherElems.end());
-            auto treeElems = getAllElements(); std::sort(treeElems.begin(), treeElems.end());
+    // regards R as the edges of a directed graph on the nodes 0 ... max(getNumRows(), getNumCols()) - 1 and returns the BFS level
+    // (i.e. the distance from the nearest of the sources) of every node, -1 (the largest size_type) for unreachable nodes;
+    // the search is level-synchronous: all successors of the (sorted) frontier are queried in batches of consecutive rows,
+    // which are distributed among numThreads threads, and, if directionOptimizing is set, levels with a large frontier
+    // are processed bottom-up instead (checking the predecessors of all unvisited nodes, cf. Beamer et al. (2012))
+    // (generic version for concrete tree types: ::breadthFirstSearch() in Algorithms.hpp)
+    std::vector<size_type> breadthFirstSearch(const std::vector<size_type>& sources, bool directionOptimizing = false, unsigned numThreads = 1) const {
 
-            equal = equal && (otherElems.size() == treeElems.size());
-            if (equal) {
-                for (size_type k = 0; k < treeElems.size(); k++) {
-                    equal = equal && (otherElems[k] == treeElems[k]);
-                }
-            }
-        }
-        if (!silent) std::cout << "getAllElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+        auto expand = [this](const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs, QueryContext&) {
+            expandRows(rows, first, last, succs);
+        };
 
-#if 1
-        equal = true;
-        {
-            auto otherElems = other.getAllPositions(); std::sort(otherElems.begin(), otherElems.end(), sortPairs<size_type, size_type>());
-            auto treeElems = getAllPositions(); std::sort(treeElems.begin(), treeElems.end(), sortPairs<size_type, size_type>());
+        return ::breadthFirstSearch(*this, sources, directionOptimizing, numThreads, expand);
 
-            equal = equal && (otherElems.size() == treeElems.size());
-            if (equal) {
-                for (size_type k = 0; k < treeElems.size(); k++) {
-                    equal = equal && (otherElems[k] == treeElems[k]);
-                }
-            }
-        }
-        if (!silent) std::cout << "getAllPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    }
 
-#if 1
-        equal = true;
-        {
-            auto otherElems = other.getAllValuedPositions(); std::sort(otherElems.begin(), otherElems.end(), sortValuedPositions<elem_type>());
-            auto treeElems = getAllValuedPositions(); std::sort(treeElems.begin(), treeElems.end(), sortValuedPositions<elem_type>());
+    /*
+     * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
+     */
 
-            equal = equal && (otherElems.size() == treeElems.size());
-            if (equal) {
-                for (size_type k = 0; k < treeElems.size(); k++) {
-                    equal = equal && (otherElems[k] == treeElems[k]);
-                }
-            }
-        }
-        if (!silent) std::cout << "getAllValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    // alias of isNotNull()
+    virtual bool areRelated(size_type i, size_type j) const = 0;
 
-#if 1
-        equal = true;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
+    // alias of getSuccessorPositions()
+    virtual std::vector<size_type> getSuccessors(size_type i) const = 0;
 
-                        bool otherFlag = other.containsElement(i1, i2, j1, j2);
-                        bool treeFlag = containsElement(i1, i2, j1, j2);
+    // alias of getPredecessorPositions()
+    virtual std::vector<size_type> getPredecessors(size_type j) const = 0;
 
-                        equal = equal && (otherFlag == treeFlag);
+    // alias of getPositionsInRange()
+    virtual positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
-                    }
-                }
-            }
-        }
-        if (!silent) std::cout << "containsElement: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+    // alias of containsElement()
+    virtual bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
-#if 1
-        equal = true;
-        {
-            size_type otherCnt = other.countElements();
-            size_type treeCnt = countElements();
+    // alias of countElements()
+    virtual size_type countLinks() const = 0;
 
-            equal = (otherCnt == treeCnt);
-        }
-        if (!silent) std::cout << "countElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
 
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getNumRows(); i++) {
-            for (size_type j = 0; j < getNumCols(); j++) {
-                equal = equal && (areRelated(i, j) == other.areRelated(i, j));
-            }
-        }
-        if (!silent) std::cout << "areRelated: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
 
-#if 1
-        equal = true;
-        for (size_t i = 0; i < getNumRows(); i++) {
+protected:
+    /* breadthFirstSearch() */
 
-            auto otherSuccs = other.getSuccessors(i);
-            auto treeSuccs = getSuccessors(i);
+    // appends the column numbers of all pairs in the rows rows[first], ..., rows[last - 1] to succs
+    // (rows is sorted ascending and only contains valid row numbers; implementations may exploit that
+    // neighbouring rows share the upper part of their descents)
+    virtual void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const {
 
-            equal = equal && (otherSuccs.size() == treeSuccs.size());
-            if (equal) {
-                for (size_type k = 0; k < treeSuccs.size(); k++) {
-                    equal = equal && (otherSuccs[k] == treeSuccs[k]);
-                }
-            }
+        QueryContext ctx;
 
+        for (size_type t = first; t < last; t++) {
+            getSuccessorPositions(rows[t], succs, ctx);
         }
-        if (!silent) std::cout << "getSuccessors: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
 
-#if 1
-        equal = true;
-        for (size_t j = 0; j < getNumCols(); j++) {
+    }
 
-            auto otherPreds = other.getPredecessors(j);
-            auto treePreds = getPredecessors(j);
+private:
+    /* toCSR(), toCSC() */
 
-            equal = equal && (otherPreds.size() == treePreds.size());
-            if (equal) {
-                for (size_type k = 0; k < treePreds.size(); k++) {
-                    equal = equal && (otherPreds[k] == treePreds[k]);
-                }
-            }
+    // collects the pairs row by row (column by column, if transposed) with the context-based row (column) queries,
+    // which append to indices directly; only the entries of the current row (column) are sorted, so apart from the
+    // result no memory proportional to the number of pairs is needed (the values are looked up with getElement())
+    void compress(bool transposed, std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
 
-        }
-        if (!silent) std::cout << "getPredecessors: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
+        size_type n = transposed ? getNumCols() : getNumRows();
+        QueryContext ctx;
 
-#if 1
-        equal = true;
-        cnt = 0;
-        if (!silent) std::cout << "getRange: " << std::flush;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
-
-                        cnt++;
-                        if (!silent && (cnt > 0) && (cnt % 10000 == 0)) {
-                            std::cout << "." << std::flush;
-                        }
+        offsets.assign(n + 1, 0);
+        indices.clear();
+        if (vals != nullptr) vals->clear();
 
-                        auto otherPairs = other.getRange(i1, i2, j1, j2); std::sort(otherPairs.begin(), otherPairs.end(), sortPairs<size_type, size_type>());
-                        auto treePairs = getRange(i1, i2, j1, j2); std::sort(treePairs.begin(), treePairs.end(), sortPairs<size_type, size_type>());
+        for (size_type i = 0; i < n; i++) {
 
-                        equal = equal && (otherPairs.size() == treePairs.size());
-                        if (equal) {
-                            for (size_type k = 0; k < treePairs.size(); k++) {
-                                equal = equal && (otherPairs[k] == treePairs[k]);
-                            }
-                        }
-
-                    }
-                }
+            if (transposed) {
+                getPredecessorPositions(i, indices, ctx);
+            } else {
+                getSuccessorPositions(i, indices, ctx);
             }
-        }
-        if (!silent) std::cout << "\rgetRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t i1 = 0; i1 < getNumRows(); i1++) {
-            for (size_t i2 = i1; i2 < getNumRows(); i2++) {
-                for (size_t j1 = 0; j1 < getNumCols(); j1++) {
-                    for (size_t j2 = j1; j2 < getNumCols(); j2++) {
-
-                        bool otherFlag = other.containsLink(i1, i2, j1, j2);
-                        bool treeFlag = containsLink(i1, i2, j1, j2);
 
-                        equal = equal && (otherFlag == treeFlag);
+            std::sort(indices.begin() + offsets[i], indices.end());
+            offsets[i + 1] = indices.size();
 
-                    }
+            if (vals != nullptr) {
+                for (size_type k = offsets[i]; k < offsets[i + 1]; k++) {
+                    vals->push_back(transposed ? getElement(indices[k], i) : getElement(i, indices[k]));
                 }
             }
-        }
-        if (!silent) std::cout << "containsLink: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        {
-            size_type otherCnt = other.countLinks();
-            size_type treeCnt = countLinks();
 
-            equal = (otherCnt == treeCnt);
         }
-        if (!silent) std::cout << "countLinks: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-        return overallEqual;
 
     }
 
-    // sets the value of the pair (i,j) to null, i.e. removes it from the relation
-    virtual void setNull(size_type i, size_type j) = 0;
-
-    // returns the smallest column number j such that (i,j) is in R, or a value >= n if no such pairs exists
-    virtual size_type getFirstSuccessor(size_type i) = 0;
-
-    /*
-     * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
-     */
-
-    // alias of isNotNull()
-    virtual bool areRelated(size_type i, size_type j) = 0;
-
-    // alias of getSuccessorPositions()
-    virtual std::vector<size_type> getSuccessors(size_type i) = 0;
-
-    // alias of getPredecessorPositions()
-    virtual std::vector<size_type> getPredecessors(size_type j) = 0;
-
-    // alias of getPositionsInRange()
-    virtual positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
-
-    // alias of containsElement()
-    virtual bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
-
-    // alias of countElements()
-    virtual size_type countLinks() = 0;
-
 };
 
 #endif //K2TREES_K2TREE_HPP
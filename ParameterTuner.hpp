@@ -0,0 +1,634 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_PARAMETERTUNER_HPP
+#define K2TREES_PARAMETERTUNER_HPP
+
+#include <chrono>
+#include <random>
+
+#include "K2Tree.hpp"
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridTree.hpp"
+#include "StaticUnevenRectangularOrMiniTree.hpp"
+#include "StaticUnevenRectangularTree.hpp"
+#include "Utility.hpp"
+
+/**
+ * K2Tree implementations the ParameterTuner chooses from.
+ */
+enum TreeType {
+    BASIC_K2TREE, // BasicK2Tree(k)
+    HYBRID_K2TREE, // HybridK2Tree(upperK, upperH, lowerK)
+    KRKC_TREE, // KrKcTree(kr, kc)
+    UNEVEN_KRKC_TREE, // UnevenKrKcTree(kr, kc)
+    UNEVEN_KRKC_OR_MINI_TREE // UnevenKrKcOrMiniTree(kr, kc, mb)
+};
+
+/**
+ * Objectives of the ParameterTuner.
+ */
+enum TuningObjective {
+    MINIMISE_MEMORY, // smallest estimated size
+    MINIMISE_LATENCY // fastest (timed) query mix, or fewest levels per point query without timing
+};
+
+/**
+ * Configuration (implementation and parameters) of a K2Tree as evaluated by the ParameterTuner.
+ */
+struct TreeConfiguration {
+
+    TreeType type;
+
+    // parameters (only those of the respective implementation are meaningful)
+    size_type k;
+    size_type upperK;
+    size_type upperH;
+    size_type lowerK;
+    size_type kr;
+    size_type kc;
+    size_type mb;
+
+    size_type height; // number of levels descended by a point query
+    double estimatedBits; // estimated size of the tree (in bits)
+    double queryTime; // measured average time of a query of the query mix (in ns), 0 if not timed
+
+    TreeConfiguration(TreeType t) {
+
+        type = t;
+        k = upperK = upperH = lowerK = kr = kc = mb = 0;
+        height = 0;
+        estimatedBits = 0;
+        queryTime = 0;
+
+    }
+
+};
+
+/**
+ * Input-type-specific parts of the ParameterTuner (pairs with values and constructors with null element
+ * in general, positions without values and constructors without null element for bool).
+ */
+template<typename E>
+struct TunerTraits {
+
+    typedef std::vector<ValuedPosition<E>> input_type;
+
+    static const size_type valueBits = 8 * sizeof(E); // size of an entry of L_
+    static const bool hasValues = true; // whether MiniK2Tree stores a value per pair
+
+    static size_type row(const ValuedPosition<E>& p) {
+        return p.row;
+    }
+
+    static size_type col(const ValuedPosition<E>& p) {
+        return p.col;
+    }
+
+    template<typename Tree, typename... Params>
+    static Tree* construct(input_type& pairs, const E null, Params... params) {
+        return new Tree(pairs, params..., null);
+    }
+
+};
+
+template<>
+struct TunerTraits<bool> {
+
+    typedef std::vector<std::pair<size_type, size_type>> input_type;
+
+    static const size_type valueBits = 1;
+    static const bool hasValues = false;
+
+    static size_type row(const std::pair<size_type, size_type>& p) {
+        return p.first;
+    }
+
+    static size_type col(const std::pair<size_type, size_type>& p) {
+        return p.second;
+    }
+
+    template<typename Tree, typename... Params>
+    static Tree* construct(input_type& pairs, const bool, Params... params) {
+        return new Tree(pairs, params...);
+    }
+
+};
+
+/**
+ * Automatic choice of the K2Tree implementation and its parameters for a given relation.
+ *
+ * For every candidate configuration, the sizes of T_ and L_ (and of the other parts of the implementation)
+ * are estimated analytically level by level from the number of non-empty submatrices on each level.
+ * These numbers are counted on a uniform sample of the pairs and extrapolated to the whole relation
+ * (with the Chao1 estimator for the number of classes (Chao 1984), adapted to Bernoulli sampling).
+ *
+ * Optionally, the configurations with the smallest estimated sizes are built on the sample and timed
+ * with a query mix of isNotNull(), getSuccessorPositions() and getPredecessorPositions() (in equal parts),
+ * which is the basis of the latency objective then.
+ *
+ * The candidates are BasicK2Tree with k in {2, 4, 8, 16}, HybridK2Tree with upperK in {4, 8, 16}, upperH in {1, 2, 3}
+ * and lowerK in {2, 4} (lowerK < upperK), as well as KrKcTree, UnevenKrKcTree and UnevenKrKcOrMiniTree (mb in {16, 64})
+ * with kr, kc in {2, 4, 8}.
+ *
+ * Chao, A. (1984).
+ * Nonparametric estimation of the number of classes in a population.
+ * Scandinavian Journal of Statistics, 11(4), 265–270.
+ */
+template<typename E>
+class ParameterTuner {
+
+public:
+    typedef E elem_type;
+
+    typedef typename TunerTraits<elem_type>::input_type input_type;
+
+
+    /**
+     * sampleSize = maximum number of pairs the estimations (and the timed trees) are based on
+     * numQueries = number of queries of each kind in the query mix (0 = no timing)
+     * numTimed = number of configurations (those with the smallest estimated sizes) that are timed
+     * seed = seed of the random number generator used for sampling and the query mix
+     */
+    ParameterTuner(const size_type sampleSize = size_type(1) << 18, const size_type numQueries = 0, const size_type numTimed = 8, const unsigned seed = 0, const elem_type null = elem_type()) {
+
+        if (sampleSize == 0) {
+
+            std::string err = std::string() + "Unsuitable parameters! " + "The sample size has to be positive.";
+            throw std::runtime_error(err);
+
+        }
+
+        sampleSize_ = sampleSize;
+        numQueries_ = numQueries;
+        numTimed_ = numTimed;
+        seed_ = seed;
+        null_ = null;
+
+    }
+
+
+    // returns all candidate configurations for the relation described by pairs, the best one w.r.t. objective first
+    std::vector<TreeConfiguration> rankConfigurations(const input_type& pairs, TuningObjective objective) const {
+
+        std::mt19937 rng(seed_);
+
+        size_type numRows = 1;
+        size_type numCols = 1;
+        for (auto& p : pairs) {
+
+            numRows = std::max(numRows, TunerTraits<elem_type>::row(p) + 1);
+            numCols = std::max(numCols, TunerTraits<elem_type>::col(p) + 1);
+
+        }
+
+        auto sample = drawSample(pairs, rng);
+        double fraction = pairs.empty() ? 1.0 : (1.0 * sample.size()) / pairs.size();
+
+        std::vector<std::pair<size_type, size_type>> positions;
+        positions.reserve(sample.size());
+        for (auto& p : sample) {
+            positions.emplace_back(TunerTraits<elem_type>::row(p), TunerTraits<elem_type>::col(p));
+        }
+
+        Estimator est(positions, fraction, pairs.size());
+        std::vector<TreeConfiguration> confs;
+
+        for (size_type k : {2, 4, 8, 16}) {
+            confs.push_back(estimateBasic(est, numRows, numCols, k));
+        }
+
+        for (size_type upperK : {4, 8, 16}) {
+            for (size_type upperH : {1, 2, 3}) {
+                for (size_type lowerK : {2, 4}) {
+                    if (lowerK < upperK) {
+                        confs.push_back(estimateHybrid(est, numRows, numCols, upperK, upperH, lowerK));
+                    }
+                }
+            }
+        }
+
+        for (size_type kr : {2, 4, 8}) {
+            for (size_type kc : {2, 4, 8}) {
+
+                confs.push_back(estimateKrKc(est, numRows, numCols, kr, kc));
+                confs.push_back(estimateUneven(est, numRows, numCols, kr, kc, 0, false));
+
+                for (size_type mb : {16, 64}) {
+                    confs.push_back(estimateUneven(est, numRows, numCols, kr, kc, mb, true));
+                }
+
+            }
+        }
+
+        // the smallest configurations are timed on the sample
+        std::sort(confs.begin(), confs.end(), [](const TreeConfiguration& a, const TreeConfiguration& b) {
+            return a.estimatedBits < b.estimatedBits;
+        });
+
+        if (numQueries_ > 0) {
+            for (size_type c = 0; c < std::min(numTimed_, (size_type)confs.size()); c++) {
+                confs[c].queryTime = timeQueries(confs[c], sample, rng);
+            }
+        }
+
+        if (objective == MINIMISE_LATENCY) {
+            std::stable_sort(confs.begin(), confs.end(), [](const TreeConfiguration& a, const TreeConfiguration& b) {
+
+                // timed configurations first (fastest first), the others by height
+                if ((a.queryTime > 0) != (b.queryTime > 0)) return a.queryTime > 0;
+                if (a.queryTime > 0) return a.queryTime < b.queryTime;
+                return a.height < b.height;
+
+            });
+        }
+
+        return confs;
+
+    }
+
+    // returns the best configuration for the relation described by pairs w.r.t. objective
+    TreeConfiguration recommend(const input_type& pairs, TuningObjective objective) const {
+        return rankConfigurations(pairs, objective)[0];
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) for pairs using the best configuration w.r.t. objective
+    // (pairs is reordered by the construction)
+    K2Tree<elem_type>* build(input_type& pairs, TuningObjective objective) const {
+        return build(recommend(pairs, objective), pairs);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) for pairs using the given configuration
+    // (pairs is reordered by the construction)
+    K2Tree<elem_type>* build(const TreeConfiguration& conf, input_type& pairs) const {
+
+        typedef TunerTraits<elem_type> traits;
+
+        switch (conf.type) {
+            case BASIC_K2TREE: return traits::template construct<BasicK2Tree<elem_type>>(pairs, null_, conf.k);
+            case HYBRID_K2TREE: return traits::template construct<HybridK2Tree<elem_type>>(pairs, null_, conf.upperK, conf.upperH, conf.lowerK);
+            case KRKC_TREE: return traits::template construct<KrKcTree<elem_type>>(pairs, null_, conf.kr, conf.kc);
+            case UNEVEN_KRKC_TREE: return traits::template construct<UnevenKrKcTree<elem_type>>(pairs, null_, conf.kr, conf.kc);
+            default: return traits::template construct<UnevenKrKcOrMiniTree<elem_type>>(pairs, null_, conf.kr, conf.kc, conf.mb);
+        }
+
+    }
+
+
+
+private:
+    size_type sampleSize_; // maximum number of sampled pairs
+    size_type numQueries_; // number of queries of each kind in the query mix
+    size_type numTimed_; // number of timed configurations
+    unsigned seed_; // seed for sampling and query mix
+
+    elem_type null_; // null element
+
+
+    /* rankConfigurations() */
+
+    // counts of non-empty submatrices on the sample and their extrapolation to the whole relation
+    struct Estimator {
+
+        const std::vector<std::pair<size_type, size_type>>& sample; // positions of the sampled pairs
+        double fraction; // sampled fraction of the pairs
+        size_type numPairs; // number of pairs of the whole relation
+
+        std::vector<std::pair<std::pair<size_type, size_type>, double>> cache; // estimates per submatrix size (rows, columns)
+
+        Estimator(const std::vector<std::pair<size_type, size_type>>& s, double f, size_type n) : sample(s) {
+
+            fraction = f;
+            numPairs = n;
+
+        }
+
+        // estimated number of non-empty (aligned) submatrices with r rows and c columns
+        double blocks(size_type r, size_type c) {
+
+            for (auto& e : cache) {
+                if (e.first == std::make_pair(r, c)) return e.second;
+            }
+
+            double res = blocks(sample, r, c);
+            cache.emplace_back(std::make_pair(r, c), res);
+
+            return res;
+
+        }
+
+        // estimated number of non-empty (aligned) submatrices with r rows and c columns among the positions
+        // (which have been sampled with the sampled fraction of the pairs)
+        double blocks(const std::vector<std::pair<size_type, size_type>>& positions, size_type r, size_type c) const {
+
+            if (positions.empty()) return 0;
+
+            std::vector<std::pair<size_type, size_type>> keys;
+            keys.reserve(positions.size());
+            for (auto& p : positions) {
+                keys.emplace_back(p.first / r, p.second / c);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            // number of submatrices hit by exactly one, exactly two resp. any number of sampled pairs
+            size_type once = 0;
+            size_type twice = 0;
+            size_type distinct = 0;
+            for (size_type a = 0, b = 0; a < keys.size(); a = b, distinct++) {
+
+                for (b = a + 1; (b < keys.size()) && (keys[b] == keys[a]); b++) { }
+
+                once += (b - a == 1);
+                twice += (b - a == 2);
+
+            }
+
+            // bias-corrected Chao1 estimator (for Bernoulli sampling), clamped to the range of possible values
+            double est = distinct + (1.0 - fraction) * once * (once - 1.0) / (2.0 * (twice + 1));
+
+            return std::max((double)distinct, std::min({est, distinct / fraction, (double)numPairs}));
+
+        }
+
+    };
+
+    // estimated size (in bits) of a tree whose nodes on level l have r[l] x c[l] cells (the children of the nodes on
+    // the last level are single cells) and whose level-0 nodes are the non-empty ones among all such submatrices
+    // (i.e. the root for a single tree and the partitions for the uneven trees)
+    double estimateTreeBits(Estimator& est, const std::vector<size_type>& r, const std::vector<size_type>& c, const std::vector<std::pair<size_type, size_type>>* positions) const {
+
+        double lenT = 0;
+        double lenL = 0;
+
+        for (size_type l = 0; l < r.size(); l++) {
+
+            double nodes = (positions == 0) ? est.blocks(r[l], c[l]) : est.blocks(*positions, r[l], c[l]);
+            size_type rNext = (l + 1 < r.size()) ? r[l + 1] : 1;
+            size_type cNext = (l + 1 < c.size()) ? c[l + 1] : 1;
+            double children = nodes * (r[l] / rNext) * (c[l] / cNext);
+
+            if (l + 1 < r.size()) {
+                lenT += children;
+            } else {
+                lenL += children;
+            }
+
+        }
+
+        // rank_support_v adds 25% to T_
+        return 1.25 * lenT + lenL * TunerTraits<elem_type>::valueBits;
+
+    }
+
+    TreeConfiguration estimateBasic(Estimator& est, size_type numRows, size_type numCols, size_type k) const {
+
+        TreeConfiguration conf(BASIC_K2TREE);
+        conf.k = k;
+
+        size_type h = std::max((size_type)1, logK(std::max(numRows, numCols), k));
+        std::vector<size_type> sizes(h);
+        for (size_type l = 0, s = size_type(pow(k, h)); l < h; l++, s /= k) {
+            sizes[l] = s;
+        }
+
+        conf.height = h;
+        conf.estimatedBits = estimateTreeBits(est, sizes, sizes, 0) + 8 * sizeof(BasicK2Tree<elem_type>);
+
+        return conf;
+
+    }
+
+    TreeConfiguration estimateHybrid(Estimator& est, size_type numRows, size_type numCols, size_type upperK, size_type upperH, size_type lowerK) const {
+
+        TreeConfiguration conf(HYBRID_K2TREE);
+        conf.upperK = upperK;
+        conf.upperH = upperH;
+        conf.lowerK = lowerK;
+
+        // same dimensioning as the HybridK2Tree constructors
+        size_type maxDim = std::max(numRows, numCols);
+        size_type nPrime = size_type(ceil((1.0 * maxDim) / lowerK));
+        size_type h = std::min(upperH, std::max((size_type)1, logK(nPrime, upperK)));
+        size_type actualUpperH = h;
+
+        nPrime = size_type(pow(upperK, h));
+        do {
+
+            nPrime *= lowerK;
+            h++;
+
+        } while (nPrime < maxDim);
+
+        std::vector<size_type> sizes(h);
+        for (size_type l = 0, s = nPrime; l < h; s /= ((l < actualUpperH) ? upperK : lowerK), l++) {
+            sizes[l] = s;
+        }
+
+        conf.height = h;
+        conf.estimatedBits = estimateTreeBits(est, sizes, sizes, 0) + 8 * sizeof(HybridK2Tree<elem_type>);
+
+        return conf;
+
+    }
+
+    TreeConfiguration estimateKrKc(Estimator& est, size_type numRows, size_type numCols, size_type kr, size_type kc) const {
+
+        TreeConfiguration conf(KRKC_TREE);
+        conf.kr = kr;
+        conf.kc = kc;
+
+        size_type h = std::max({(size_type)1, logK(numRows, kr), logK(numCols, kc)});
+        std::vector<size_type> rows(h);
+        std::vector<size_type> cols(h);
+        for (size_type l = 0, r = size_type(pow(kr, h)), c = size_type(pow(kc, h)); l < h; l++, r /= kr, c /= kc) {
+
+            rows[l] = r;
+            cols[l] = c;
+
+        }
+
+        conf.height = h;
+        conf.estimatedBits = estimateTreeBits(est, rows, cols, 0) + 8 * sizeof(KrKcTree<elem_type>);
+
+        return conf;
+
+    }
+
+    // UnevenKrKcTree (orMini = false) resp. UnevenKrKcOrMiniTree with threshold mb (orMini = true)
+    TreeConfiguration estimateUneven(Estimator& est, size_type numRows, size_type numCols, size_type kr, size_type kc, size_type mb, bool orMini) const {
+
+        TreeConfiguration conf(orMini ? UNEVEN_KRKC_OR_MINI_TREE : UNEVEN_KRKC_TREE);
+        conf.kr = kr;
+        conf.kc = kc;
+        conf.mb = mb;
+
+        // same dimensioning as the constructors: every partition is a KrKcTree of height min(hr, hc)
+        size_type hr = std::max((size_type)1, logK(numRows, kr));
+        size_type hc = std::max((size_type)1, logK(numCols, kc));
+        size_type h = std::min(hr, hc);
+        size_type numPartitions = size_type(pow(kr, hr - h)) * size_type(pow(kc, hc - h));
+
+        std::vector<size_type> rows(h);
+        std::vector<size_type> cols(h);
+        for (size_type l = 0, r = size_type(pow(kr, h)), c = size_type(pow(kc, h)); l < h; l++, r /= kr, c /= kc) {
+
+            rows[l] = r;
+            cols[l] = c;
+
+        }
+
+        conf.height = h;
+
+        double bits = 64.0 * numPartitions * (orMini ? 3 : 1); // partition pointers (and typed pointers)
+
+        if (!orMini) {
+
+            bits += estimateTreeBits(est, rows, cols, 0);
+            bits += est.blocks(rows[0], cols[0]) * 8 * sizeof(KrKcTree<elem_type>);
+
+        } else {
+
+            // partitions whose extrapolated number of pairs exceeds mb become KrKcTrees, the others MiniK2Trees
+            std::vector<std::pair<size_type, size_type>> keys;
+            keys.reserve(est.sample.size());
+            for (auto& p : est.sample) {
+                keys.emplace_back(p.first / rows[0], p.second / cols[0]);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<std::pair<size_type, size_type>> large;
+            std::vector<std::pair<size_type, size_type>> largeKeys;
+            for (size_type a = 0, b = 0; a < keys.size(); a = b) {
+
+                for (b = a + 1; (b < keys.size()) && (keys[b] == keys[a]); b++) { }
+
+                if ((b - a) / est.fraction > mb) {
+                    largeKeys.push_back(keys[a]);
+                }
+
+            }
+            for (auto& p : est.sample) {
+                if (std::binary_search(largeKeys.begin(), largeKeys.end(), std::make_pair(p.first / rows[0], p.second / cols[0]))) {
+                    large.push_back(p);
+                }
+            }
+
+            double largePairs = large.size() / est.fraction;
+            double miniPairs = std::max(0.0, est.numPairs - largePairs);
+            double miniPartitions = std::max(0.0, est.blocks(rows[0], cols[0]) - largeKeys.size());
+
+            bits += estimateTreeBits(est, rows, cols, &large);
+            bits += largeKeys.size() * 8 * sizeof(KrKcTree<elem_type>);
+            bits += miniPairs * (8 * sizeof(std::pair<size_type, size_type>) + (TunerTraits<elem_type>::hasValues ? TunerTraits<elem_type>::valueBits : 0));
+            bits += miniPartitions * 8 * sizeof(MiniK2Tree<elem_type>);
+
+        }
+
+        conf.estimatedBits = bits + 8 * (orMini ? sizeof(UnevenKrKcOrMiniTree<elem_type>) : sizeof(UnevenKrKcTree<elem_type>));
+
+        return conf;
+
+    }
+
+    // uniform sample of at most sampleSize_ pairs (selection sampling, Knuth's algorithm S)
+    input_type drawSample(const input_type& pairs, std::mt19937& rng) const {
+
+        if (pairs.size() <= sampleSize_) return pairs;
+
+        input_type sample;
+        sample.reserve(sampleSize_);
+
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        for (size_type t = 0; (t < pairs.size()) && (sample.size() < sampleSize_); t++) {
+            if ((pairs.size() - t) * dist(rng) < sampleSize_ - sample.size()) {
+                sample.push_back(pairs[t]);
+            }
+        }
+
+        return sample;
+
+    }
+
+    // average time (in ns) of a query of the query mix on the configuration built on the sample
+    double timeQueries(const TreeConfiguration& conf, const input_type& sample, std::mt19937& rng) const {
+
+        input_type pairs(sample);
+        K2Tree<elem_type>* tree = build(conf, pairs);
+
+        size_type numRows = std::max(tree->getNumRows(), (size_type)1);
+        size_type numCols = std::max(tree->getNumCols(), (size_type)1);
+
+        // half of the point queries hit pairs of the sample
+        std::vector<std::pair<size_type, size_type>> points(numQueries_);
+        std::vector<size_type> rows(numQueries_);
+        std::vector<size_type> cols(numQueries_);
+        for (size_type q = 0; q < numQueries_; q++) {
+
+            if ((q % 2 == 0) && !sample.empty()) {
+
+                auto& p = sample[rng() % sample.size()];
+                points[q] = std::make_pair(TunerTraits<elem_type>::row(p), TunerTraits<elem_type>::col(p));
+
+            } else {
+                points[q] = std::make_pair(rng() % numRows, rng() % numCols);
+            }
+
+            rows[q] = rng() % numRows;
+            cols[q] = rng() % numCols;
+
+        }
+
+        QueryContext ctx;
+        std::vector<size_type> res;
+        size_type checksum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_type q = 0; q < numQueries_; q++) {
+
+            checksum += tree->isNotNull(points[q].first, points[q].second);
+
+            res.clear();
+            tree->getSuccessorPositions(rows[q], res, ctx);
+            checksum += res.size();
+
+            res.clear();
+            tree->getPredecessorPositions(cols[q], res, ctx);
+            checksum += res.size();
+
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        delete tree;
+
+        // keeps the queries from being optimised away
+        volatile size_type sink = checksum;
+        (void) sink;
+
+        return std::max(std::chrono::duration<double, std::nano>(end - start).count() / (3 * numQueries_), 1e-3);
+
+    }
+
+};
+
+#endif //K2TREES_PARAMETERTUNER_HPP
@@ -22,6 +22,7 @@
 #ifndef K2TREES_ROWTREE_HPP
 #define K2TREES_ROWTREE_HPP
 
+#include "Algorithms.hpp"
 #include "Utility.hpp"
 
 /**
@@ -34,6 +35,9 @@
  * and one value is designated the null element ("element is not in the set").
  *
  * The data structure is static (with the exception of the setNull() method).
+ * All other methods are const and leave the internal state untouched (any scratch memory is local
+ * to the call), so const methods may be called concurrently on the same object by any number of threads.
+ * setNull() must not run concurrently with any other method.
  */
 template<typename E>
 class RowTree {
@@ -48,54 +52,77 @@ public:
     virtual ~RowTree() { }
 
     // returns the size of the universe (length of the "row", n)
-    virtual size_type getLength() = 0;
+    virtual size_type getLength() const = 0;
 
     // returns the null element
-    virtual elem_type getNull() = 0;
+    virtual elem_type getNull() const = 0;
 
 
     // checks whether i is in S
-    virtual bool isNotNull(size_type i) = 0;
+    virtual bool isNotNull(size_type i) const = 0;
 
     // returns the value of i, if the element is in S, null otherwise
-    virtual elem_type getElement(size_type i) = 0;
+    virtual elem_type getElement(size_type i) const = 0;
 
     // returns the smallest (left-most) element in S, or a value >= n if S is empty
-    virtual size_type getFirst() = 0;
+    virtual size_type getFirst() const = 0;
+
+    // returns the smallest element i in S with i >= x, or -1 (i.e. the largest size_type) if there is no such element
+    virtual size_type nextGEQ(size_type x) const = 0;
+
+    // returns the largest element i in S with i <= x, or -1 (i.e. the largest size_type) if there is no such element
+    virtual size_type prevLEQ(size_type x) const = 0;
+
+    // same as nextGEQ(x), but starts from the path stored in cursor and stores the path to the result there;
+    // a cursor must only be used with one RowTree, repeated searches with increasing x only go up the tree
+    // as far as necessary (i.e. their costs are amortised over the whole sequence of searches)
+    virtual size_type nextGEQ(size_type x, RowTreeCursor& cursor) const = 0;
+
+    // same as prevLEQ(x), but starts from (and updates) the path stored in cursor like nextGEQ(x, cursor)
+    virtual size_type prevLEQ(size_type x, RowTreeCursor& cursor) const = 0;
 
     // returns the values of all elements i in S with l <= i <= r
-    virtual std::vector<elem_type> getElementsInRange(size_type l, size_type r) = 0;
+    virtual std::vector<elem_type> getElementsInRange(size_type l, size_type r) const = 0;
 
     // returns the positions of all elements i in S with l <= i <= r
-    virtual std::vector<size_type> getPositionsInRange(size_type l, size_type r) = 0;
+    virtual std::vector<size_type> getPositionsInRange(size_type l, size_type r) const = 0;
 
     // returns the positions and values of all elements i in S with l <= i <= r
-    virtual list_type getValuedPositionsInRange(size_type l, size_type r) = 0;
+    virtual list_type getValuedPositionsInRange(size_type l, size_type r) const = 0;
 
     // returns the values of all elements in S
-    virtual std::vector<elem_type> getAllElements() = 0;
+    virtual std::vector<elem_type> getAllElements() const = 0;
 
     // returns the positions of all elements in S
-    virtual std::vector<size_type> getAllPositions() = 0;
+    virtual std::vector<size_type> getAllPositions() const = 0;
+
+    // appends the positions of all elements in S to positions, using the scratch memory of the context
+    // (not used by this default implementation)
+    virtual void getAllPositions(std::vector<size_type>& positions, QueryContext&) const {
+
+        auto all = getAllPositions();
+        positions.insert(positions.end(), all.begin(), all.end());
+
+    }
 
     // returns the positions and values of all elements in S
-    virtual list_type getAllValuedPositions() = 0;
+    virtual list_type getAllValuedPositions() const = 0;
 
     // checks whether S contains an element i with l <= i <= r
-    virtual bool containsElement(size_type l, size_type r) = 0;
+    virtual bool containsElement(size_type l, size_type r) const = 0;
 
     // counts the number of elements in S
-    virtual size_type countElements() = 0;
+    virtual size_type countElements() const = 0;
 
 
     // creates a deep copy
     virtual RowTree* clone() const = 0;
 
     // prints the parameters (and contents) of the RowTree
-    virtual void print(bool all = false) = 0;
+    virtual void print(bool all = false) const = 0;
 
     // compares the RowTree with a given vector representation
-    virtual bool compare(std::vector<elem_type>& v, elem_type null, bool silent) {
+    virtual bool compare(std::vector<elem_type>& v, elem_type null, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -302,176 +329,9 @@ public:
 
     }
 
-    // compares the RowTree with another RowTree
-    virtual bool compare(RowTree<elem_type>& other, bool silent) {
-
-        bool overallEqual = true;
-        bool equal;
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getLength(); i++) {
-            equal = equal && (isNotNull(i) == other.isNotNull(i));
-        }
-        if (!silent) std::cout << "isNotNull: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_type i = 0; i < getLength(); i++) {
-            equal = equal && (getElement(i) == other.getElement(i));
-        }
-        if (!silent) std::cout << "getElement: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t l = 0; l < getLength(); l++) {
-            for (size_t r = l; r < getLength(); r++) {
-
-                auto elems = getElementsInRange(l, r); std::sort(elems.begin(), elems.end());
-                auto otherElems = other.getElementsInRange(l, r); std::sort(otherElems.begin(), otherElems.end());
-
-                equal = equal && (elems.size() == otherElems.size());
-                if (equal) {
-                    for (size_type i = 0; i < elems.size(); i++) {
-                        equal = equal && (elems[i] == otherElems[i]);
-                    }
-                }
-
-            }
-        }
-        if (!silent) std::cout << "getElementsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t l = 0; l < getLength(); l++) {
-            for (size_t r = l; r < getLength(); r++) {
-
-                auto positions = getPositionsInRange(l, r); std::sort(positions.begin(), positions.end());
-                auto otherPositions = other.getPositionsInRange(l, r); std::sort(otherPositions.begin(), otherPositions.end());
-
-                equal = equal && (positions.size() == otherPositions.size());
-                if (equal) {
-                    for (size_type i = 0; i < positions.size(); i++) {
-                        equal = equal && (positions[i] == otherPositions[i]);
-                    }
-                }
-
-            }
-        }
-        if (!silent) std::cout << "getPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t l = 0; l < getLength(); l++) {
-            for (size_t r = l; r < getLength(); r++) {
-
-                auto positions = getValuedPositionsInRange(l, r); std::sort(positions.begin(), positions.end(), sortPairs<size_type, elem_type>());
-                auto otherPositions = other.getValuedPositionsInRange(l, r); std::sort(otherPositions.begin(), otherPositions.end(), sortPairs<size_type, elem_type>());
-
-                equal = equal && (positions.size() == otherPositions.size());
-                if (equal) {
-                    for (size_type i = 0; i < positions.size(); i++) {
-                        equal = equal && (positions[i] == otherPositions[i]);
-                    }
-                }
-
-            }
-        }
-        if (!silent) std::cout << "getValuedPositionsInRange: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        {
-            auto elems = getAllElements(); std::sort(elems.begin(), elems.end());
-            auto otherElems = other.getAllElements(); std::sort(otherElems.begin(), otherElems.end());
-
-            equal = equal && (elems.size() == otherElems.size());
-            if (equal) {
-                for (size_type i = 0; i < elems.size(); i++) {
-                    equal = equal && (elems[i] == otherElems[i]);
-                }
-            }
-
-        }
-        if (!silent) std::cout << "getAllElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        {
-            auto positions = getAllPositions(); std::sort(positions.begin(), positions.end());
-            auto otherPositions = other.getAllPositions(); std::sort(otherPositions.begin(), otherPositions.end());
-
-            equal = equal && (positions.size() == otherPositions.size());
-            if (equal) {
-                for (size_type i = 0; i < positions.size(); i++) {
-                    equal = equal && (positions[i] == otherPositions[i]);
-                }
-            }
-
-        }
-        if (!silent) std::cout << "getAllPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        {
-            auto positions = getAllValuedPositions(); std::sort(positions.begin(), positions.end(), sortPairs<size_type, elem_type>());
-            auto otherPositions = other.getAllValuedPositions(); std::sort(otherPositions.begin(), otherPositions.end(), sortPairs<size_type, elem_type>());
-
-            equal = equal && (positions.size() == otherPositions.size());
-            if (equal) {
-                for (size_type i = 0; i < positions.size(); i++) {
-                    equal = equal && (positions[i] == otherPositions[i]);
-                }
-            }
-
-        }
-        if (!silent) std::cout << "getAllValuedPositions: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        for (size_t l = 0; l < getLength(); l++) {
-            for (size_t r = l; r < getLength(); r++) {
-
-                bool flag = containsElement(l, r);
-                bool otherFlag = other.containsElement(l, r);
-
-                equal = equal && (flag == otherFlag);
-
-            }
-        }
-        if (!silent) std::cout << "containsElement: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-#if 1
-        equal = true;
-        {
-            size_type cnt = countElements();
-            size_type otherCnt = other.countElements();
-            equal = (cnt == otherCnt);
-        }
-        if (!silent) std::cout << "countElements: " << (equal ? "OK" : "NOT OK") << std::endl;
-        overallEqual = overallEqual && equal;
-#endif
-
-        return overallEqual;
-
+    // compares the RowTree with another RowTree (cf. compareRowTrees())
+    virtual bool compare(const RowTree<elem_type>& other, bool silent) const {
+        return compareRowTrees(*this, other, silent);
     }
 
     // sets the value of element i to null, i.e. removes it from the set
@@ -479,4 +339,5 @@ public:
 
 };
 
+
 #endif //K2TREES_ROWTREE_HPP
@@ -22,7 +22,9 @@
 #ifndef K2TREES_STATICBASICRECTANGULARTREE_HPP
 #define K2TREES_STATICBASICRECTANGULARTREE_HPP
 
+#include <atomic>
 #include <queue>
+#include <thread>
 
 #include "K2Tree.hpp"
 #include "Utility.hpp"
@@ -34,9 +36,13 @@
  * The described relation matrix is rectangular with edge lengths of numRows and numCols,
  * where numRows (numCols) is the smallest power of kr (kc) that exceeds the row (column) numbers
  * of all relation pairs.
+ *
+ * The arities can be fixed at compile time (KR, KC > 0, powers of two, e.g. KrKcTree<E, 2, 4>),
+ * then point queries descend with shifts and masks instead of divisions and the constructors
+ * only accept kr = KR and kc = KC. With KR = KC = 0 (default) the arities are pure run-time parameters.
  */
-template<typename E>
-class KrKcTree : public virtual K2Tree<E> {
+template<typename E, size_type KR = 0, size_type KC = 0>
+class KrKcTree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -46,6 +52,10 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    static_assert((KR != 1) && ((KR & (KR - 1)) == 0), "The compile-time row arity (KR) has to be 0 or a power of two.");
+    static_assert((KC != 1) && ((KC & (KC - 1)) == 0), "The compile-time column arity (KC) has to be 0 or a power of two.");
+    static_assert((KR == 0) == (KC == 0), "Either both or none of the arities have to be fixed at compile time.");
+
 
     KrKcTree() {
         // nothing to do
@@ -63,6 +73,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        M_ = other.M_;
 
     }
 
@@ -83,6 +94,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        M_ = other.M_;
 
         return *this;
 
@@ -99,6 +111,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(mat.size(), kr_), logK(mat[0].size(), kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -138,6 +151,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -185,6 +199,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(lists.size(), kr_), logK(maxCol, kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -264,6 +279,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -355,6 +371,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(maxRow + 1, kr_), logK(maxCol + 1, kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -380,6 +397,7 @@ public:
 
         kr_ = kr;
         kc_ = kc;
+        checkArity();
         h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
         numRows_ = size_type(pow(kr_, h_));
         numCols_ = size_type(pow(kc_, h_));
@@ -396,42 +414,42 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         allSuccessorElementsIterative(succs, i);
@@ -441,17 +459,18 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
 
         return succs;
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         allSuccessorValuedPositionsIterative(succs, i);
@@ -461,7 +480,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -470,7 +489,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -479,7 +498,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -488,7 +507,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -498,7 +517,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -508,7 +527,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -518,24 +537,39 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
-        return getElementsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    std::vector<elem_type> getAllElements() const override {
+
+        std::vector<elem_type> elements;
+        zOrderScan([&](size_type, size_type, size_type y) { elements.push_back(L_[y]); });
+
+        return elements;
+
     }
 
-    positions_type getAllPositions() override {
-        return getPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
+
+        return pairs;
+
     }
 
-    pairs_type getAllValuedPositions() override {
-        return getValuedPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    pairs_type getAllValuedPositions() const override {
+
+        pairs_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type y) { pairs.push_back(ValuedPosition<elem_type>(i, j, L_[y])); });
+
+        return pairs;
+
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type i = 0; i < L_.size(); i++) {
@@ -548,10 +582,10 @@ public:
 
 
     KrKcTree* clone() const override {
-        return new KrKcTree<elem_type>(*this);
+        return new KrKcTree(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -584,9 +618,127 @@ public:
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsPosInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void multiply(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<false>(x, y, 1);
+    }
+
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<true>(x, y, 1);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+    // multi-threaded version of multiply(), the top-level row bands are distributed among numThreads threads
+    void multiply(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<false>(x, y, numThreads);
+    }
+
+    // multi-threaded version of multiplyTransposed(), the top-level column bands are distributed among numThreads threads
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<true>(x, y, numThreads);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i,val) with (i,j,val) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    KrKcTree<elem_type, KC, KR>* transpose() const {
+        return transposeInit();
+    }
+
+
+    /*
+     * Set operations on K2Trees with the same parameters (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this or the other relation
+    // (with the values of this relation for pairs in both)
+    KrKcTree* unite(const KrKcTree& other) const {
+        return combineInit(other, SET_UNION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in both relations (with the values of this relation)
+    KrKcTree* intersect(const KrKcTree& other) const {
+        return combineInit(other, SET_INTERSECTION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this, but not in the other relation
+    KrKcTree* subtract(const KrKcTree& other) const {
+        return combineInit(other, SET_DIFFERENCE);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in exactly one of the relations
+    KrKcTree* symmetricDifference(const KrKcTree& other) const {
+        return combineInit(other, SET_SYMMETRIC_DIFFERENCE);
     }
 
 
@@ -594,33 +746,160 @@ public:
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
 
+    /*
+     * Additional queries on valued relations (not part of the K2Tree interface)
+     */
+
+    // returns the (at most) num valued pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2 that have the largest values,
+    // sorted in descending order of their values (ties are broken arbitrarily)
+    pairs_type getTopValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2, size_type num) const {
+
+        if (!hasMaxima()) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The subtree maxima have to be built (buildMaxima()) before top-k queries."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+        pairs_type pairs;
+        topRangeValPosInit(pairs, i1, i2, j1, j2, num);
+
+        return pairs;
+
+    }
+
+    // computes the maximum values of the subtrees rooted at the 1-bits of the first levels of T_, which are required
+    // by getTopValuedPositionsInRange() and not built by the constructors or set operations (but kept by transpose());
+    // one value per 1-bit is stored, so memory grows with every covered level: deeper subtrees use the maximum of their
+    // nearest covered ancestor as a looser bound, levels >= h - 1 gives exact bounds for all subtrees
+    void buildMaxima(size_type levels) {
+
+        if (levels == 0) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The maxima have to cover at least one level."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+        size_type lenT = T_.size();
+
+        // the 1-bits of the first levels form a prefix of T_ (the children of the last 1-bit of a level
+        // end the next level), so only the maxima of this prefix are kept
+        size_type end = 0;
+        for (size_type l = 0; (l < levels) && (end < lenT); l++) {
+            end = (R_.rank(end) + 1) * kr_ * kc_;
+        }
+
+        // bottom-up, since children are always stored behind their parents
+        std::vector<elem_type> maxima(R_.rank(lenT), null_);
+
+        for (size_type z = lenT; z-- > 0;) {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_;
+                elem_type& max = maxima[R_.rank(z)];
+
+                for (size_type c = 0; c < kr_ * kc_; c++, y++) {
+
+                    elem_type val = (y >= lenT) ? L_[y - lenT] : (T_[y] ? maxima[R_.rank(y)] : null_);
+
+                    if ((val != null_) && ((max == null_) || (max < val))) {
+                        max = val;
+                    }
+
+                }
+
+            }
+
+        }
+
+        maxima.resize(R_.rank(std::min(end, lenT)));
+        maxima.shrink_to_fit();
+        M_.swap(maxima);
+
+    }
+
+    // checks whether getTopValuedPositionsInRange() can be used, i.e. whether buildMaxima() has been called
+    // (trivially true if there are no inner nodes whose maxima would be needed)
+    bool hasMaxima() const {
+        return !M_.empty() || L_.empty() || T_.empty();
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
 
 private:
+    // the transposed tree swaps the compile-time arities (cf. transpose())
+    template<typename, size_type, size_type> friend class KrKcTree;
+
     // representation of all but the last levels of the K2Tree (internal structure)
     bit_vector_type T_;
 
@@ -630,6 +909,10 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // maximum values of the subtrees rooted at the 1-bits of the first levels of T_ (in the order of the 1-bits),
+    // null_ for subtrees without non-null values; empty unless buildMaxima() has been called
+    std::vector<elem_type> M_;
+
     size_type h_; // height of the K2Tree
     size_type kr_; // row arity of the K2Tree
     size_type kc_; // column arity of the K2Tree
@@ -639,9 +922,26 @@ private:
     elem_type null_; // null element
 
 
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((KR > 0) && ((kr_ != KR) || (kc_ != KC))) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arities (kr, kc) have to be equal to the compile-time arities (KR, KC)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
     /* helper method to check the feasibility of the tree parameters prior to construction */
 
-    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) const {
 
         if ((numRows_ != nr) || (numCols_ != nc)) {
 
@@ -1020,11 +1320,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
         return ((pair.row - sp.firstRow) / widthRow) * kc_ + (pair.col - sp.firstCol) / widthCol;
     }
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -1187,15 +1487,22 @@ private:
 
     }
 
+    /* isNotNull() */
 
+    bool checkInit(size_type p, size_type q) const {
 
-    /* isNotNull() */
+        if (KR > 0) {
+
+            size_type z;
+            return !L_.empty() && descend(p, q, z) && (L_[z - T_.size()] != null_);
+
+        }
 
-    bool checkInit(size_type p, size_type q) {
         return (L_.empty()) ? false : check(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+
     }
 
-    bool check(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    bool check(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return (L_[z - T_.size()] != null_);
@@ -1207,11 +1514,20 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type p, size_type q) {
+    elem_type getInit(size_type p, size_type q) const {
+
+        if (KR > 0) {
+
+            size_type z;
+            return (!L_.empty() && descend(p, q, z)) ? L_[z - T_.size()] : null_;
+
+        }
+
         return (L_.empty()) ? null_ : get(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+
     }
 
-    elem_type get(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    elem_type get(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -1221,9 +1537,36 @@ private:
 
     }
 
+    /* isNotNull(), getElement() and areRelated() with compile-time arities */
+
+    // descends to the leaf of (p, q) using shifts and masks instead of divisions (requires KR, KC > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type p, size_type q, size_type& z) const {
+
+        const size_type logKr = log2Pow2(KR);
+        const size_type logKc = log2Pow2(KC);
+        size_type sr = (h_ - 1) * logKr; // log2(numRows / KR) on the current level
+        size_type sc = (h_ - 1) * logKc; // log2(numCols / KC) on the current level
+
+        z = (p >> sr) * KC + (q >> sc);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            sr -= logKr;
+            sc -= logKc;
+            z = R_.rank(z + 1) * KR * KC + ((p >> sr) & (KR - 1)) * KC + ((q >> sc) & (KC - 1));
+
+        }
+
+        return true;
+
+    }
+
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -1233,11 +1576,7 @@ private:
         if (lenT == 0) {
 
             size_type offset = p * numCols_;
-            for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
-                }
-            }
+            forEachNonNull(L_.data() + offset, numCols_, null_, [&](size_type i) { succs.push_back(L_[offset + i]); });
 
         } else {
 
@@ -1286,11 +1625,7 @@ private:
 
                     auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
-                        }
-                    }
+                    forEachNonNull(L_.data() + y, kc_, null_, [&](size_type j) { succs.push_back(L_[y + j]); });
 
                 }
 
@@ -1302,7 +1637,7 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1316,7 +1651,7 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsElem(std::vector<elem_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1343,11 +1678,13 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         if (lenT == 0) {
@@ -1366,7 +1703,7 @@ private:
             size_type nc = numCols_/ kc_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // successorsPos
@@ -1375,32 +1712,33 @@ private:
             nc /= kc_;
             for (; nr > 1; relP %= nr, nr /= kr_, nc /= kc_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
                         for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1414,15 +1752,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1436,7 +1772,7 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsPos(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1463,7 +1799,7 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -1542,7 +1878,7 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1560,7 +1896,7 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsValPos(pairs_type& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1587,7 +1923,7 @@ private:
 
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return numCols_;
 
@@ -1602,15 +1938,17 @@ private:
 
         } else {
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
 
             while (!stack.empty()) {
 
-                auto& cur = stack.top();
+                auto& cur = stack.back();
 
                 if (cur.j == kc_) {
-                    stack.pop();
+                    stack.pop_back();
                 } else {
 
                     if (cur.z >= T_.size()) {
@@ -1622,7 +1960,7 @@ private:
                     } else {
 
                         if (T_[cur.z]) {
-                            stack.emplace(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
+                            stack.emplace_back(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
                         }
 
                     }
@@ -1640,7 +1978,7 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = numCols_;
 
@@ -1658,7 +1996,7 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         size_type pos = numCols_;
 
@@ -1688,7 +2026,7 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1702,7 +2040,7 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1728,7 +2066,7 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1742,7 +2080,7 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1766,9 +2104,60 @@ private:
 
     }
 
+    /* getFirstPredecessorIn() */
+
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type y = q / (numCols_ / kc_);
+
+            for (size_type i = 0; i < kr_; i++) {
+
+                auto p = firstPredecessorIn(rows, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_);
+
+                if (p < numRows_) {
+                    return p;
+                }
+
+            }
+
+        }
+
+        return numRows_;
+
+    }
+
+    // same descent as in predecessorsPos(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+            return ((L_[z - T_.size()] != null_) && rows[p]) ? p : numRows_;
+        }
+
+        if (T_[z]) {
+
+            size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
+
+            for (size_type i = 0; i < kr_; i++) {
+
+                auto res = firstPredecessorIn(rows, numRows / kr_, numCols / kc_, q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_);
+
+                if (res < numRows_) {
+                    return res;
+                }
+
+            }
+
+        }
+
+        return numRows_;
+
+    }
+
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1786,7 +2175,7 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsValPos(pairs_type& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1812,7 +2201,7 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1844,7 +2233,7 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elements, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1857,6 +2246,21 @@ private:
             if (T_[z]) {
 
                 auto y = R_.rank(z + 1) * kr_ * kc_;
+
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+
+                        size_type offset = y - T_.size() + kc_ * i + q1;
+                        forEachNonNull(L_.data() + offset, q2 - q1 + 1, null_, [&](size_type j) { elements.push_back(L_[offset + j]); });
+
+                    }
+
+                    return;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
@@ -1889,7 +2293,7 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1921,7 +2325,7 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangePos(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1966,7 +2370,7 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1998,7 +2402,7 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeValPos(pairs_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -2041,19 +2445,94 @@ private:
 
     }
 
-    /* containsElement() */
+    /* getTopValuedPositionsInRange() */
 
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+    void topRangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2, size_type num) const {
 
-        if (!L_.empty()) {
+        if (!L_.empty() && (num != 0)) {
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
-                return 1;
-            }
+            // best-first traversal: always expand the candidate with the largest subtree maximum,
+            // leaves are reported when they are extracted since their values dominate all remaining bounds
+            std::priority_queue<RangeCandidate<elem_type>> queue;
+            pushTopRangeValPosChildren(queue, numRows_, numCols_, p1, p2, q1, q2, 0, 0, 0, null_);
 
-            size_type p1Prime, p2Prime;
+            while (!queue.empty() && (pairs.size() < num)) {
+
+                RangeCandidate<elem_type> cur = queue.top();
+                queue.pop();
+
+                if (cur.z >= T_.size()) {
+                    pairs.push_back(ValuedPosition<elem_type>(cur.dp, cur.dq, cur.bound));
+                } else {
+                    pushTopRangeValPosChildren(queue, cur.nr, cur.nc, cur.p1, cur.p2, cur.q1, cur.q2, cur.dp, cur.dq, R_.rank(cur.z + 1) * kr_ * kc_, cur.bound);
+                }
+
+            }
+
+        }
+
+    }
+
+    // same child enumeration as in rangeValPos(), but non-empty children are queued together with an upper bound
+    // of their values (parentBound is the bound of the node whose children are enumerated)
+    void pushTopRangeValPosChildren(std::priority_queue<RangeCandidate<elem_type>>& queue, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type y, elem_type parentBound) const {
+
+        size_type p1Prime, p2Prime, z;
+
+        for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+
+            p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+            p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
+
+            for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+
+                z = y + kc_ * i + j;
+                elem_type bound = (z >= T_.size()) ? L_[z - T_.size()] : (T_[z] ? subtreeBound(z, parentBound) : null_);
+
+                if (bound != null_) {
+                    queue.push(RangeCandidate<elem_type>(
+                            bound,
+                            numRows / kr_,
+                            numCols / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                            (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                            dp + (numRows / kr_) * i,
+                            dq + (numCols / kc_) * j,
+                            z
+                    ));
+                }
+
+            }
+
+        }
+
+    }
+
+    // upper bound for the values in the subtree rooted at the 1-bit z of T_: its maximum if z is covered by M_,
+    // otherwise the bound of its parent
+    elem_type subtreeBound(size_type z, elem_type parentBound) const {
+
+        size_type r = R_.rank(z);
+
+        return (r < M_.size()) ? M_[r] : parentBound;
+
+    }
+
+    /* containsElement() */
+
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (!L_.empty()) {
+
+            // dividing by k_ (as stated in the paper) in not correct,
+            // because it does not use the size of the currently considered submatrix but of its submatrices
+            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
+                return 1;
+            }
+
+            size_type p1Prime, p2Prime;
 
             for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
 
@@ -2076,7 +2555,7 @@ private:
 
     }
 
-    bool elemInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool elemInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -2143,1289 +2622,2675 @@ private:
 
     }
 
-};
-
-
-/**
- * Bool specialisation of KrKcTree.
- *
- * Has the same characteristics as the general implementation above,
- * but makes use of some simplifications since the only non-null value is 1 / true.
- */
-template<>
-class KrKcTree<bool> : public virtual K2Tree<bool> {
-
-public:
-    typedef bool elem_type;
-
-    typedef K2Tree<elem_type>::matrix_type matrix_type;
-    typedef K2Tree<elem_type>::list_type list_type;
-    typedef K2Tree<elem_type>::positions_type positions_type;
-    typedef K2Tree<elem_type>::pairs_type pairs_type;
 
+    /* multiply() / multiplyTransposed() */
 
-    KrKcTree() {
-        // nothing to do
-    }
+    template<bool Transposed>
+    void multiplyInit(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
 
-    KrKcTree(const KrKcTree& other) {
+        std::fill(y.begin(), y.end(), 0.0);
 
-        h_ = other.h_;
-        kr_ = other.kr_;
-        kc_ = other.kc_;
-        numRows_ = other.numRows_;
-        numCols_ = other.numCols_;
-        null_ = other.null_;
+        if (L_.empty()) return;
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+        if ((numThreads <= 1) || (T_.size() == 0)) {
 
-    }
+            multiplyBlock<Transposed>(x, y, numRows_ / kr_, numCols_ / kc_, 0, 0, 0);
+            return;
 
-    KrKcTree& operator=(const KrKcTree& other) {
+        }
 
-        // check for self-assignment
-        if (&other == this) {
-            return *this;
+        // determine the submatrices on the shallowest level that provides enough row (column) bands for all threads
+        size_type nr = numRows_ / kr_;
+        size_type nc = numCols_ / kc_;
+        size_type bands = Transposed ? kc_ : kr_;
+        std::vector<SubmatrixInfo> level, nextLevel;
+        for (size_type i = 0; i < kr_; i++) {
+            for (size_type j = 0; j < kc_; j++) {
+                level.push_back(SubmatrixInfo(i * nr, j * nc, i * kc_ + j));
+            }
         }
 
-        h_ = other.h_;
-        kr_ = other.kr_;
-        kc_ = other.kc_;
-        numRows_ = other.numRows_;
-        numCols_ = other.numCols_;
-        null_ = other.null_;
+        for (; (bands < numThreads) && (nr > 1); nr /= kr_, nc /= kc_, bands *= (Transposed ? kc_ : kr_)) {
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+            for (auto& cur : level) {
 
-        return *this;
+                if (T_[cur.z]) {
 
-    }
+                    size_type pos = R_.rank(cur.z + 1) * kr_ * kc_;
 
-    /**
-     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
-     *
-     * Assumes that all rows of mat are equally long.
-     */
-    KrKcTree(const matrix_type& mat, const size_type kr, const size_type kc) {
+                    for (size_type i = 0; i < kr_; i++) {
+                        for (size_type j = 0; j < kc_; j++) {
+                            nextLevel.push_back(SubmatrixInfo(cur.dp + i * (nr / kr_), cur.dq + j * (nc / kc_), pos + i * kc_ + j));
+                        }
+                    }
 
-        null_ = false;
+                }
 
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(mat.size(), kr_), logK(mat[0].size(), kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+            }
 
-        std::vector<std::vector<bool>> levels(h_);
-        buildFromMatrix(mat, levels, numRows_, numCols_, 1, 0, 0);
+            level.swap(nextLevel);
+            nextLevel.clear();
 
-        size_type total = 0;
-        for (auto l = 0; l < h_ - 1; l++) {
-            total += levels[l].size();
         }
-        T_ = bit_vector_type(total);
-
-        bit_vector_type::iterator outIter = T_.begin();
-        for (size_type l = 0; l < h_ - 1; l++) {
 
-            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-            levels[l].clear();
-            levels[l].shrink_to_fit();
+        // all submatrices of a band write to the same entries of y and are therefore processed by the same thread
+        std::stable_sort(level.begin(), level.end(), [](const SubmatrixInfo& a, const SubmatrixInfo& b) {
+            return Transposed ? (a.dq < b.dq) : (a.dp < b.dp);
+        });
 
+        std::vector<size_type> bandStarts;
+        for (size_type t = 0; t < level.size(); t++) {
+            if ((t == 0) || (Transposed ? (level[t].dq != level[t - 1].dq) : (level[t].dp != level[t - 1].dp))) {
+                bandStarts.push_back(t);
+            }
         }
+        bandStarts.push_back(level.size());
 
-        L_ = bit_vector_type(levels[h_ - 1].size());
-        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-        levels[h_ - 1].clear();
-        levels[h_ - 1].shrink_to_fit();
-
-        R_ = rank_type(&T_);
+        std::atomic<size_type> nextBand(0);
+        std::vector<std::thread> workers;
 
-    }
+        for (unsigned w = 0; w < numThreads; w++) {
+            workers.emplace_back([&]() {
+                for (size_type b = nextBand++; b + 1 < bandStarts.size(); b = nextBand++) {
+                    for (size_type t = bandStarts[b]; t < bandStarts[b + 1]; t++) {
+                        multiplyNode<Transposed>(x, y, nr, nc, level[t].dp, level[t].dq, level[t].z);
+                    }
+                }
+            });
+        }
 
-    /**
-     * Matrix-based constructor similar to the one above, but only a part of the relation matrix is used:
-     *  x = first row of the submatrix
-     *  y = first column of the submatrix
-     *  nr = number of rows of the submatrix
-     *  nc = number of columns of the submatrix
-     */
-    KrKcTree(const matrix_type& mat, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+        for (auto& w : workers) {
+            w.join();
+        }
 
-        null_ = false;
+    }
 
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+    template<bool Transposed>
+    void multiplyNode(const std::vector<double>& x, std::vector<double>& y, size_type numRows, size_type numCols, size_type dp, size_type dq, size_type z) const {
 
-        checkParameters(nr, nc, kr, kc);
+        if (z >= T_.size()) {
 
-        std::vector<std::vector<bool>> levels(h_);
-        buildFromMatrix(mat, levels, numRows_, numCols_, 1, x, y);
+            if (L_[z - T_.size()] != null_) {
+                y[Transposed ? dq : dp] += L_[z - T_.size()] * x[Transposed ? dp : dq];
+            }
 
-        size_type total = 0;
-        for (auto l = 0; l < h_ - 1; l++) {
-            total += levels[l].size();
+        } else if (T_[z]) {
+            multiplyBlock<Transposed>(x, y, numRows / kr_, numCols / kc_, dp, dq, R_.rank(z + 1) * kr_ * kc_);
         }
-        T_ = bit_vector_type(total);
 
-        bit_vector_type::iterator outIter = T_.begin();
-        for (size_type l = 0; l < h_ - 1; l++) {
+    }
 
-            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-            levels[l].clear();
-            levels[l].shrink_to_fit();
+    // processes the block of children starting at index z in the (conceptual concatenation of) T and L,
+    // numRows and numCols are the dimensions of the children
+    template<bool Transposed>
+    void multiplyBlock(const std::vector<double>& x, std::vector<double>& y, size_type numRows, size_type numCols, size_type dp, size_type dq, size_type z) const {
 
-        }
+        size_type lenT = T_.size();
 
-        L_ = bit_vector_type(levels[h_ - 1].size());
-        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-        levels[h_ - 1].clear();
-        levels[h_ - 1].shrink_to_fit();
+        if (z >= lenT) {
 
-        R_ = rank_type(&T_);
+            size_type pos = z - lenT;
 
-    }
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++, pos++) {
+                    if (L_[pos] != null_) {
+                        y[Transposed ? dq + j : dp + i] += L_[pos] * x[Transposed ? dp + i : dq + j];
+                    }
+                }
+            }
 
-    /**
-     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
-     *
-     * The actually used method depends on parameter mode.
-     */
-    KrKcTree(const RelationLists& lists, const size_type kr, const size_type kc, const int mode) {
+        } else {
 
-        null_ = false;
+            size_type pos = z;
 
-        size_type maxCol = 0;
-        for (auto& row : lists) {
-            for (auto& elem : row) {
-                maxCol = std::max(maxCol, elem);
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++, pos++) {
+                    if (T_[pos]) {
+                        multiplyBlock<Transposed>(x, y, numRows / kr_, numCols / kc_, dp + i * numRows, dq + j * numCols, R_.rank(pos + 1) * kr_ * kc_);
+                    }
+                }
             }
+
         }
-        maxCol++; // for number of columns
 
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(lists.size(), kr_), logK(maxCol, kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+    }
 
-        switch (mode) {
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
 
-            case 0: { // 3.3.2.
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
 
-                std::vector<std::vector<bool>> levels(h_);
-                std::vector<RelationList::const_iterator> cursors;
-                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
-                    cursors.push_back(iter->begin());
-                }
+        if (L_.empty()) return;
 
-                buildFromLists(lists, cursors, levels, numRows_, numCols_, 1, 0, 0);
+        size_type numLevels = h_ - 1;
+        size_type kSq = kr_ * kc_;
 
-                size_type total = 0;
-                for (auto l = 0; l < h_ - 1; l++) {
-                    total += levels[l].size();
-                }
-                T_ = bit_vector_type(total);
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), nr(numLevels + 1, numRows_), nc(numLevels + 1, numCols_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
 
-                bit_vector_type::iterator outIter = T_.begin();
-                for (size_type l = 0; l < h_ - 1; l++) {
+        for (size_type l = 0; l < numLevels; l++) {
 
-                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-                    levels[l].clear();
-                    levels[l].shrink_to_fit();
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * kSq;
+            nr[l + 1] = nr[l] / kr_;
+            nc[l + 1] = nc[l] / kc_;
 
-                }
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
 
-                L_ = bit_vector_type(levels[h_ - 1].size());
-                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-                levels[h_ - 1].clear();
-                levels[h_ - 1].shrink_to_fit();
+        }
 
-                R_ = rank_type(&T_);
+        size_type l = 0; // topmost level whose cursor has been moved
 
-                break;
+        for (size_type y = 0; y < L_.size(); y += kSq) {
 
+            for (; l < numLevels; l++) {
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % kSq / kc_) * nr[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % kc_) * nc[l + 1];
             }
 
-            case 1: { // 3.3.3.
+            for (size_type z = 0; z < kSq; z++) {
+                if (L_[y + z] != null_) {
+                    func(dp[numLevels] + z / kc_, dq[numLevels] + z % kc_, y + z);
+                }
+            }
 
-                buildFromListsViaTree(lists);
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
 
-                R_ = rank_type(&T_);
+                l--;
+                size_type block = (cur[l] - start[l]) / kSq;
 
-                break;
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
+                }
+
+                steps = (cur[l] - start[l]) / kSq - block;
 
             }
 
-            case 2: { // 3.3.4.
+        }
 
-                buildFromListsDynamicBitmaps(lists);
+    }
 
-                break;
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
 
-            }
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of numRows_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
 
-            default: {
+        if (!L_.empty()) {
 
-                buildFromListsDynamicBitmaps(lists);
-                break;
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
 
-            }
+            rowMajorScan(func, frontiers, numRows_, numCols_, 0, 0);
 
         }
 
     }
 
-    /**
-     * List-of-lists-based constructor similar to the one above, but only a part of the relation matrix is used:
-     *  x = first row of the submatrix
-     *  y = first column of the submatrix
-     *  nr = number of rows of the submatrix
-     *  nc = number of columns of the submatrix
-     */
-    KrKcTree(const RelationLists& lists, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type kr, const size_type kc, const int mode) {
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the nr rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type nr, size_type nc, size_type dp, size_type l) const {
 
-        null_ = false;
-
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+        for (size_type i = 0; i < kr_; i++) {
 
-        checkParameters(nr, nc, kr, kc);
+            if (l == h_ - 1) {
 
-        switch (mode) {
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < kc_; j++) {
 
-            case 0: { // 3.3.2.
+                        auto y = node.z + i * kc_ + j - T_.size();
 
-                std::vector<std::vector<bool>> levels(h_);
-                std::vector<RelationList::const_iterator> cursors;
-                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
+                        if (L_[y] != null_) {
+                            func(dp + i, node.dq + j, y);
+                        }
 
-                    cursors.push_back(iter->begin());
-                    auto& rowIter = cursors.back();
-                    while ((rowIter != iter->end()) && (*rowIter < y)) {
-                        rowIter++;
                     }
-
                 }
 
-                buildFromLists(lists, cursors, levels, numRows_, numCols_, 1, x, y);
-
-                size_type total = 0;
-                for (auto l = 0; l < h_ - 1; l++) {
-                    total += levels[l].size();
-                }
-                T_ = bit_vector_type(total);
+            } else {
 
-                bit_vector_type::iterator outIter = T_.begin();
-                for (size_type l = 0; l < h_ - 1; l++) {
+                frontiers[l + 1].clear();
 
-                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-                    levels[l].clear();
-                    levels[l].shrink_to_fit();
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < kc_; j++) {
 
-                }
+                        auto z = node.z + i * kc_ + j;
 
-                L_ = bit_vector_type(levels[h_ - 1].size());
-                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-                levels[h_ - 1].clear();
-                levels[h_ - 1].shrink_to_fit();
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (nr / kr_), node.dq + j * (nc / kc_), R_.rank(z + 1) * kr_ * kc_));
+                        }
 
-                R_ = rank_type(&T_);
+                    }
+                }
 
-                break;
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, nr / kr_, nc / kc_, dp + i * (nr / kr_), l + 1);
+                }
 
             }
 
-            case 1: { // 3.3.3.
-
-                buildFromListsViaTree(lists, x, y, nr, nc);
+        }
 
-                R_ = rank_type(&T_);
+    }
 
-                break;
+    /* toCSR(), toCSC() */
 
-            }
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
 
-            case 2: { // 3.3.4.
+        offsets.assign((Transposed ? numCols_ : numRows_) + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
 
-                buildFromListsDynamicBitmaps(lists, x, y, nr, nc);
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
 
-                break;
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
 
-            }
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type y) {
 
-            default: {
+            auto pos = offsets[Transposed ? j : i]++;
 
-                buildFromListsDynamicBitmaps(lists, x, y, nr, nc);
-                break;
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = L_[y];
 
-            }
+        });
 
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
         }
+        offsets[0] = 0;
 
     }
 
-    /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
-     */
-    KrKcTree(positions_type& pairs, const size_type kr, const size_type kc) {
+    /* unite(), intersect(), subtract(), symmetricDifference() */
 
-        null_ = false;
+    KrKcTree* combineInit(const KrKcTree& other, SetOperation op) const {
 
-        size_type maxRow = 0;
-        size_type maxCol = 0;
-        for (auto p : pairs) {
-            maxRow = std::max(maxRow, p.first);
-            maxCol = std::max(maxCol, p.second);
-        }
+        if ((kr_ != other.kr_) || (kc_ != other.kc_) || (h_ != other.h_)) {
 
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "Both K2Trees have to have the same arities (kr, kc) and height (h)."
+            ;
 
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(maxRow + 1, kr_), logK(maxCol + 1, kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+            throw std::runtime_error(err);
 
-        if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
         }
 
-        R_ = rank_type(&T_);
+        auto res = new KrKcTree();
 
-    }
+        res->kr_ = kr_;
+        res->kc_ = kc_;
+        res->h_ = h_;
+        res->numRows_ = numRows_;
+        res->numCols_ = numCols_;
+        res->null_ = null_;
 
-    /**
-     * List-of-pairs-based constructor similar to the one above, but only a part of the relation matrix is used:
-     *  x = first row of the submatrix
-     *  y = first column of the submatrix
-     *  nr = number of rows of the submatrix
-     *  nc = number of columns of the submatrix
-     */
-    KrKcTree(positions_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc) {
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        res->combine(*this, other, op, levels, 1, !L_.empty(), 0, !other.L_.empty(), 0);
 
-        null_ = false;
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res->T_ = bit_vector_type(total);
 
-        kr_ = kr;
-        kc_ = kc;
-        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
-        numRows_ = size_type(pow(kr_, h_));
-        numCols_ = size_type(pow(kc_, h_));
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-        checkParameters(nr, nc, kr, kc);
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
-        if (l != r) {
-            buildFromListsInplace(pairs, x, y, nr, nc, l, r);
         }
 
-        R_ = rank_type(&T_);
+        res->R_ = rank_type(&res->T_);
+
+        return res;
 
     }
 
+    // merges the subtrees of the current node (on level l) of a and b, i.e. appends the children of this node in the result
+    // to levels resp. L_ and returns whether there are any; zA (zB) is the start of the block of children of the node in a (b)
+    // and only relevant if the node is non-empty in a (b), which is indicated by inA (inB)
+    bool combine(const KrKcTree& a, const KrKcTree& b, SetOperation op, std::vector<std::vector<bool>>& levels, size_type l, bool inA, size_type zA, bool inB, size_type zB) {
 
-    // returns the height of the K2Tree
-    size_type getH() {
-        return h_;
-    }
+        if (l == h_) {
 
-    // returns the row arity of the K2Tree
-    size_type getKr() {
-        return kr_;
-    }
+            std::vector<elem_type> C;
 
-    // returns the column arity of the K2Tree
-    size_type getKc() {
-        return kc_;
-    }
+            for (size_type j = 0; j < kr_ * kc_; j++) {
 
-    size_type getNumRows() override {
-        return numRows_;
-    }
+                auto valA = inA ? a.L_[zA + j - a.T_.size()] : a.null_;
+                auto valB = inB ? b.L_[zB + j - b.T_.size()] : b.null_;
 
-    size_type getNumCols() override {
-        return numCols_;
-    }
+                C.push_back(isInResult(op, valA != a.null_, valB != b.null_) ? ((valA != a.null_) ? valA : valB) : null_);
 
-    elem_type getNull() override {
-        return null_;
-    }
+            }
 
+            if (isAll(C, null_)) {
+                return false;
+            } else {
 
-    bool areRelated(size_type i, size_type j) override {
-        return checkLinkInit(i, j);
-    }
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+            }
 
-        std::vector<size_type> succs;
-//        successorsInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+        } else {
 
-        return succs;
+            std::vector<bool> C;
 
-    }
+            for (size_type j = 0; j < kr_ * kc_; j++) {
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+                bool childA = inA && a.T_[zA + j];
+                bool childB = inB && b.T_[zB + j];
 
-        std::vector<size_type> preds;
-        predecessorsInit(preds, j);
+                C.push_back(mayBeInResult(op, childA, childB) && combine(
+                        a,
+                        b,
+                        op,
+                        levels,
+                        l + 1,
+                        childA,
+                        childA ? a.R_.rank(zA + j + 1) * kr_ * kc_ : 0,
+                        childB,
+                        childB ? b.R_.rank(zB + j + 1) * kr_ * kc_ : 0
+                ));
 
-        return preds;
+            }
 
-    }
+            if (isAllZero(C)) {
+                return false;
+            } else {
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
 
-        positions_type pairs;
-        rangeInit(pairs, i1, i2, j1, j2);
-//        rangeInit(pairs, i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
+            }
 
-        return pairs;
+        }
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return linkInRangeInit(i1, i2, j1, j2);
-//        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
-    }
+    /* transpose() */
 
-    size_type countLinks() override {
+    KrKcTree<elem_type, KC, KR>* transposeInit() const {
 
-        size_type res = 0;
-        for (auto i = 0; i < L_.size(); i++) {
-            res += L_[i];
-        }
+        auto res = new KrKcTree<elem_type, KC, KR>();
 
-        return res;
+        res->kr_ = kc_;
+        res->kc_ = kr_;
+        res->h_ = h_;
+        res->numRows_ = numCols_;
+        res->numCols_ = numRows_;
+        res->null_ = null_;
 
-    }
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = std::vector<elem_type>(L_.size());
+        res->M_ = std::vector<elem_type>(M_.size());
 
+        if (!L_.empty()) {
 
-    /*
-     * General methods for completeness' sake (are redundant / useless for bool)
-     */
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            std::vector<size_type> ones(h_, 0); // next index in M_ on every level
+            for (size_type l = 1; l < h_ - 1; l++) {
 
-    bool isNotNull(size_type i, size_type j) override {
-        return areRelated(i, j);
-    }
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * kr_ * kc_;
+                ones[l] = R_.rank(cursors[l]);
 
-    elem_type getElement(size_type i, size_type j) override {
-        return areRelated(i, j);
-    }
+            }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
-        return std::vector<elem_type>(getSuccessors(i).size(), true);
-    }
+            transposeBlock(res, cursors, ones, 1, 0);
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
-        return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors (and the maxima of the written 1-bits to M_ at the indices given by ones)
+    void transposeBlock(KrKcTree<elem_type, KC, KR>* res, std::vector<size_type>& cursors, std::vector<size_type>& ones, size_type l, size_type z) const {
 
-        auto pos = getSuccessors(i);
+        if (l == h_) {
 
-        pairs_type succs;
-        for (auto j : pos) {
-            succs.push_back(ValuedPosition<elem_type>(i, j, true));
-        }
+            for (size_type i = 0; i < kc_; i++) {
+                for (size_type j = 0; j < kr_; j++) {
+                    res->L_[cursors[l - 1]++] = L_[z + j * kc_ + i - T_.size()];
+                }
+            }
 
-        return succs;
+        } else {
 
-    }
+            for (size_type i = 0; i < kc_; i++) {
+                for (size_type j = 0; j < kr_; j++) {
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
-        return std::vector<elem_type>(getPredecessors(j).size(), true);
-    }
+                    size_type y = z + j * kc_ + i;
+                    size_type pos = cursors[l - 1]++;
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
-        return getPredecessors(j);
-    }
+                    if (T_[y]) {
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+                        res->T_[pos] = true;
 
-        auto pos = getPredecessors(j);
+                        size_type r = R_.rank(y + 1);
+                        if (r - 1 < M_.size()) {
+                            res->M_[ones[l - 1]++] = M_[r - 1];
+                        }
 
-        pairs_type preds;
-        for (auto i : pos) {
-            preds.push_back(ValuedPosition<elem_type>(i, j, true));
-        }
+                        transposeBlock(res, cursors, ones, l + 1, r * kr_ * kc_);
 
-        return preds;
+                    }
 
-    }
+                }
+            }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
-    }
+        }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    /* getSuccessorPositionsBatch(), expandRows() */
 
-        auto pos = getRange(i1, i2, j1, j2);
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
 
-        pairs_type pairs;
-        for (auto& p : pos) {
-            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
+        if (!L_.empty() && (first < last)) {
+            successorsBatch(rows, first, last, numRows_ / kr_, numCols_ / kc_, 0, 0, 0, func);
         }
 
-        return pairs;
-
     }
 
-    std::vector<elem_type> getAllElements() override {
-        return std::vector<elem_type>(countLinks(), true);
-    }
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children starts at z and whose children have nr rows and nc columns);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type nr, size_type nc, size_type dp, size_type dq, size_type z, Func& func) const {
 
-    positions_type getAllPositions() override {
-        return getRange(0, numRows_ - 1, 0, numCols_ - 1);
-    }
+        size_type lenT = T_.size();
 
-    pairs_type getAllValuedPositions() override {
+        for (size_type t = first; t < last;) {
 
-        auto pos = getAllPositions();
+            size_type r = (rows[t] - dp) / nr;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / nr == r)) e++;
 
-        pairs_type pairs;
-        for (auto& p : pos) {
-            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
-        }
+            if (z >= lenT) {
 
-        return pairs;
+                for (size_type c = 0; c < kc_; c++) {
+                    if (L_[z - lenT + r * kc_ + c] != null_) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
+                }
 
-    }
+            } else {
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return linkInRangeInit(i1, i2, j1, j2);
-//        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
-    }
+                for (size_type c = 0, y = z + r * kc_; c < kc_; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, nr / kr_, nc / kc_, dp + r * nr, dq + c * nc, R_.rank(y + 1) * kr_ * kc_, func);
+                    }
+                }
 
-    size_type countElements() override {
-        return countLinks();
-    }
+            }
 
+            t = e;
+
+        }
 
-    KrKcTree* clone() const override {
-        return new KrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+};
 
-        std::cout << "### Parameters ###" << std::endl;
-        std::cout << "h  = " << h_ << std::endl;
-        std::cout << "kr  = " << kr_ << std::endl;
-        std::cout << "kc  = " << kc_ << std::endl;
-        std::cout << "numRows = " << numRows_ << std::endl;
-        std::cout << "numCols = " << numCols_ << std::endl;
+
+/**
+ * Bool specialisation of KrKcTree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but makes use of some simplifications since the only non-null value is 1 / true.
+ */
+template<size_type KR, size_type KC>
+class KrKcTree<bool, KR, KC> final : public virtual K2Tree<bool> {
+
+public:
+    typedef bool elem_type;
+
+    typedef K2Tree<elem_type>::matrix_type matrix_type;
+    typedef K2Tree<elem_type>::list_type list_type;
+    typedef K2Tree<elem_type>::positions_type positions_type;
+    typedef K2Tree<elem_type>::pairs_type pairs_type;
+
+    static_assert((KR != 1) && ((KR & (KR - 1)) == 0), "The compile-time row arity (KR) has to be 0 or a power of two.");
+    static_assert((KC != 1) && ((KC & (KC - 1)) == 0), "The compile-time column arity (KC) has to be 0 or a power of two.");
+    static_assert((KR == 0) == (KC == 0), "Either both or none of the arities have to be fixed at compile time.");
+
+
+    KrKcTree() {
+        // nothing to do
+    }
+
+    KrKcTree(const KrKcTree& other) {
+
+        h_ = other.h_;
+        kr_ = other.kr_;
+        kc_ = other.kc_;
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        null_ = other.null_;
+
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
+
+    }
+
+    KrKcTree& operator=(const KrKcTree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        h_ = other.h_;
+        kr_ = other.kr_;
+        kc_ = other.kc_;
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        null_ = other.null_;
+
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
+
+        return *this;
+
+    }
+
+    /**
+     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
+     *
+     * Assumes that all rows of mat are equally long.
+     */
+    KrKcTree(const matrix_type& mat, const size_type kr, const size_type kc) {
+
+        null_ = false;
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(mat.size(), kr_), logK(mat[0].size(), kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromMatrix(mat, levels, numRows_, numCols_, 1, 0, 0);
+
+        size_type total = 0;
+        for (auto l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * Matrix-based constructor similar to the one above, but only a part of the relation matrix is used:
+     *  x = first row of the submatrix
+     *  y = first column of the submatrix
+     *  nr = number of rows of the submatrix
+     *  nc = number of columns of the submatrix
+     */
+    KrKcTree(const matrix_type& mat, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+
+        null_ = false;
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        checkParameters(nr, nc, kr, kc);
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromMatrix(mat, levels, numRows_, numCols_, 1, x, y);
+
+        size_type total = 0;
+        for (auto l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
+     *
+     * The actually used method depends on parameter mode.
+     */
+    KrKcTree(const RelationLists& lists, const size_type kr, const size_type kc, const int mode) {
+
+        null_ = false;
+
+        size_type maxCol = 0;
+        for (auto& row : lists) {
+            for (auto& elem : row) {
+                maxCol = std::max(maxCol, elem);
+            }
+        }
+        maxCol++; // for number of columns
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(lists.size(), kr_), logK(maxCol, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        switch (mode) {
+
+            case 0: { // 3.3.2.
+
+                std::vector<std::vector<bool>> levels(h_);
+                std::vector<RelationList::const_iterator> cursors;
+                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
+                    cursors.push_back(iter->begin());
+                }
+
+                buildFromLists(lists, cursors, levels, numRows_, numCols_, 1, 0, 0);
+
+                size_type total = 0;
+                for (auto l = 0; l < h_ - 1; l++) {
+                    total += levels[l].size();
+                }
+                T_ = bit_vector_type(total);
+
+                bit_vector_type::iterator outIter = T_.begin();
+                for (size_type l = 0; l < h_ - 1; l++) {
+
+                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                    levels[l].clear();
+                    levels[l].shrink_to_fit();
+
+                }
+
+                L_ = bit_vector_type(levels[h_ - 1].size());
+                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+                levels[h_ - 1].clear();
+                levels[h_ - 1].shrink_to_fit();
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 1: { // 3.3.3.
+
+                buildFromListsViaTree(lists);
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 2: { // 3.3.4.
+
+                buildFromListsDynamicBitmaps(lists);
+
+                break;
+
+            }
+
+            default: {
+
+                buildFromListsDynamicBitmaps(lists);
+                break;
+
+            }
+
+        }
+
+    }
+
+    /**
+     * List-of-lists-based constructor similar to the one above, but only a part of the relation matrix is used:
+     *  x = first row of the submatrix
+     *  y = first column of the submatrix
+     *  nr = number of rows of the submatrix
+     *  nc = number of columns of the submatrix
+     */
+    KrKcTree(const RelationLists& lists, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type kr, const size_type kc, const int mode) {
+
+        null_ = false;
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        checkParameters(nr, nc, kr, kc);
+
+        switch (mode) {
+
+            case 0: { // 3.3.2.
+
+                std::vector<std::vector<bool>> levels(h_);
+                std::vector<RelationList::const_iterator> cursors;
+                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
+
+                    cursors.push_back(iter->begin());
+                    auto& rowIter = cursors.back();
+                    while ((rowIter != iter->end()) && (*rowIter < y)) {
+                        rowIter++;
+                    }
+
+                }
+
+                buildFromLists(lists, cursors, levels, numRows_, numCols_, 1, x, y);
+
+                size_type total = 0;
+                for (auto l = 0; l < h_ - 1; l++) {
+                    total += levels[l].size();
+                }
+                T_ = bit_vector_type(total);
+
+                bit_vector_type::iterator outIter = T_.begin();
+                for (size_type l = 0; l < h_ - 1; l++) {
+
+                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                    levels[l].clear();
+                    levels[l].shrink_to_fit();
+
+                }
+
+                L_ = bit_vector_type(levels[h_ - 1].size());
+                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+                levels[h_ - 1].clear();
+                levels[h_ - 1].shrink_to_fit();
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 1: { // 3.3.3.
+
+                buildFromListsViaTree(lists, x, y, nr, nc);
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 2: { // 3.3.4.
+
+                buildFromListsDynamicBitmaps(lists, x, y, nr, nc);
+
+                break;
+
+            }
+
+            default: {
+
+                buildFromListsDynamicBitmaps(lists, x, y, nr, nc);
+                break;
+
+            }
+
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     */
+    KrKcTree(positions_type& pairs, const size_type kr, const size_type kc) {
+
+        null_ = false;
+
+        size_type maxRow = 0;
+        size_type maxCol = 0;
+        for (auto p : pairs) {
+            maxRow = std::max(maxRow, p.first);
+            maxCol = std::max(maxCol, p.second);
+        }
+
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(maxRow + 1, kr_), logK(maxCol + 1, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        if (pairs.size() != 0) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-pairs-based constructor similar to the one above, but only a part of the relation matrix is used:
+     *  x = first row of the submatrix
+     *  y = first column of the submatrix
+     *  nr = number of rows of the submatrix
+     *  nc = number of columns of the submatrix
+     */
+    KrKcTree(positions_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc) {
+
+        null_ = false;
+
+        kr_ = kr;
+        kc_ = kc;
+        checkArity();
+        h_ = std::max({(size_type)1, logK(nr, kr_), logK(nc, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        checkParameters(nr, nc, kr, kc);
+
+        if (l != r) {
+            buildFromListsInplace(pairs, x, y, nr, nc, l, r);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+
+    // returns the height of the K2Tree
+    size_type getH() const {
+        return h_;
+    }
+
+    // returns the row arity of the K2Tree
+    size_type getKr() const {
+        return kr_;
+    }
+
+    // returns the column arity of the K2Tree
+    size_type getKc() const {
+        return kc_;
+    }
+
+    size_type getNumRows() const override {
+        return numRows_;
+    }
+
+    size_type getNumCols() const override {
+        return numCols_;
+    }
+
+    elem_type getNull() const override {
+        return null_;
+    }
+
+
+    bool areRelated(size_type i, size_type j) const override {
+        return checkLinkInit(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+
+        std::vector<size_type> succs;
+//        successorsInit(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
+
+        return succs;
+
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+
+        std::vector<size_type> preds;
+        predecessorsInit(preds, j);
+
+        return preds;
+
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        rangeInit(pairs, i1, i2, j1, j2);
+//        rangeInit(pairs, i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
+
+        return pairs;
+
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return linkInRangeInit(i1, i2, j1, j2);
+//        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
+    }
+
+    size_type countLinks() const override {
+
+        size_type res = 0;
+        for (auto i = 0; i < L_.size(); i++) {
+            res += L_[i];
+        }
+
+        return res;
+
+    }
+
+
+    /*
+     * General methods for completeness' sake (are redundant / useless for bool)
+     */
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return areRelated(i, j);
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+        return areRelated(i, j);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+        return std::vector<elem_type>(getSuccessors(i).size(), true);
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+        return getSuccessors(i);
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        auto pos = getSuccessors(i);
+
+        pairs_type succs;
+        for (auto j : pos) {
+            succs.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+        return std::vector<elem_type>(getPredecessors(j).size(), true);
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+        return getPredecessors(j);
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        auto pos = getPredecessors(j);
+
+        pairs_type preds;
+        for (auto i : pos) {
+            preds.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getRange(i1, i2, j1, j2);
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        auto pos = getRange(i1, i2, j1, j2);
+
+        pairs_type pairs;
+        for (auto& p : pos) {
+            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
+        }
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return std::vector<elem_type>(countLinks(), true);
+    }
+
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
+
+        return pairs;
+
+    }
+
+    pairs_type getAllValuedPositions() const override {
+
+        pairs_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(ValuedPosition<elem_type>(i, j, true)); });
+
+        return pairs;
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return linkInRangeInit(i1, i2, j1, j2);
+//        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
+    }
+
+    size_type countElements() const override {
+        return countLinks();
+    }
+
+
+    KrKcTree* clone() const override {
+        return new KrKcTree(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "h  = " << h_ << std::endl;
+        std::cout << "kr  = " << kr_ << std::endl;
+        std::cout << "kc  = " << kc_ << std::endl;
+        std::cout << "numRows = " << numRows_ << std::endl;
+        std::cout << "numCols = " << numCols_ << std::endl;
         std::cout << "null = " << null_ << std::endl;
 
-        if (all) {
+        if (all) {
+
+            std::cout << "### T ###" << std::endl;
+            for (auto i = 0; i < T_.size(); i++) std::cout << T_[i];
+            std::cout << std::endl << std::endl;
+
+            std::cout << "### L ###" << std::endl;
+            for (auto i = 0; i < L_.size(); i++) std::cout << L_[i];
+            std::cout << std::endl << std::endl;
+
+            std::cout << "### R ###" << std::endl;
+            printRanks(R_);
+            std::cout << std::endl;
+
+        }
+
+    }
+
+    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void setNull(size_type i, size_type j) override {
+        setInit(i, j);
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+//        return firstSuccessorInit(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void multiply(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<false>(x, y, 1);
+    }
+
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<true>(x, y, 1);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+    // multi-threaded version of multiply(), the top-level row bands are distributed among numThreads threads
+    void multiply(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<false>(x, y, numThreads);
+    }
+
+    // multi-threaded version of multiplyTransposed(), the top-level column bands are distributed among numThreads threads
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<true>(x, y, numThreads);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j, true); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j, true); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i) with (i,j) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    KrKcTree<bool, KC, KR>* transpose() const {
+        return transposeInit();
+    }
+
+
+    /*
+     * Set operations on K2Trees with the same parameters (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this or the other relation
+    // (with the values of this relation for pairs in both)
+    KrKcTree* unite(const KrKcTree& other) const {
+        return combineInit(other, SET_UNION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in both relations (with the values of this relation)
+    KrKcTree* intersect(const KrKcTree& other) const {
+        return combineInit(other, SET_INTERSECTION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this, but not in the other relation
+    KrKcTree* subtract(const KrKcTree& other) const {
+        return combineInit(other, SET_DIFFERENCE);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in exactly one of the relations
+    KrKcTree* symmetricDifference(const KrKcTree& other) const {
+        return combineInit(other, SET_SYMMETRIC_DIFFERENCE);
+    }
+
+
+    /*
+     * Boolean matrix multiplication (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the composition of this and the other relation, i.e. of all pairs (i,j)
+    // with (i,m) in this and (m,j) in the other relation for some m (the boolean matrix product);
+    // the top-level submatrices of the result are distributed among numThreads threads
+    // (requires other.kr == kc and the same height, the result has the arities kr and other.kc)
+    KrKcTree* compose(const KrKcTree& other, unsigned numThreads = 1) const {
+        return composeInit(other, numThreads);
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
+
+private:
+    // the transposed tree swaps the compile-time arities (cf. transpose())
+    template<typename, size_type, size_type> friend class KrKcTree;
+
+    // representation of all but the last levels of the K2Tree (internal structure)
+    bit_vector_type T_;
+
+    // representation of the last level of the K2Tree (actual values of the relation)
+    bit_vector_type L_;
+
+    // rank data structure for navigation in T_
+    rank_type R_;
+
+    size_type h_; // height of the K2Tree
+    size_type kr_; // row arity of the K2Tree
+    size_type kc_; // column arity of the K2Tree
+    size_type numRows_; // number of rows in the represented relation matrix
+    size_type numCols_; // number of columns in the represented relation matrix
+
+    elem_type null_; // null element
+
+
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((KR > 0) && ((kr_ != KR) || (kc_ != KC))) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arities (kr, kc) have to be equal to the compile-time arities (KR, KC)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
+    /* helper method to check the feasibility of the tree parameters prior to construction */
+
+    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) const {
+
+        if ((numRows_ != nr) || (numCols_ != nc)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The numbers of rows (nr) and columns (nc) have to be powers of kr resp. kc (using the same exponent h)." +
+                              "But you gave me: nr = " + std::to_string(nr) + ", nc = " = std::to_string(nc) +
+                                                                                          ", kr = " + std::to_string(kr) + " and kc = " + std::to_string(kc) + " leading to h = " + std::to_string(h_) +
+                                                                                          " and " + std::to_string(numRows_) + " rows resp. " + std::to_string(numCols_) + " columns."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
+    /* helper method for construction from relation matrix */
+
+    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (auto i = 0; i < kr_; i++) {
+                for (auto j = 0; j < kc_; j++) {
+                    C.push_back((((p + i) < mat.size()) && ((q + j) < mat[0].size())) ? mat[p + i][q + j] : false);
+                }
+            }
+
+        } else {
+
+            for (auto i = 0; i < kr_; i++) {
+                for (auto j = 0; j < kc_; j++) {
+                    C.push_back(buildFromMatrix(mat, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_)));
+                }
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
+    /* helper method for construction from relation lists */
+
+    bool buildFromLists(const RelationLists& lists, std::vector<RelationList::const_iterator>& cursors, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.2
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (auto i = 0; i < kr_; i++) {
+                for (auto j = 0; j < kc_; j++) {
+
+                    C.push_back(((p + i) < lists.size()) && (cursors[p + i] != lists[p + i].end()) && ((q + j) == *(cursors[p + i])));
+                    if (C.back()) cursors[p + i]++;
+
+                }
+            }
+
+        } else {
+
+            for (auto i = 0; i < kr_; i++) {
+                for (auto j = 0; j < kc_; j++) {
+                    C.push_back(buildFromLists(lists, cursors, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_)));
+                }
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
+    /* helper methods for construction from relation lists via temporary tree */
+
+    void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
+
+        Node<bool>* root = new Node<bool>(false);
+
+        for (size_type i = 0; i < lists.size(); i++) {
+            for (size_type j = 0; j < lists[i].size(); j++) {
+                insert(root, numRows_, numCols_, i, lists[i][j]);
+            }
+        }
+
+        if (!root->isLeaf()) {
+
+            std::vector<bool> T, L;
+
+            // traverse over tree and generate T and L while doing it
+            std::queue<Node<bool>*> queue;
+            Node<bool>* node;
+            Node<bool>* child;
+            queue.push(root);
+
+            while (!queue.empty()) {
+
+                node = queue.front();
+                queue.pop();
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    child = node->getChild(i);
+
+                    if (child != 0 && child->isLeaf()) {
+                        L.push_back(child->getLabel());
+                    } else {
+
+                        T.push_back(child != 0);
+
+                        if (T.back()) {
+                            queue.push(child);
+                        }
+
+                    }
+
+                }
+
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        delete root;
+
+    }
+
+    void buildFromListsViaTree(const RelationLists& lists, size_type x, size_type y, size_type nr, size_type nc) {// 3.3.3, so far without special bit vectors without initialisation
+
+        Node<bool>* root = new Node<bool>(false);
+
+        for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
+            for (size_type j = 0; j < lists[i].size(); j++) {
+                if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
+                    insert(root, nr, nc, i - x, lists[i][j] - y);
+                }
+            }
+        }
+
+        if (!root->isLeaf()) {
+
+            std::vector<bool> T, L;
+
+            // traverse over tree and generate T and L while doing it
+            std::queue<Node<bool>*> queue;
+            Node<bool>* node;
+            Node<bool>* child;
+            queue.push(root);
+
+            while (!queue.empty()) {
+
+                node = queue.front();
+                queue.pop();
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    child = node->getChild(i);
+
+                    if (child != 0 && child->isLeaf()) {
+                        L.push_back(child->getLabel());
+                    } else {
+
+                        T.push_back(child != 0);
+
+                        if (T.back()) {
+                            queue.push(child);
+                        }
+
+                    }
+
+                }
+
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        delete root;
+
+    }
+
+    void insert(Node<bool>* node, size_type numRows, size_type numCols, size_type p, size_type q) {
+
+        if (numRows == kr_) { // alternatively, numCols == kc_; occurs (currently) at the same time since we use the same height in both dimensions
+
+            if (node->isLeaf()) {
+                node->turnInternal(kr_ * kc_, true);
+            }
+
+            node->addChild(p * kc_ + q, true);
+
+        } else {
+
+            if (node->isLeaf()) {
+                node->turnInternal(kr_ * kc_, false);
+            }
+
+            size_type z = (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+
+            insert(node->hasChild(z) ? node->getChild(z) : node->addChild(z, true), numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_));
+
+        }
+
+    }
+
+    /* helper methods for construction from relation lists via dynamic bitmap representations */
+
+    void buildFromListsDynamicBitmaps(const RelationLists& lists) {// 3.3.4, currently no succinct dynamic bitmaps
+
+        if (h_ == 1) {
+
+            L_ = bit_vector_type(kr_ * kc_, 0);
+
+            for (size_type i = 0; i < lists.size(); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    L_[i * kc_ + lists[i][j]] = 1;
+                }
+            }
+
+            if (isAllZero(L_)) {
+                L_ = bit_vector_type(0);
+            }
+
+        } else {
+
+            std::vector<bool> T, L;
+            NaiveDynamicRank R;
+
+            for (size_type i = 0; i < lists.size(); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    insertInit(T, L, R, i, lists[i][j]);
+                }
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    void buildFromListsDynamicBitmaps(const RelationLists& lists, size_type x, size_type y, size_type nr, size_type nc) {// 3.3.4, currently no succinct dynamic bitmaps
+
+        if (h_ == 1) {
+
+            L_ = bit_vector_type(kr_ * kc_, 0);
+
+            for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
+                        L_[(i - x) * kc_ + lists[i][j] - y] = 1;
+                    }
+                }
+            }
+
+            if (isAllZero(L_)) {
+                L_ = bit_vector_type(0);
+            }
+
+        } else {
+
+            std::vector<bool> T, L;
+            NaiveDynamicRank R;
+
+            for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
+                        insertInit(T, L, R, i - x, lists[i][j] - y);
+                    }
+                }
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+
+        if (T.empty()) {
+
+            T = std::vector<bool>(kr_ * kc_);
+            R = NaiveDynamicRank(T);
+
+        }
+
+        insert(T, L, R, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_), 1);
+
+    }
+
+    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) {
+
+        if (!T[z]) {
+
+            T[z] = 1;
+            R.increaseFrom(z + 1);
+
+            size_type y = R.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+
+            if ((l + 1) == h_) {
+
+                L.insert(L.begin() + R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, 0);
+                L[y - T.size()] = 1;
+
+            } else {
+
+                T.insert(T.begin() + R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
+                R.insert(R.rank(z + 1) * kr_ * kc_ + 1, kr_ * kc_);
+
+                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y, l + 1);
+
+            }
+
+        } else {
+
+            size_type y = R.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+
+            if ((l + 1) == h_) {
+                L[y - T.size()] = 1;
+            } else {
+                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y, l + 1);
+            }
+
+        }
+
+    }
+
+    /* helper methods for inplace construction from single list of pairs */
+
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
+        return ((pair.first - sp.firstRow) / widthRow) * kc_ + (pair.second - sp.firstCol) / widthCol;
+    }
+
+    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
+
+        std::vector<size_type> counts(sup);
+
+        // determine key frequencies
+        for (auto i = sp.left; i < sp.right; i++) {
+            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+        }
+
+        // determine starting index for each key
+        size_type total = 0;
+        size_type tmp;
+
+        for (auto key = 0; key < sup; key++) {
+
+            tmp = counts[key];
+            counts[key] = total;
+            total += tmp;
+
+            intervals[key].first = counts[key];
+            intervals[key].second = total;
+
+        }
+
+        // reorder pairs of current subproblem
+        positions_type tmpPairs(sp.right - sp.left + 1);
+        for (auto i = sp.left; i < sp.right; i++) {
+
+            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
+            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+
+        }
+
+        for (auto i = sp.left; i < sp.right; i++) {
+            pairs[i] = tmpPairs[i - sp.left];
+        }
+
+    }
+
+    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+
+        std::queue<Subproblem> queue;
+        Subproblem sp;
+        size_type Sr, Sc;
+        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
+        std::vector<bool> T, L;
+        bit_vector_type appToL;
+
+        queue.push(Subproblem(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size()));
+
+        while (!queue.empty()) {
+
+            sp = queue.front();
+            queue.pop();
+
+            Sr = sp.lastRow - sp.firstRow + 1;
+            Sc = sp.lastCol - sp.firstCol + 1;
+
+            if (Sr > kr_) {
+
+                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    if (intervals[i].first < intervals[i].second) {
+
+                        T.push_back(true);
+                        queue.push(Subproblem(
+                                sp.firstRow + (i / kc_) * (Sr / kr_),
+                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
+                                sp.firstCol + (i % kc_) * (Sc / kc_),
+                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
+                                sp.left + intervals[i].first,
+                                sp.left + intervals[i].second
+                        ));
+
+                    } else {
+                        T.push_back(false);
+                    }
+
+                }
+
+            } else {
+
+                appToL = bit_vector_type(kr_ * kc_);
+
+                for (size_type i = sp.left; i < sp.right; i++) {
+                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
+                }
+
+                L.insert(L.end(), appToL.begin(), appToL.end());
+
+            }
+
+        }
+
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
+
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
+
+    }
+
+    void buildFromListsInplace(positions_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r) {// 3.3.5
+
+        std::queue<Subproblem> queue;
+        Subproblem sp;
+        size_type Sr, Sc;
+        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
+        std::vector<bool> T, L;
+        bit_vector_type appToL;
+
+        queue.push(Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
+
+        while (!queue.empty()) {
+
+            sp = queue.front();
+            queue.pop();
+
+            Sr = sp.lastRow - sp.firstRow + 1;
+            Sc = sp.lastCol - sp.firstCol + 1;
+
+            if (Sr > kr_) {
+
+                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    if (intervals[i].first < intervals[i].second) {
+
+                        T.push_back(true);
+                        queue.push(Subproblem(
+                                sp.firstRow + (i / kc_) * (Sr / kr_),
+                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
+                                sp.firstCol + (i % kc_) * (Sc / kc_),
+                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
+                                sp.left + intervals[i].first,
+                                sp.left + intervals[i].second
+                        ));
+
+                    } else {
+                        T.push_back(false);
+                    }
 
-            std::cout << "### T ###" << std::endl;
-            for (auto i = 0; i < T_.size(); i++) std::cout << T_[i];
-            std::cout << std::endl << std::endl;
+                }
 
-            std::cout << "### L ###" << std::endl;
-            for (auto i = 0; i < L_.size(); i++) std::cout << L_[i];
-            std::cout << std::endl << std::endl;
+            } else {
 
-            std::cout << "### R ###" << std::endl;
-            printRanks(R_);
-            std::cout << std::endl;
+                appToL = bit_vector_type(kr_ * kc_);
+
+                for (size_type i = sp.left; i < sp.right; i++) {
+                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
+                }
+
+                L.insert(L.end(), appToL.begin(), appToL.end());
+
+            }
 
         }
 
-    }
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
-    void setNull(size_type i, size_type j) override {
-        setInit(i, j);
-    }
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-    size_type getFirstSuccessor(size_type i) override {
-//        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
     }
 
 
+    /* areRelated() */
 
-private:
-    // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    bool checkLinkInit(size_type p, size_type q) const {
 
-    // representation of the last level of the K2Tree (actual values of the relation)
-    bit_vector_type L_;
+        if (KR > 0) {
 
-    // rank data structure for navigation in T_
-    rank_type R_;
+            size_type z;
+            return !L_.empty() && descend(p, q, z) && L_[z - T_.size()];
 
-    size_type h_; // height of the K2Tree
-    size_type kr_; // row arity of the K2Tree
-    size_type kc_; // column arity of the K2Tree
-    size_type numRows_; // number of rows in the represented relation matrix
-    size_type numCols_; // number of columns in the represented relation matrix
+        }
 
-    elem_type null_; // null element
+        return (L_.empty()) ? false : checkLink(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+
+    }
 
+    bool checkLink(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
-    /* helper method to check the feasibility of the tree parameters prior to construction */
+        if (z >= T_.size()) {
+            return L_[z - T_.size()];
+        } else {
+            return T_[z] ? checkLink(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
+        }
 
-    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+    }
 
-        if ((numRows_ != nr) || (numCols_ != nc)) {
+    /* isNotNull(), getElement() and areRelated() with compile-time arities */
 
-            std::string err = std::string() +
-                              "Unsuitable parameters! " +
-                              "The numbers of rows (nr) and columns (nc) have to be powers of kr resp. kc (using the same exponent h)." +
-                              "But you gave me: nr = " + std::to_string(nr) + ", nc = " = std::to_string(nc) +
-                                                                                          ", kr = " + std::to_string(kr) + " and kc = " + std::to_string(kc) + " leading to h = " + std::to_string(h_) +
-                                                                                          " and " + std::to_string(numRows_) + " rows resp. " + std::to_string(numCols_) + " columns."
-            ;
+    // descends to the leaf of (p, q) using shifts and masks instead of divisions (requires KR, KC > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type p, size_type q, size_type& z) const {
 
-            throw std::runtime_error(err);
+        const size_type logKr = log2Pow2(KR);
+        const size_type logKc = log2Pow2(KC);
+        size_type sr = (h_ - 1) * logKr; // log2(numRows / KR) on the current level
+        size_type sc = (h_ - 1) * logKc; // log2(numCols / KC) on the current level
+
+        z = (p >> sr) * KC + (q >> sc);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            sr -= logKr;
+            sc -= logKc;
+            z = R_.rank(z + 1) * KR * KC + ((p >> sr) & (KR - 1)) * KC + ((q >> sc) & (KC - 1));
 
         }
 
+        return true;
+
     }
 
-    /* helper method for construction from relation matrix */
+    /* getSuccessors() */
 
-    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
 
-        std::vector<bool> C;
+        if (L_.empty()) return;
 
-        if (l == h_) {
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
+        size_type lenT = T_.size();
 
-            for (auto i = 0; i < kr_; i++) {
-                for (auto j = 0; j < kc_; j++) {
-                    C.push_back((((p + i) < mat.size()) && ((q + j) < mat[0].size())) ? mat[p + i][q + j] : false);
-                }
-            }
+        if (lenT == 0) {
+
+            size_type offset = p * numCols_;
+            forEachSetBit(L_, offset, numCols_, [&](size_type i) { succs.push_back(i); });
 
         } else {
 
-            for (auto i = 0; i < kr_; i++) {
-                for (auto j = 0; j < kc_; j++) {
-                    C.push_back(buildFromMatrix(mat, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_)));
-                }
+            // successorsPosInit
+            size_type nr = numRows_/ kr_;
+            size_type nc = numCols_/ kc_;
+            size_type relP = p;
+            for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
+                queue.emplace_back(dq, z);
             }
 
-        }
+            // successorsPos
+            relP %= nr;
+            nr /= kr_;
+            nc /= kc_;
+            for (; nr > 1; relP %= nr, nr /= kr_, nc /= kc_) {
 
-        if (isAllZero(C)) {
-            return false;
-        } else {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
-            return true;
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
-        }
+                    if (T_[cur.z]) {
 
-    }
+                        auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
-    /* helper method for construction from relation lists */
+                        forEachSetBit(T_, y, kc_, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * nc, y + j); });
 
-    bool buildFromLists(const RelationLists& lists, std::vector<RelationList::const_iterator>& cursors, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.2
+                    }
 
-        std::vector<bool> C;
+                }
 
-        if (l == h_) {
+                queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
-            for (auto i = 0; i < kr_; i++) {
-                for (auto j = 0; j < kc_; j++) {
+            }
 
-                    C.push_back(((p + i) < lists.size()) && (cursors[p + i] != lists[p + i].end()) && ((q + j) == *(cursors[p + i])));
-                    if (C.back()) cursors[p + i]++;
+
+            for (size_type i = 0; i < queue.size(); i++) {
+
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
+
+                if (T_[cur.z]) {
+
+                    auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
+
+                    forEachSetBit(L_, y, kc_, [&](size_type j) { succs.push_back(cur.dq + j * nc); });
 
                 }
+
             }
 
-        } else {
+        }
 
-            for (auto i = 0; i < kr_; i++) {
-                for (auto j = 0; j < kc_; j++) {
-                    C.push_back(buildFromLists(lists, cursors, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_)));
-                }
+    }
+
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
+
+        if (!L_.empty()) {
+
+            size_type y = kc_ * (p / (numRows_ / kr_));
+
+            for (size_type j = 0; j < kc_; j++) {
+                successors(succs, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j);
             }
 
         }
 
-        if (isAllZero(C)) {
-            return false;
+    }
+
+    void successors(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                succs.push_back(q);
+            }
+
         } else {
 
-            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
-            return true;
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
+
+                for (size_type j = 0; j < kc_; j++) {
+                    successors(succs, numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j);
+                }
+
+            }
 
         }
 
+
     }
 
-    /* helper methods for construction from relation lists via temporary tree */
+    /* getFirstSuccessor() */
 
-    void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
 
-        Node<bool>* root = new Node<bool>(false);
+        if (L_.empty()) return numCols_;
 
-        for (size_type i = 0; i < lists.size(); i++) {
-            for (size_type j = 0; j < lists[i].size(); j++) {
-                insert(root, numRows_, numCols_, i, lists[i][j]);
+        if (T_.size() == 0) {
+
+            size_type offset = p * numCols_;
+            for (size_type i = 0; i < numCols_; i++) {
+                if (L_[offset + i]) {
+                    return i;
+                }
             }
-        }
 
-        if (!root->isLeaf()) {
+        } else {
 
-            std::vector<bool> T, L;
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
 
-            // traverse over tree and generate T and L while doing it
-            std::queue<Node<bool>*> queue;
-            Node<bool>* node;
-            Node<bool>* child;
-            queue.push(root);
+            while (!stack.empty()) {
 
-            while (!queue.empty()) {
+                auto& cur = stack.back();
 
-                node = queue.front();
-                queue.pop();
+                if (cur.j == kc_) {
+                    stack.pop_back();
+                } else {
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+                    if (cur.z >= T_.size()) {
 
-                    child = node->getChild(i);
+                        if (L_[cur.z - T_.size()]) {
+                            return cur.dq;
+                        }
 
-                    if (child != 0 && child->isLeaf()) {
-                        L.push_back(child->getLabel());
                     } else {
 
-                        T.push_back(child != 0);
-
-                        if (T.back()) {
-                            queue.push(child);
+                        if (T_[cur.z]) {
+                            stack.emplace_back(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
                         }
 
                     }
 
+                    cur.dq += cur.nc;
+                    cur.z++;
+                    cur.j++;
+
                 }
 
             }
+        }
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+        return numCols_;
 
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+    }
+
+    size_type firstSuccessorInit(size_type p) const {
+
+        size_type pos = numCols_;
+
+        if (!L_.empty()) {
+
+            size_type y = kc_ * (p / (numRows_ / kr_));
+
+            for (size_type j = 0; j < kc_ && pos == numCols_; j++) {
+                pos = firstSuccessor(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j);
+            }
 
         }
 
-        delete root;
+        return pos;
 
     }
 
-    void buildFromListsViaTree(const RelationLists& lists, size_type x, size_type y, size_type nr, size_type nc) {// 3.3.3, so far without special bit vectors without initialisation
+    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
-        Node<bool>* root = new Node<bool>(false);
+        size_type pos = numCols_;
 
-        for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
-            for (size_type j = 0; j < lists[i].size(); j++) {
-                if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
-                    insert(root, nr, nc, i - x, lists[i][j] - y);
-                }
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                pos = q;
             }
-        }
 
-        if (!root->isLeaf()) {
+        } else {
 
-            std::vector<bool> T, L;
+            if (T_[z]) {
 
-            // traverse over tree and generate T and L while doing it
-            std::queue<Node<bool>*> queue;
-            Node<bool>* node;
-            Node<bool>* child;
-            queue.push(root);
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
-            while (!queue.empty()) {
+                for (size_type j = 0; j < kc_ && pos == numCols_; j++) {
+                    pos = firstSuccessor(numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j);
+                }
 
-                node = queue.front();
-                queue.pop();
+            }
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+        }
 
-                    child = node->getChild(i);
+        return pos;
 
-                    if (child != 0 && child->isLeaf()) {
-                        L.push_back(child->getLabel());
-                    } else {
+    }
 
-                        T.push_back(child != 0);
+    /* getPredecessors() */
 
-                        if (T.back()) {
-                            queue.push(child);
-                        }
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
 
-                    }
+        if (!L_.empty()) {
 
-                }
+            size_type y = q / (numCols_ / kc_);
 
+            for (size_type i = 0; i < kr_; i++) {
+                predecessors(preds, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_);
             }
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
-
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
-
         }
 
-        delete root;
-
     }
 
-    void insert(Node<bool>* node, size_type numRows, size_type numCols, size_type p, size_type q) {
+    void predecessors(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
-        if (numRows == kr_) { // alternatively, numCols == kc_; occurs (currently) at the same time since we use the same height in both dimensions
+        if (z >= T_.size()) {
 
-            if (node->isLeaf()) {
-                node->turnInternal(kr_ * kc_, true);
+            if (L_[z - T_.size()]) {
+                preds.push_back(p);
             }
 
-            node->addChild(p * kc_ + q, true);
-
         } else {
 
-            if (node->isLeaf()) {
-                node->turnInternal(kr_ * kc_, false);
-            }
+            if (T_[z]) {
 
-            size_type z = (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
-            insert(node->hasChild(z) ? node->getChild(z) : node->addChild(z, true), numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_));
+                for (size_type i = 0; i < kr_; i++) {
+                    predecessors(preds, numRows / kr_, numCols / kc_,  q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_);
+                }
+
+            }
 
         }
 
     }
 
-    /* helper methods for construction from relation lists via dynamic bitmap representations */
+    /* getFirstPredecessorIn() */
 
-    void buildFromListsDynamicBitmaps(const RelationLists& lists) {// 3.3.4, currently no succinct dynamic bitmaps
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
 
-        if (h_ == 1) {
+        if (!L_.empty()) {
 
-            L_ = bit_vector_type(kr_ * kc_, 0);
+            size_type y = q / (numCols_ / kc_);
 
-            for (size_type i = 0; i < lists.size(); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    L_[i * kc_ + lists[i][j]] = 1;
+            for (size_type i = 0; i < kr_; i++) {
+
+                auto p = firstPredecessorIn(rows, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_);
+
+                if (p < numRows_) {
+                    return p;
                 }
-            }
 
-            if (isAllZero(L_)) {
-                L_ = bit_vector_type(0);
             }
 
-        } else {
-
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+        }
 
-            for (size_type i = 0; i < lists.size(); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    insertInit(T, L, R, i, lists[i][j]);
-                }
-            }
+        return numRows_;
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+    }
 
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+    // same descent as in predecessors(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
+        if (z >= T_.size()) {
+            return (L_[z - T_.size()] && rows[p]) ? p : numRows_;
         }
 
-        R_ = rank_type(&T_);
-
-    }
+        if (T_[z]) {
 
-    void buildFromListsDynamicBitmaps(const RelationLists& lists, size_type x, size_type y, size_type nr, size_type nc) {// 3.3.4, currently no succinct dynamic bitmaps
+            size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
-        if (h_ == 1) {
+            for (size_type i = 0; i < kr_; i++) {
 
-            L_ = bit_vector_type(kr_ * kc_, 0);
+                auto res = firstPredecessorIn(rows, numRows / kr_, numCols / kc_, q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_);
 
-            for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
-                        L_[(i - x) * kc_ + lists[i][j] - y] = 1;
-                    }
+                if (res < numRows_) {
+                    return res;
                 }
-            }
 
-            if (isAllZero(L_)) {
-                L_ = bit_vector_type(0);
             }
 
-        } else {
+        }
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+        return numRows_;
 
-            for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    if ((y <= lists[i][j]) && (lists[i][j] < (y + nc))) {
-                        insertInit(T, L, R, i - x, lists[i][j] - y);
-                    }
-                }
-            }
+    }
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+    /* getRange() */
 
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        }
+        if (!L_.empty()) {
 
-        R_ = rank_type(&T_);
+            size_type p1Prime, p2Prime;
 
-    }
+            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
 
-        if (T.empty()) {
+                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+                    range(
+                            pairs,
+                            numRows_ / kr_,
+                            numCols_ / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
+                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
+                            (numRows_ / kr_) * i,
+                            (numCols_ / kc_) * j,
+                            kc_ * i + j
+                    );
+                }
 
-            T = std::vector<bool>(kr_ * kc_);
-            R = NaiveDynamicRank(T);
+            }
 
         }
 
-        insert(T, L, R, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_), 1);
-
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) {
+    void range(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
-        if (!T[z]) {
+        if (z >= T_.size()) {
 
-            T[z] = 1;
-            R.increaseFrom(z + 1);
+            if (L_[z - T_.size()]) {
+                pairs.push_back(std::make_pair(dp, dq));
+            }
 
-            size_type y = R.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+        } else {
 
-            if ((l + 1) == h_) {
+            if (T_[z]) {
 
-                L.insert(L.begin() + R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, 0);
-                L[y - T.size()] = 1;
+                auto y = R_.rank(z + 1) * kr_ * kc_;
 
-            } else {
+                if (y >= T_.size()) {
 
-                T.insert(T.begin() + R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
-                R.insert(R.rank(z + 1) * kr_ * kc_ + 1, kr_ * kc_);
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+                        forEachSetBit(L_, y - T_.size() + kc_ * i + q1, q2 - q1 + 1, [&](size_type j) { pairs.push_back(std::make_pair(dp + i, dq + q1 + j)); });
+                    }
 
-                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y, l + 1);
+                    return;
 
-            }
+                }
 
-        } else {
+                size_type p1Prime, p2Prime;
 
-            size_type y = R.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
+                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
 
-            if ((l + 1) == h_) {
-                L[y - T.size()] = 1;
-            } else {
-                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y, l + 1);
-            }
+                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+                    p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
 
-        }
+                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                        range(
+                                pairs,
+                                numRows / kr_,
+                                numCols / kc_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                                (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                                dp + (numRows / kr_) * i,
+                                dq + (numCols / kc_) * j,
+                                y + kc_ * i + j
+                        );
+                    }
 
-    }
+                }
 
-    /* helper methods for inplace construction from single list of pairs */
+            }
+
+        }
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
-        return ((pair.first - sp.firstRow) / widthRow) * kc_ + (pair.second - sp.firstCol) / widthCol;
     }
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    /* linkInRange() */
 
-        std::vector<size_type> counts(sup);
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        // determine key frequencies
-        for (auto i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
-        }
+        if (!L_.empty()) {
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+            // dividing by k_ (as stated in the paper) in not correct,
+            // because it does not use the size of the currently considered submatrix but of its submatrices
+            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
+                return 1;
+            }
 
-        for (auto key = 0; key < sup; key++) {
+            size_type p1Prime, p2Prime;
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? (p2 % (numRows_ / kr_)) : numRows_ / kr_ - 1;
 
-        }
+                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
 
-        // reorder pairs of current subproblem
-        positions_type tmpPairs(sp.right - sp.left + 1);
-        for (auto i = sp.left; i < sp.right; i++) {
+                    if (linkInRange(numRows_ / kr_, numCols_ / kc_, p1Prime, p2Prime, (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)), (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : numCols_ / kc_ - 1, kc_ * i + j)) {
+                        return true;
+                    }
 
-            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+                }
 
-        }
+            }
 
-        for (auto i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
         }
 
+        return false;
+
     }
 
-    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+    bool linkInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
-        std::vector<bool> T, L;
-        bit_vector_type appToL;
+        if (z >= T_.size()) {
 
-        queue.push(Subproblem(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size()));
+            return L_[z - T_.size()];
 
-        while (!queue.empty()) {
+        } else {
 
-            sp = queue.front();
-            queue.pop();
+            if (T_[z]) {
 
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
+                // dividing by k_ (as stated in the paper) in not correct,
+                // because it does not use the size of the currently considered submatrix but of its submatrices
+                if ((p1 == 0) && (q1 == 0) && (p2 == (numRows /*/ kr_*/ - 1)) && (q2 == (numCols /*/ kc_*/ - 1))) {
+                    return true;
+                }
 
-            if (Sr > kr_) {
+                auto y = R_.rank(z + 1) * kr_ * kc_;
+                size_type p1Prime, p2Prime;
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+                    p2Prime = (i == p2 / (numRows / kr_)) ? (p2 % (numRows / kr_)) : numRows / kr_ - 1;
 
-                    if (intervals[i].first < intervals[i].second) {
+                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
-                                sp.firstRow + (i / kc_) * (Sr / kr_),
-                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
-                                sp.firstCol + (i % kc_) * (Sc / kc_),
-                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
-                        ));
+                        if (linkInRange(numRows / kr_, numCols / kc_, p1Prime, p2Prime, (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)), (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1, y + kc_ * i + j)) {
+                            return true;
+                        }
 
-                    } else {
-                        T.push_back(false);
                     }
 
                 }
 
-            } else {
+            }
 
-                appToL = bit_vector_type(kr_ * kc_);
+            return false;
 
-                for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
-                }
+        }
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
+    }
 
-            }
 
-        }
+    /* setNull() */
 
-        L_ = bit_vector_type(L.size());
-        std::move(L.begin(), L.end(), L_.begin());
-        L.clear();
-        L.shrink_to_fit();
+    void setInit(size_type p, size_type q) {
 
-        T_ = bit_vector_type(T.size());
-        std::move(T.begin(), T.end(), T_.begin());
+        if (!L_.empty()) {
+            set(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+        }
 
     }
 
-    void buildFromListsInplace(positions_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r) {// 3.3.5
+    void set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
-        std::vector<bool> T, L;
-        bit_vector_type appToL;
+        if (z >= T_.size()) {
+            L_[z - T_.size()] = null_;
+        } else {
 
-        queue.push(Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
+            if (T_[z]) {
+                set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_));
+            }
 
-        while (!queue.empty()) {
+        }
 
-            sp = queue.front();
-            queue.pop();
+    }
 
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
 
-            if (Sr > kr_) {
+    /* multiply() / multiplyTransposed() */
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+    template<bool Transposed>
+    void multiplyInit(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+        std::fill(y.begin(), y.end(), 0.0);
 
-                    if (intervals[i].first < intervals[i].second) {
+        if (L_.empty()) return;
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
-                                sp.firstRow + (i / kc_) * (Sr / kr_),
-                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
-                                sp.firstCol + (i % kc_) * (Sc / kc_),
-                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
-                        ));
+        if ((numThreads <= 1) || (T_.size() == 0)) {
 
-                    } else {
-                        T.push_back(false);
-                    }
+            multiplyBlock<Transposed>(x, y, numRows_ / kr_, numCols_ / kc_, 0, 0, 0);
+            return;
 
-                }
+        }
 
-            } else {
+        // determine the submatrices on the shallowest level that provides enough row (column) bands for all threads
+        size_type nr = numRows_ / kr_;
+        size_type nc = numCols_ / kc_;
+        size_type bands = Transposed ? kc_ : kr_;
+        std::vector<SubmatrixInfo> level, nextLevel;
+        for (size_type i = 0; i < kr_; i++) {
+            for (size_type j = 0; j < kc_; j++) {
+                level.push_back(SubmatrixInfo(i * nr, j * nc, i * kc_ + j));
+            }
+        }
 
-                appToL = bit_vector_type(kr_ * kc_);
+        for (; (bands < numThreads) && (nr > 1); nr /= kr_, nc /= kc_, bands *= (Transposed ? kc_ : kr_)) {
 
-                for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
-                }
+            for (auto& cur : level) {
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
+                if (T_[cur.z]) {
+
+                    size_type pos = R_.rank(cur.z + 1) * kr_ * kc_;
+
+                    for (size_type i = 0; i < kr_; i++) {
+                        for (size_type j = 0; j < kc_; j++) {
+                            nextLevel.push_back(SubmatrixInfo(cur.dp + i * (nr / kr_), cur.dq + j * (nc / kc_), pos + i * kc_ + j));
+                        }
+                    }
+
+                }
 
             }
 
+            level.swap(nextLevel);
+            nextLevel.clear();
+
         }
 
-        L_ = bit_vector_type(L.size());
-        std::move(L.begin(), L.end(), L_.begin());
-        L.clear();
-        L.shrink_to_fit();
+        // all submatrices of a band write to the same entries of y and are therefore processed by the same thread
+        std::stable_sort(level.begin(), level.end(), [](const SubmatrixInfo& a, const SubmatrixInfo& b) {
+            return Transposed ? (a.dq < b.dq) : (a.dp < b.dp);
+        });
 
-        T_ = bit_vector_type(T.size());
-        std::move(T.begin(), T.end(), T_.begin());
+        std::vector<size_type> bandStarts;
+        for (size_type t = 0; t < level.size(); t++) {
+            if ((t == 0) || (Transposed ? (level[t].dq != level[t - 1].dq) : (level[t].dp != level[t - 1].dp))) {
+                bandStarts.push_back(t);
+            }
+        }
+        bandStarts.push_back(level.size());
 
-    }
+        std::atomic<size_type> nextBand(0);
+        std::vector<std::thread> workers;
 
+        for (unsigned w = 0; w < numThreads; w++) {
+            workers.emplace_back([&]() {
+                for (size_type b = nextBand++; b + 1 < bandStarts.size(); b = nextBand++) {
+                    for (size_type t = bandStarts[b]; t < bandStarts[b + 1]; t++) {
+                        multiplyNode<Transposed>(x, y, nr, nc, level[t].dp, level[t].dq, level[t].z);
+                    }
+                }
+            });
+        }
 
-    /* areRelated() */
+        for (auto& w : workers) {
+            w.join();
+        }
 
-    bool checkLinkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : checkLink(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
     }
 
-    bool checkLink(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    template<bool Transposed>
+    void multiplyNode(const std::vector<double>& x, std::vector<double>& y, size_type numRows, size_type numCols, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
-        } else {
-            return T_[z] ? checkLink(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
-        }
 
-    }
+            if (L_[z - T_.size()]) {
+                y[Transposed ? dq : dp] += x[Transposed ? dp : dq];
+            }
 
-    /* getSuccessors() */
+        } else if (T_[z]) {
+            multiplyBlock<Transposed>(x, y, numRows / kr_, numCols / kc_, dp, dq, R_.rank(z + 1) * kr_ * kc_);
+        }
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    }
 
-        if (L_.empty()) return;
+    // processes the block of children starting at index z in the (conceptual concatenation of) T and L,
+    // numRows and numCols are the dimensions of the children
+    template<bool Transposed>
+    void multiplyBlock(const std::vector<double>& x, std::vector<double>& y, size_type numRows, size_type numCols, size_type dp, size_type dq, size_type z) const {
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
 
-        if (lenT == 0) {
+        if (z >= lenT) {
 
-            size_type offset = p * numCols_;
-            for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i]) {
-                    succs.push_back(i);
+            size_type pos = z - lenT;
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++, pos++) {
+                    if (L_[pos]) {
+                        y[Transposed ? dq + j : dp + i] += x[Transposed ? dp + i : dq + j];
+                    }
                 }
             }
 
         } else {
 
-            // successorsPosInit
-            size_type nr = numRows_/ kr_;
-            size_type nc = numCols_/ kc_;
-            size_type relP = p;
-            for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
-                queue.push(SubrowInfo(dq, z));
+            size_type pos = z;
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++, pos++) {
+                    if (T_[pos]) {
+                        multiplyBlock<Transposed>(x, y, numRows / kr_, numCols / kc_, dp + i * numRows, dq + j * numCols, R_.rank(pos + 1) * kr_ * kc_);
+                    }
+                }
             }
 
-            // successorsPos
-            relP %= nr;
-            nr /= kr_;
-            nc /= kc_;
-            for (; nr > 1; relP %= nr, nr /= kr_, nc /= kc_) {
+        }
 
-                while (!queue.empty()) {
+    }
 
-                    auto& cur = queue.front();
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
 
-                    if (T_[cur.z]) {
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
 
-                        auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
+        if (L_.empty()) return;
 
-                        for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+        size_type numLevels = h_ - 1;
+        size_type kSq = kr_ * kc_;
 
-                    }
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), nr(numLevels + 1, numRows_), nc(numLevels + 1, numCols_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
 
-                    queue.pop();
+        for (size_type l = 0; l < numLevels; l++) {
 
-                }
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * kSq;
+            nr[l + 1] = nr[l] / kr_;
+            nc[l + 1] = nc[l] / kc_;
 
-                queue.swap(nextLevelQueue);
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
 
-            }
+        }
 
+        size_type l = 0; // topmost level whose cursor has been moved
 
-            while (!queue.empty()) {
+        for (size_type y = 0; y < L_.size(); y += kSq) {
 
-                auto& cur = queue.front();
+            for (; l < numLevels; l++) {
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % kSq / kc_) * nr[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % kc_) * nc[l + 1];
+            }
 
-                if (T_[cur.z]) {
+            for (size_type z = 0; z < kSq; z++) {
+                if (L_[y + z]) {
+                    func(dp[numLevels] + z / kc_, dq[numLevels] + z % kc_, y + z);
+                }
+            }
 
-                    auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
 
-                    for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y]) {
-                            succs.push_back(newDq);
-                        }
-                    }
+                l--;
+                size_type block = (cur[l] - start[l]) / kSq;
 
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
                 }
 
-                queue.pop();
+                steps = (cur[l] - start[l]) / kSq - block;
 
             }
 
@@ -3433,361 +5298,495 @@ private:
 
     }
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
+
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of numRows_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
 
         if (!L_.empty()) {
 
-            size_type y = kc_ * (p / (numRows_ / kr_));
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
 
-            for (size_type j = 0; j < kc_; j++) {
-                successors(succs, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j);
-            }
+            rowMajorScan(func, frontiers, numRows_, numCols_, 0, 0);
 
         }
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the nr rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type nr, size_type nc, size_type dp, size_type l) const {
 
-        if (z >= T_.size()) {
+        for (size_type i = 0; i < kr_; i++) {
 
-            if (L_[z - T_.size()]) {
-                succs.push_back(q);
-            }
+            if (l == h_ - 1) {
 
-        } else {
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < kc_; j++) {
 
-            if (T_[z]) {
+                        auto y = node.z + i * kc_ + j - T_.size();
 
-                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
+                        if (L_[y]) {
+                            func(dp + i, node.dq + j, y);
+                        }
 
-                for (size_type j = 0; j < kc_; j++) {
-                    successors(succs, numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j);
+                    }
                 }
 
-            }
-
-        }
-
+            } else {
 
-    }
+                frontiers[l + 1].clear();
 
-    /* getFirstSuccessor() */
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < kc_; j++) {
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+                        auto z = node.z + i * kc_ + j;
 
-        if (L_.empty()) return numCols_;
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (nr / kr_), node.dq + j * (nc / kc_), R_.rank(z + 1) * kr_ * kc_));
+                        }
 
-        if (T_.size() == 0) {
+                    }
+                }
 
-            size_type offset = p * numCols_;
-            for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i]) {
-                    return i;
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, nr / kr_, nc / kc_, dp + i * (nr / kr_), l + 1);
                 }
+
             }
 
-        } else {
+        }
+
+    }
+
+    /* toCSR(), toCSC() */
+
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
+
+        offsets.assign((Transposed ? numCols_ : numRows_) + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
+
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
 
-            while (!stack.empty()) {
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type) {
 
-                auto& cur = stack.top();
+            auto pos = offsets[Transposed ? j : i]++;
 
-                if (cur.j == kc_) {
-                    stack.pop();
-                } else {
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = true;
 
-                    if (cur.z >= T_.size()) {
+        });
 
-                        if (L_[cur.z - T_.size()]) {
-                            return cur.dq;
-                        }
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
 
-                    } else {
+    }
 
-                        if (T_[cur.z]) {
-                            stack.emplace(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
-                        }
+    /* unite(), intersect(), subtract(), symmetricDifference() */
 
-                    }
+    KrKcTree* combineInit(const KrKcTree& other, SetOperation op) const {
 
-                    cur.dq += cur.nc;
-                    cur.z++;
-                    cur.j++;
+        if ((kr_ != other.kr_) || (kc_ != other.kc_) || (h_ != other.h_)) {
 
-                }
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "Both K2Trees have to have the same arities (kr, kc) and height (h)."
+            ;
 
-            }
-        }
+            throw std::runtime_error(err);
 
-        return numCols_;
+        }
 
-    }
+        auto res = new KrKcTree();
 
-    size_type firstSuccessorInit(size_type p) {
+        res->kr_ = kr_;
+        res->kc_ = kc_;
+        res->h_ = h_;
+        res->numRows_ = numRows_;
+        res->numCols_ = numCols_;
+        res->null_ = false;
 
-        size_type pos = numCols_;
+        std::vector<std::vector<bool>> levels(h_);
+        res->combine(*this, other, op, levels, 1, !L_.empty(), 0, !other.L_.empty(), 0);
 
-        if (!L_.empty()) {
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res->T_ = bit_vector_type(total);
 
-            size_type y = kc_ * (p / (numRows_ / kr_));
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-            for (size_type j = 0; j < kc_ && pos == numCols_; j++) {
-                pos = firstSuccessor(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j);
-            }
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
         }
 
-        return pos;
+        res->L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), res->L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
 
     }
 
-    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    // merges the subtrees of the current node (on level l) of a and b, i.e. appends the children of this node in the result
+    // to levels resp. L_ and returns whether there are any; zA (zB) is the start of the block of children of the node in a (b)
+    // and only relevant if the node is non-empty in a (b), which is indicated by inA (inB)
+    bool combine(const KrKcTree& a, const KrKcTree& b, SetOperation op, std::vector<std::vector<bool>>& levels, size_type l, bool inA, size_type zA, bool inB, size_type zB) {
 
-        size_type pos = numCols_;
+        std::vector<bool> C;
 
-        if (z >= T_.size()) {
+        if (l == h_) {
 
-            if (L_[z - T_.size()]) {
-                pos = q;
+            for (size_type j = 0; j < kr_ * kc_; j++) {
+                C.push_back(isInResult(op, inA && a.L_[zA + j - a.T_.size()], inB && b.L_[zB + j - b.T_.size()]));
             }
 
         } else {
 
-            if (T_[z]) {
+            for (size_type j = 0; j < kr_ * kc_; j++) {
 
-                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
+                bool childA = inA && a.T_[zA + j];
+                bool childB = inB && b.T_[zB + j];
 
-                for (size_type j = 0; j < kc_ && pos == numCols_; j++) {
-                    pos = firstSuccessor(numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j);
-                }
+                C.push_back(mayBeInResult(op, childA, childB) && combine(
+                        a,
+                        b,
+                        op,
+                        levels,
+                        l + 1,
+                        childA,
+                        childA ? a.R_.rank(zA + j + 1) * kr_ * kc_ : 0,
+                        childB,
+                        childB ? b.R_.rank(zB + j + 1) * kr_ * kc_ : 0
+                ));
 
             }
 
         }
 
-        return pos;
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
 
     }
 
-    /* getPredecessors() */
+    /* compose() */
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+    KrKcTree* composeInit(const KrKcTree& other, unsigned numThreads) const {
 
-        if (!L_.empty()) {
+        if ((kc_ != other.kr_) || (h_ != other.h_)) {
 
-            size_type y = q / (numCols_ / kc_);
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The column arity (kc) of the first K2Tree has to equal the row arity (kr) of the second one and both have to have the same height (h)."
+            ;
 
-            for (size_type i = 0; i < kr_; i++) {
-                predecessors(preds, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_);
-            }
+            throw std::runtime_error(err);
 
         }
 
-    }
+        auto res = new KrKcTree();
 
-    void predecessors(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+        res->kr_ = kr_;
+        res->kc_ = other.kc_;
+        res->h_ = h_;
+        res->numRows_ = numRows_;
+        res->numCols_ = other.numCols_;
+        res->null_ = false;
 
-        if (z >= T_.size()) {
+        std::vector<std::vector<bool>> levels(h_);
 
-            if (L_[z - T_.size()]) {
-                preds.push_back(p);
-            }
+        if (!L_.empty() && !other.L_.empty()) {
 
-        } else {
+            std::vector<std::pair<size_type, size_type>> root(1, std::make_pair(0, 0));
 
-            if (T_[z]) {
+            if ((numThreads <= 1) || (h_ == 1)) {
+                res->composeBlocks(*this, other, root, levels, 1);
+            } else {
 
-                size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
+                // every top-level submatrix of the result is computed independently into its own levels,
+                // which are concatenated afterwards (as all submatrices of a level are stored from left to right)
+                size_type num = res->kr_ * res->kc_;
+                std::vector<std::vector<std::vector<bool>>> partLevels(num, std::vector<std::vector<bool>>(h_));
+                std::vector<char> nonEmpty(num, false);
 
-                for (size_type i = 0; i < kr_; i++) {
-                    predecessors(preds, numRows / kr_, numCols / kc_,  q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_);
-                }
+                std::atomic<size_type> nextPart(0);
+                std::vector<std::thread> workers;
 
-            }
+                for (unsigned w = 0; w < numThreads; w++) {
+                    workers.emplace_back([&]() {
+                        for (size_type t = nextPart++; t < num; t = nextPart++) {
 
-        }
+                            auto blocks = res->composeChildren(*this, other, root, t / res->kc_, t % res->kc_);
+                            nonEmpty[t] = !blocks.empty() && res->composeBlocks(*this, other, blocks, partLevels[t], 2);
 
-    }
+                        }
+                    });
+                }
 
-    /* getRange() */
+                for (auto& w : workers) {
+                    w.join();
+                }
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+                if (std::find(nonEmpty.begin(), nonEmpty.end(), true) != nonEmpty.end()) {
 
-        if (!L_.empty()) {
+                    levels[0].assign(nonEmpty.begin(), nonEmpty.end());
 
-            size_type p1Prime, p2Prime;
+                    for (size_type l = 1; l < h_; l++) {
+                        for (size_type t = 0; t < num; t++) {
 
-            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+                            levels[l].insert(levels[l].end(), partLevels[t][l].begin(), partLevels[t][l].end());
+                            partLevels[t][l].clear();
+                            partLevels[t][l].shrink_to_fit();
 
-                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
-                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
+                        }
+                    }
 
-                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
-                    range(
-                            pairs,
-                            numRows_ / kr_,
-                            numCols_ / kc_,
-                            p1Prime,
-                            p2Prime,
-                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
-                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
-                            (numRows_ / kr_) * i,
-                            (numCols_ / kc_) * j,
-                            kc_ * i + j
-                    );
                 }
 
             }
 
         }
 
-    }
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res->T_ = bit_vector_type(total);
 
-    void range(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-        if (z >= T_.size()) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
-            if (L_[z - T_.size()]) {
-                pairs.push_back(std::make_pair(dp, dq));
-            }
+        }
 
-        } else {
+        res->L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), res->L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
 
-            if (T_[z]) {
+        res->R_ = rank_type(&res->T_);
 
-                auto y = R_.rank(z + 1) * kr_ * kc_;
-                size_type p1Prime, p2Prime;
+        return res;
 
-                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+    }
 
-                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
-                    p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
+    // computes the children of the current node (on level l) of the result, i.e. appends them to levels and returns
+    // whether there are any; the node is the sum of the products of the submatrices whose blocks of children
+    // start at the positions (zA, zB) in blocks
+    bool composeBlocks(const KrKcTree& a, const KrKcTree& b, const std::vector<std::pair<size_type, size_type>>& blocks, std::vector<std::vector<bool>>& levels, size_type l) const {
 
-                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
-                        range(
-                                pairs,
-                                numRows / kr_,
-                                numCols / kc_,
-                                p1Prime,
-                                p2Prime,
-                                (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
-                                (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
-                                dp + (numRows / kr_) * i,
-                                dq + (numCols / kc_) * j,
-                                y + kc_ * i + j
-                        );
+        std::vector<bool> C;
+
+        for (size_type i = 0; i < kr_; i++) {
+            for (size_type j = 0; j < kc_; j++) {
+
+                if (l == h_) {
+
+                    bool found = false;
+
+                    for (auto it = blocks.begin(); !found && (it != blocks.end()); it++) {
+                        for (size_type m = 0; !found && (m < a.kc_); m++) {
+                            found = a.L_[it->first + i * a.kc_ + m - a.T_.size()] && b.L_[it->second + m * b.kc_ + j - b.T_.size()];
+                        }
                     }
 
+                    C.push_back(found);
+
+                } else {
+
+                    auto children = composeChildren(a, b, blocks, i, j);
+                    C.push_back(!children.empty() && composeBlocks(a, b, children, levels, l + 1));
+
                 }
 
             }
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
 
         }
 
     }
 
-    /* linkInRange() */
+    // returns the blocks of children of all pairs of non-empty submatrices (i,m) of a and (m,j) of b
+    // that contribute to the submatrix (i,j) of the current node of the result
+    std::vector<std::pair<size_type, size_type>> composeChildren(const KrKcTree& a, const KrKcTree& b, const std::vector<std::pair<size_type, size_type>>& blocks, size_type i, size_type j) const {
 
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+        std::vector<std::pair<size_type, size_type>> children;
 
-        if (!L_.empty()) {
+        for (auto& block : blocks) {
+            for (size_type m = 0; m < a.kc_; m++) {
+
+                size_type zA = block.first + i * a.kc_ + m;
+                size_type zB = block.second + m * b.kc_ + j;
+
+                if (a.T_[zA] && b.T_[zB]) {
+                    children.push_back(std::make_pair(a.R_.rank(zA + 1) * a.kr_ * a.kc_, b.R_.rank(zB + 1) * b.kr_ * b.kc_));
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
-                return 1;
             }
+        }
 
-            size_type p1Prime, p2Prime;
+        return children;
 
-            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+    }
 
-                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
-                p2Prime = (i == p2 / (numRows_ / kr_)) ? (p2 % (numRows_ / kr_)) : numRows_ / kr_ - 1;
+    /* transpose() */
 
-                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+    KrKcTree<bool, KC, KR>* transposeInit() const {
 
-                    if (linkInRange(numRows_ / kr_, numCols_ / kc_, p1Prime, p2Prime, (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)), (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : numCols_ / kc_ - 1, kc_ * i + j)) {
-                        return true;
-                    }
+        auto res = new KrKcTree<bool, KC, KR>();
 
-                }
+        res->kr_ = kc_;
+        res->kc_ = kr_;
+        res->h_ = h_;
+        res->numRows_ = numCols_;
+        res->numCols_ = numRows_;
+        res->null_ = null_;
 
-            }
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = bit_vector_type(L_.size());
 
-        }
+        if (!L_.empty()) {
 
-        return false;
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            for (size_type l = 1; l < h_ - 1; l++) {
 
-    }
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * kr_ * kc_;
 
-    bool linkInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+            }
 
-        if (z >= T_.size()) {
+            transposeBlock(res, cursors, 1, 0);
 
-            return L_[z - T_.size()];
+        }
 
-        } else {
+        res->R_ = rank_type(&res->T_);
 
-            if (T_[z]) {
+        return res;
 
-                // dividing by k_ (as stated in the paper) in not correct,
-                // because it does not use the size of the currently considered submatrix but of its submatrices
-                if ((p1 == 0) && (q1 == 0) && (p2 == (numRows /*/ kr_*/ - 1)) && (q2 == (numCols /*/ kc_*/ - 1))) {
-                    return true;
+    }
+
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors
+    void transposeBlock(KrKcTree<bool, KC, KR>* res, std::vector<size_type>& cursors, size_type l, size_type z) const {
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < kc_; i++) {
+                for (size_type j = 0; j < kr_; j++) {
+                    res->L_[cursors[l - 1]++] = L_[z + j * kc_ + i - T_.size()];
                 }
+            }
 
-                auto y = R_.rank(z + 1) * kr_ * kc_;
-                size_type p1Prime, p2Prime;
+        } else {
 
-                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+            for (size_type i = 0; i < kc_; i++) {
+                for (size_type j = 0; j < kr_; j++) {
 
-                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
-                    p2Prime = (i == p2 / (numRows / kr_)) ? (p2 % (numRows / kr_)) : numRows / kr_ - 1;
+                    size_type y = z + j * kc_ + i;
+                    size_type pos = cursors[l - 1]++;
 
-                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                    if (T_[y]) {
 
-                        if (linkInRange(numRows / kr_, numCols / kc_, p1Prime, p2Prime, (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)), (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1, y + kc_ * i + j)) {
-                            return true;
-                        }
+                        res->T_[pos] = true;
+                        transposeBlock(res, cursors, l + 1, R_.rank(y + 1) * kr_ * kc_);
 
                     }
 
                 }
-
             }
 
-            return false;
-
         }
 
     }
 
+    /* getSuccessorPositionsBatch(), expandRows() */
 
-    /* setNull() */
-
-    void setInit(size_type p, size_type q) {
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
 
-        if (!L_.empty()) {
-            set(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+        if (!L_.empty() && (first < last)) {
+            successorsBatch(rows, first, last, numRows_ / kr_, numCols_ / kc_, 0, 0, 0, func);
         }
 
     }
 
-    void set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children starts at z and whose children have nr rows and nc columns);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type nr, size_type nc, size_type dp, size_type dq, size_type z, Func& func) const {
 
-        if (z >= T_.size()) {
-            L_[z - T_.size()] = null_;
-        } else {
+        size_type lenT = T_.size();
+
+        for (size_type t = first; t < last;) {
+
+            size_type r = (rows[t] - dp) / nr;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / nr == r)) e++;
+
+            if (z >= lenT) {
+
+                for (size_type c = 0; c < kc_; c++) {
+                    if (L_[z - lenT + r * kc_ + c]) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
+                }
+
+            } else {
+
+                for (size_type c = 0, y = z + r * kc_; c < kc_; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, nr / kr_, nc / kc_, dp + r * nr, dq + c * nc, R_.rank(y + 1) * kr_ * kc_, func);
+                    }
+                }
 
-            if (T_[z]) {
-                set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_));
             }
 
+            t = e;
+
         }
 
     }
@@ -22,7 +22,9 @@
 #ifndef K2TREES_STATICBASICTREE_HPP
 #define K2TREES_STATICBASICTREE_HPP
 
+#include <atomic>
 #include <queue>
+#include <thread>
 
 #include "K2Tree.hpp"
 #include "Utility.hpp"
@@ -34,9 +36,13 @@
  * The described relation matrix is quadratic with an edge length of nPrime,
  * where nPrime is the smallest power of k that exceeds the row / column numbers
  * of all relation pairs.
+ *
+ * The arity can be fixed at compile time (K > 0, a power of two, e.g. BasicK2Tree<E, 2>),
+ * then point queries descend with shifts and masks instead of divisions and the constructors
+ * only accept k = K. With K = 0 (default) the arity is a pure run-time parameter.
  */
-template<typename E>
-class BasicK2Tree : public virtual K2Tree<E> {
+template<typename E, size_type K = 0>
+class BasicK2Tree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -46,6 +52,8 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    static_assert((K != 1) && ((K & (K - 1)) == 0), "The compile-time arity (K) has to be 0 or a power of two.");
+
 
     BasicK2Tree() {
         // nothing to do
@@ -61,6 +69,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        M_ = other.M_;
 
     }
 
@@ -79,6 +88,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        M_ = other.M_;
 
         return *this;
 
@@ -94,6 +104,7 @@ public:
         null_ = null;
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(std::max(mat.size(), mat[0].size()), k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -136,6 +147,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(std::max(lists.size(), maxCol + 1), k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -214,6 +226,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxIndex + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -227,37 +240,37 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the K2Tree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         allSuccessorElementsIterative(succs, i);
@@ -267,17 +280,18 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
 
         return succs;
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         allSuccessorValuedPositionsIterative(succs, i);
@@ -287,7 +301,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -296,7 +310,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -305,7 +319,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -314,7 +328,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -324,7 +338,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -334,7 +348,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -344,24 +358,39 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
-        return getElementsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    std::vector<elem_type> getAllElements() const override {
+
+        std::vector<elem_type> elements;
+        zOrderScan([&](size_type, size_type, size_type y) { elements.push_back(L_[y]); });
+
+        return elements;
+
     }
 
-    positions_type getAllPositions() override {
-        return getPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
+
+        return pairs;
+
     }
 
-    pairs_type getAllValuedPositions() override {
-        return getValuedPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    pairs_type getAllValuedPositions() const override {
+
+        pairs_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type y) { pairs.push_back(ValuedPosition<elem_type>(i, j, L_[y])); });
+
+        return pairs;
+
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type i = 0; i < L_.size(); i++) {
@@ -374,10 +403,10 @@ public:
 
 
     BasicK2Tree* clone() const override {
-        return new BasicK2Tree<elem_type>(*this);
+        return new BasicK2Tree(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -408,9 +437,127 @@ public:
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsPosInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void multiply(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<false>(x, y, 1);
+    }
+
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<true>(x, y, 1);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+    // multi-threaded version of multiply(), the top-level row bands are distributed among numThreads threads
+    void multiply(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<false>(x, y, numThreads);
+    }
+
+    // multi-threaded version of multiplyTransposed(), the top-level column bands are distributed among numThreads threads
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<true>(x, y, numThreads);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i,val) with (i,j,val) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    BasicK2Tree* transpose() const {
+        return transposeInit();
+    }
+
+
+    /*
+     * Set operations on K2Trees with the same parameters (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this or the other relation
+    // (with the values of this relation for pairs in both)
+    BasicK2Tree* unite(const BasicK2Tree& other) const {
+        return combineInit(other, SET_UNION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in both relations (with the values of this relation)
+    BasicK2Tree* intersect(const BasicK2Tree& other) const {
+        return combineInit(other, SET_INTERSECTION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this, but not in the other relation
+    BasicK2Tree* subtract(const BasicK2Tree& other) const {
+        return combineInit(other, SET_DIFFERENCE);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in exactly one of the relations
+    BasicK2Tree* symmetricDifference(const BasicK2Tree& other) const {
+        return combineInit(other, SET_SYMMETRIC_DIFFERENCE);
     }
 
 
@@ -418,31 +565,155 @@ public:
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
 
+    /*
+     * Additional queries on valued relations (not part of the K2Tree interface)
+     */
+
+    // returns the (at most) num valued pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2 that have the largest values,
+    // sorted in descending order of their values (ties are broken arbitrarily)
+    pairs_type getTopValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2, size_type num) const {
+
+        if (!hasMaxima()) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The subtree maxima have to be built (buildMaxima()) before top-k queries."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+        pairs_type pairs;
+        topRangeValPosInit(pairs, i1, i2, j1, j2, num);
+
+        return pairs;
+
+    }
+
+    // computes the maximum values of the subtrees rooted at the 1-bits of the first levels of T_, which are required
+    // by getTopValuedPositionsInRange() and not built by the constructors or set operations (but kept by transpose());
+    // one value per 1-bit is stored, so memory grows with every covered level: deeper subtrees use the maximum of their
+    // nearest covered ancestor as a looser bound, levels >= h - 1 gives exact bounds for all subtrees
+    void buildMaxima(size_type levels) {
+
+        if (levels == 0) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The maxima have to cover at least one level."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+        size_type lenT = T_.size();
+
+        // the 1-bits of the first levels form a prefix of T_ (the children of the last 1-bit of a level
+        // end the next level), so only the maxima of this prefix are kept
+        size_type end = 0;
+        for (size_type l = 0; (l < levels) && (end < lenT); l++) {
+            end = (R_.rank(end) + 1) * k_ * k_;
+        }
+
+        // bottom-up, since children are always stored behind their parents
+        std::vector<elem_type> maxima(R_.rank(lenT), null_);
+
+        for (size_type z = lenT; z-- > 0;) {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+                elem_type& max = maxima[R_.rank(z)];
+
+                for (size_type c = 0; c < k_ * k_; c++, y++) {
+
+                    elem_type val = (y >= lenT) ? L_[y - lenT] : (T_[y] ? maxima[R_.rank(y)] : null_);
+
+                    if ((val != null_) && ((max == null_) || (max < val))) {
+                        max = val;
+                    }
+
+                }
+
+            }
+
+        }
+
+        maxima.resize(R_.rank(std::min(end, lenT)));
+        maxima.shrink_to_fit();
+        M_.swap(maxima);
+
+    }
+
+    // checks whether getTopValuedPositionsInRange() can be used, i.e. whether buildMaxima() has been called
+    // (trivially true if there are no inner nodes whose maxima would be needed)
+    bool hasMaxima() const {
+        return !M_.empty() || L_.empty() || T_.empty();
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
@@ -454,6 +725,10 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // maximum values of the subtrees rooted at the 1-bits of the first levels of T_ (in the order of the 1-bits),
+    // null_ for subtrees without non-null values; empty unless buildMaxima() has been called
+    std::vector<elem_type> M_;
+
     size_type h_; // height of the K2Tree
     size_type k_; // arity of the K2Tree
     size_type nPrime_; // edge length of the represented relation matrix
@@ -461,6 +736,23 @@ private:
     elem_type null_; // null element
 
 
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((K > 0) && (k_ != K)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arity (k) has to be equal to the compile-time arity (K)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
     /* helper method for construction from relation matrix */
 
     bool buildFromMatrix(const matrix_type& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type n, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
@@ -726,11 +1018,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width) const {
         return ((pair.row - sp.firstRow) / width) * k_ + (pair.col - sp.firstCol) / width;
     }
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -830,15 +1122,46 @@ private:
 
     }
 
+    /* isNotNull(), getElement() and areRelated() with compile-time arity */
+
+    // descends to the leaf of (p, q) using shifts and masks instead of divisions (requires K > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type p, size_type q, size_type& z) const {
+
+        const size_type logK = log2Pow2(K);
+        size_type s = (h_ - 1) * logK; // log2(n / K) on the current level
+
+        z = (p >> s) * K + (q >> s);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            s -= logK;
+            z = R_.rank(z + 1) * K * K + ((p >> s) & (K - 1)) * K + ((q >> s) & (K - 1));
 
+        }
+
+        return true;
+
+    }
 
     /* isNotNull() */
 
-    bool checkInit(size_type p, size_type q) {
+    bool checkInit(size_type p, size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return !L_.empty() && descend(p, q, z) && (L_[z - T_.size()] != null_);
+
+        }
+
         return (L_.empty()) ? false : check(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+
     }
 
-    bool check(size_type n, size_type p, size_type q, size_type z) {
+    bool check(size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return (L_[z - T_.size()] != null_);
@@ -850,11 +1173,20 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type p, size_type q) {
+    elem_type getInit(size_type p, size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return (!L_.empty() && descend(p, q, z)) ? L_[z - T_.size()] : null_;
+
+        }
+
         return (L_.empty()) ? null_ : get(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+
     }
 
-    elem_type get(size_type n, size_type p, size_type q, size_type z) {
+    elem_type get(size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -867,7 +1199,7 @@ private:
 
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -877,11 +1209,7 @@ private:
         if (lenT == 0) {
 
             size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
-                }
-            }
+            forEachNonNull(L_.data() + offset, nPrime_, null_, [&](size_type i) { succs.push_back(L_[offset + i]); });
 
         } else {
 
@@ -928,11 +1256,7 @@ private:
 
                     auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
-                        }
-                    }
+                    forEachNonNull(L_.data() + y, k_, null_, [&](size_type j) { succs.push_back(L_[y + j]); });
 
                 }
 
@@ -944,7 +1268,7 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -958,7 +1282,7 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -985,11 +1309,13 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         if (lenT == 0) {
@@ -1007,7 +1333,7 @@ private:
             size_type n = nPrime_/ k_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // successorsPos
@@ -1015,32 +1341,33 @@ private:
             n /= k_;
             for (; n > 1; relP %= n, n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1054,15 +1381,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1076,7 +1401,7 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1103,7 +1428,7 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -1180,7 +1505,7 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1198,7 +1523,7 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1225,7 +1550,7 @@ private:
 
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return nPrime_;
 
@@ -1240,15 +1565,17 @@ private:
 
         } else {
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
 
             while (!stack.empty()) {
 
-                auto& cur = stack.top();
+                auto& cur = stack.back();
 
                 if (cur.j == k_) {
-                    stack.pop();
+                    stack.pop_back();
                 } else {
 
                     if (cur.z >= T_.size()) {
@@ -1260,7 +1587,7 @@ private:
                     } else {
 
                         if (T_[cur.z]) {
-                            stack.emplace(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
+                            stack.emplace_back(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
                         }
 
                     }
@@ -1278,7 +1605,7 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
@@ -1296,7 +1623,7 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) const {
 
         size_type pos = nPrime_;
 
@@ -1327,7 +1654,7 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1341,7 +1668,7 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1367,7 +1694,7 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1381,7 +1708,7 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1405,9 +1732,60 @@ private:
 
     }
 
+    /* getFirstPredecessorIn() */
+
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type y = q / (nPrime_ / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+
+                auto p = firstPredecessorIn(rows, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_);
+
+                if (p < nPrime_) {
+                    return p;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
+    // same descent as in predecessorsPos(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type n, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+            return ((L_[z - T_.size()] != null_) && rows[p]) ? p : nPrime_;
+        }
+
+        if (T_[z]) {
+
+            size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+
+                auto res = firstPredecessorIn(rows, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_);
+
+                if (res < nPrime_) {
+                    return res;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1425,7 +1803,7 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1452,7 +1830,7 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1483,7 +1861,7 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1496,6 +1874,21 @@ private:
             if (T_[z]) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
+
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+
+                        size_type offset = y - T_.size() + k_ * i + q1;
+                        forEachNonNull(L_.data() + offset, q2 - q1 + 1, null_, [&](size_type j) { elements.push_back(L_[offset + j]); });
+
+                    }
+
+                    return;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
@@ -1527,7 +1920,7 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1558,7 +1951,7 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1602,7 +1995,7 @@ private:
 
     /* getValuedPositionsRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1633,7 +2026,7 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1675,43 +2068,118 @@ private:
 
     }
 
+    /* getTopValuedPositionsInRange() */
 
-    /* containsElement() */
-
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
-
-        if (!L_.empty()) {
-
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
-            }
-
-            size_type p1Prime, p2Prime;
+    void topRangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2, size_type num) const {
 
-            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+        if (!L_.empty() && (num != 0)) {
 
-                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
-                p2Prime = (i == p2 / (nPrime_ / k_)) ? (p2 % (nPrime_ / k_)) : nPrime_ / k_ - 1;
+            // best-first traversal: always expand the candidate with the largest subtree maximum,
+            // leaves are reported when they are extracted since their values dominate all remaining bounds
+            std::priority_queue<RangeCandidate<elem_type>> queue;
+            pushTopRangeValPosChildren(queue, nPrime_, p1, p2, q1, q2, 0, 0, 0, null_);
 
-                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+            while (!queue.empty() && (pairs.size() < num)) {
 
-                    if (elemInRange(nPrime_ / k_, p1Prime, p2Prime, (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)), (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : nPrime_ / k_ - 1, k_ * i + j)) {
-                        return true;
-                    }
+                RangeCandidate<elem_type> cur = queue.top();
+                queue.pop();
 
+                if (cur.z >= T_.size()) {
+                    pairs.push_back(ValuedPosition<elem_type>(cur.dp, cur.dq, cur.bound));
+                } else {
+                    pushTopRangeValPosChildren(queue, cur.nr, cur.p1, cur.p2, cur.q1, cur.q2, cur.dp, cur.dq, R_.rank(cur.z + 1) * k_ * k_, cur.bound);
                 }
 
             }
 
         }
 
-        return false;
+    }
+
+    // same child enumeration as in rangeValPos(), but non-empty children are queued together with an upper bound
+    // of their values (parentBound is the bound of the node whose children are enumerated)
+    void pushTopRangeValPosChildren(std::priority_queue<RangeCandidate<elem_type>>& queue, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type y, elem_type parentBound) const {
+
+        size_type p1Prime, p2Prime, z;
+
+        for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+            p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+            p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+            for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+
+                z = y + k_ * i + j;
+                elem_type bound = (z >= T_.size()) ? L_[z - T_.size()] : (T_[z] ? subtreeBound(z, parentBound) : null_);
+
+                if (bound != null_) {
+                    queue.push(RangeCandidate<elem_type>(
+                            bound,
+                            n / k_,
+                            n / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                            (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                            dp + (n / k_) * i,
+                            dq + (n / k_) * j,
+                            z
+                    ));
+                }
+
+            }
+
+        }
+
+    }
+
+    // upper bound for the values in the subtree rooted at the 1-bit z of T_: its maximum if z is covered by M_,
+    // otherwise the bound of its parent
+    elem_type subtreeBound(size_type z, elem_type parentBound) const {
+
+        size_type r = R_.rank(z);
+
+        return (r < M_.size()) ? M_[r] : parentBound;
+
+    }
+
+
+    /* containsElement() */
+
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (!L_.empty()) {
+
+            // dividing by k_ (as stated in the paper) in not correct,
+            // because it does not use the size of the currently considered submatrix but of its submatrices
+            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
+                return 1;
+            }
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? (p2 % (nPrime_ / k_)) : nPrime_ / k_ - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+
+                    if (elemInRange(nPrime_ / k_, p1Prime, p2Prime, (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)), (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : nPrime_ / k_ - 1, k_ * i + j)) {
+                        return true;
+                    }
+
+                }
+
+            }
+
+        }
+
+        return false;
 
     }
 
-    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1778,184 +2246,194 @@ private:
 
     }
 
-};
-
-
-/**
- * Bool specialisation of BasicK2Tree.
- *
- * Has the same characteristics as the general implementation above,
- * but makes use of some simplifications since the only non-null value is 1 / true.
- */
-template<>
-class BasicK2Tree<bool> : virtual public K2Tree<bool> {
-
-public:
-    typedef bool elem_type;
-
-    typedef K2Tree<elem_type>::matrix_type matrix_type;
-    typedef K2Tree<elem_type>::list_type list_type;
-    typedef K2Tree<elem_type>::positions_type positions_type;
-    typedef K2Tree<elem_type>::pairs_type pairs_type;
 
+    /* multiply() / multiplyTransposed() */
 
-    BasicK2Tree() {
-        // nothing to do
-    }
+    template<bool Transposed>
+    void multiplyInit(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
 
-    BasicK2Tree(const BasicK2Tree& other) {
+        std::fill(y.begin(), y.end(), 0.0);
 
-        h_ = other.h_;
-        k_ = other.k_;
-        nPrime_ = other.nPrime_;
-        null_ = other.null_;
+        if (L_.empty()) return;
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+        if ((numThreads <= 1) || (T_.size() == 0)) {
 
-    }
+            multiplyBlock<Transposed>(x, y, nPrime_ / k_, 0, 0, 0);
+            return;
 
-    BasicK2Tree& operator=(const BasicK2Tree& other) {
+        }
 
-        // check for self-assignment
-        if (&other == this) {
-            return *this;
+        // determine the submatrices on the shallowest level that provides enough row (column) bands for all threads
+        size_type n = nPrime_ / k_;
+        size_type bands = k_;
+        std::vector<SubmatrixInfo> level, nextLevel;
+        for (size_type i = 0; i < k_; i++) {
+            for (size_type j = 0; j < k_; j++) {
+                level.push_back(SubmatrixInfo(i * n, j * n, i * k_ + j));
+            }
         }
 
-        h_ = other.h_;
-        k_ = other.k_;
-        nPrime_ = other.nPrime_;
-        null_ = other.null_;
+        for (; (bands < numThreads) && (n > 1); n /= k_, bands *= k_) {
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+            for (auto& cur : level) {
 
-        return *this;
+                if (T_[cur.z]) {
 
-    }
+                    size_type pos = R_.rank(cur.z + 1) * k_ * k_;
 
-    /**
-     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
-     *
-     * Assumes that all rows of mat are equally long.
-     */
-    BasicK2Tree(const matrix_type& mat, const size_type k) {
+                    for (size_type i = 0; i < k_; i++) {
+                        for (size_type j = 0; j < k_; j++) {
+                            nextLevel.push_back(SubmatrixInfo(cur.dp + i * (n / k_), cur.dq + j * (n / k_), pos + i * k_ + j));
+                        }
+                    }
 
-        null_ = false;
+                }
 
-        k_ = k;
-        h_ = std::max((size_type)1, logK(std::max(mat.size(), mat[0].size()), k_));
-        nPrime_ = size_type(pow(k_, h_));
+            }
 
-        std::vector<std::vector<bool>> levels(h_);
-        buildFromMatrix(mat, levels, mat.size(), mat[0].size(), nPrime_, 1, 0, 0);
+            level.swap(nextLevel);
+            nextLevel.clear();
 
-        size_type total = 0;
-        for (size_type l = 0; l < h_ - 1; l++) {
-            total += levels[l].size();
         }
-        T_ = bit_vector_type(total);
-
-        bit_vector_type::iterator outIter = T_.begin();
-        for (size_type l = 0; l < h_ - 1; l++) {
 
-            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-            levels[l].clear();
-            levels[l].shrink_to_fit();
+        // all submatrices of a band write to the same entries of y and are therefore processed by the same thread
+        std::stable_sort(level.begin(), level.end(), [](const SubmatrixInfo& a, const SubmatrixInfo& b) {
+            return Transposed ? (a.dq < b.dq) : (a.dp < b.dp);
+        });
 
+        std::vector<size_type> bandStarts;
+        for (size_type t = 0; t < level.size(); t++) {
+            if ((t == 0) || (Transposed ? (level[t].dq != level[t - 1].dq) : (level[t].dp != level[t - 1].dp))) {
+                bandStarts.push_back(t);
+            }
         }
+        bandStarts.push_back(level.size());
 
-        L_ = bit_vector_type(levels[h_ - 1].size());
-        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-        levels[h_ - 1].clear();
-        levels[h_ - 1].shrink_to_fit();
+        std::atomic<size_type> nextBand(0);
+        std::vector<std::thread> workers;
 
-        R_ = rank_type(&T_);
+        for (unsigned w = 0; w < numThreads; w++) {
+            workers.emplace_back([&]() {
+                for (size_type b = nextBand++; b + 1 < bandStarts.size(); b = nextBand++) {
+                    for (size_type t = bandStarts[b]; t < bandStarts[b + 1]; t++) {
+                        multiplyNode<Transposed>(x, y, n, level[t].dp, level[t].dq, level[t].z);
+                    }
+                }
+            });
+        }
+
+        for (auto& w : workers) {
+            w.join();
+        }
 
     }
 
-    /**
-     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
-     *
-     * The actually used method depends on parameter mode.
-     */
-    BasicK2Tree(const RelationLists& lists, const size_type k, const int mode) {
+    template<bool Transposed>
+    void multiplyNode(const std::vector<double>& x, std::vector<double>& y, size_type n, size_type dp, size_type dq, size_type z) const {
 
-        null_ = false;
+        if (z >= T_.size()) {
 
-        size_type maxCol = 0;
-        for (auto& row : lists) {
-            for (auto& elem : row) {
-                maxCol = std::max(maxCol, elem);
+            if (L_[z - T_.size()] != null_) {
+                y[Transposed ? dq : dp] += L_[z - T_.size()] * x[Transposed ? dp : dq];
             }
+
+        } else if (T_[z]) {
+            multiplyBlock<Transposed>(x, y, n / k_, dp, dq, R_.rank(z + 1) * k_ * k_);
         }
 
-        k_ = k;
-        h_ = std::max((size_type)1, logK(std::max(lists.size(), maxCol + 1), k_));
-        nPrime_ = size_type(pow(k_, h_));
+    }
 
-        switch (mode) {
+    // processes the block of children starting at index z in the (conceptual concatenation of) T and L,
+    // n is the edge length of the children
+    template<bool Transposed>
+    void multiplyBlock(const std::vector<double>& x, std::vector<double>& y, size_type n, size_type dp, size_type dq, size_type z) const {
 
-            case 0: { // 3.3.2.
+        size_type lenT = T_.size();
 
-                std::vector<std::vector<bool>> levels(h_);
-                std::vector<RelationList::const_iterator> cursors;
-                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
-                    cursors.push_back(iter->begin());
-                }
+        if (z >= lenT) {
 
-                buildFromLists(lists, cursors, levels, nPrime_, 1, 0, 0);
+            size_type pos = z - lenT;
 
-                size_type total = 0;
-                for (size_type l = 0; l < h_ - 1; l++) {
-                    total += levels[l].size();
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++, pos++) {
+                    if (L_[pos] != null_) {
+                        y[Transposed ? dq + j : dp + i] += L_[pos] * x[Transposed ? dp + i : dq + j];
+                    }
                 }
-                T_ = bit_vector_type(total);
+            }
 
-                bit_vector_type::iterator outIter = T_.begin();
-                for (size_type l = 0; l < h_ - 1; l++) {
+        } else {
 
-                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-                    levels[l].clear();
-                    levels[l].shrink_to_fit();
+            size_type pos = z;
 
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++, pos++) {
+                    if (T_[pos]) {
+                        multiplyBlock<Transposed>(x, y, n / k_, dp + i * n, dq + j * n, R_.rank(pos + 1) * k_ * k_);
+                    }
                 }
+            }
 
-                L_ = bit_vector_type(levels[h_ - 1].size());
-                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-                levels[h_ - 1].clear();
-                levels[h_ - 1].shrink_to_fit();
+        }
 
-                R_ = rank_type(&T_);
+    }
 
-                break;
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
 
-            }
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
 
-            case 1: { // 3.3.3.
+        if (L_.empty()) return;
 
-                buildFromListsViaTree(lists);
+        size_type numLevels = h_ - 1;
+        size_type kSq = k_ * k_;
 
-                R_ = rank_type(&T_);
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), n(numLevels + 1, nPrime_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
 
-                break;
+        for (size_type l = 0; l < numLevels; l++) {
 
-            }
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * kSq;
+            n[l + 1] = n[l] / k_;
 
-            case 2: { // 3.3.4.
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
 
-                buildFromListsDynamicBitmaps(lists);
+        }
 
-                break;
+        size_type l = 0; // topmost level whose cursor has been moved
+
+        for (size_type y = 0; y < L_.size(); y += kSq) {
 
+            for (; l < numLevels; l++) {
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % kSq / k_) * n[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % k_) * n[l + 1];
             }
 
-            default: {
+            for (size_type z = 0; z < kSq; z++) {
+                if (L_[y + z] != null_) {
+                    func(dp[numLevels] + z / k_, dq[numLevels] + z % k_, y + z);
+                }
+            }
 
-                buildFromListsDynamicBitmaps(lists);
-                break;
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
+
+                l--;
+                size_type block = (cur[l] - start[l]) / kSq;
+
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
+                }
+
+                steps = (cur[l] - start[l]) / kSq - block;
 
             }
 
@@ -1963,280 +2441,263 @@ public:
 
     }
 
-    /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
-     */
-    BasicK2Tree(positions_type& pairs, const size_type k) {
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
 
-        null_ = false;
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of nPrime_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
 
-        size_type maxIndex = 0;
-        for (auto& p : pairs) {
-            maxIndex = std::max({maxIndex, p.first, p.second});
-        }
+        if (!L_.empty()) {
 
-        k_ = k;
-        h_ = std::max((size_type)1, logK(maxIndex + 1, k_));
-        nPrime_ = size_type(pow(k_, h_));
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
 
-        if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
-        }
+            rowMajorScan(func, frontiers, nPrime_, 0, 0);
 
-        R_ = rank_type(&T_);
+        }
 
     }
 
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the n rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type n, size_type dp, size_type l) const {
 
-    // returns the height of the K2Tree
-    size_type getH() {
-        return h_;
-    }
+        for (size_type i = 0; i < k_; i++) {
 
-    // returns the arity of the K2Tree
-    size_type getK() {
-        return k_;
-    }
+            if (l == h_ - 1) {
 
-    size_type getNumRows() override {
-        return nPrime_;
-    }
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k_; j++) {
 
-    size_type getNumCols() override {
-        return nPrime_;
-    }
+                        auto y = node.z + i * k_ + j - T_.size();
 
-    elem_type getNull() override {
-        return null_;
-    }
+                        if (L_[y] != null_) {
+                            func(dp + i, node.dq + j, y);
+                        }
 
+                    }
+                }
 
-    bool areRelated(size_type i, size_type j) override {
-        return checkLinkInit(i, j);
-    }
+            } else {
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+                frontiers[l + 1].clear();
 
-        std::vector<size_type> succs;
-//        successorsInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k_; j++) {
 
-        return succs;
+                        auto z = node.z + i * k_ + j;
 
-    }
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (n / k_), node.dq + j * (n / k_), R_.rank(z + 1) * k_ * k_));
+                        }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+                    }
+                }
 
-        std::vector<size_type> preds;
-        predecessorsInit(preds, j);
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, n / k_, dp + i * (n / k_), l + 1);
+                }
 
-        return preds;
+            }
 
-    }
+        }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    }
 
-        positions_type pairs;
-        rangeInit(pairs, i1, i2, j1, j2);
-//        rangeInit(pairs, i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
+    /* toCSR(), toCSC() */
 
-        return pairs;
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
 
-    }
+        offsets.assign(nPrime_ + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) {
-        return linkInRangeInit(i1, i2, j1, j2);
-//        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
-    }
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
 
-    size_type countLinks() override {
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
 
-        size_type res = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            res += L_[i];
-        }
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type y) {
 
-        return res;
+            auto pos = offsets[Transposed ? j : i]++;
 
-    }
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = L_[y];
 
+        });
 
-    /*
-     * General methods for completeness' sake (are redundant / useless for bool)
-     */
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
 
-    bool isNotNull(size_type i, size_type j) override {
-        return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
-        return areRelated(i, j);
-    }
+    /* unite(), intersect(), subtract(), symmetricDifference() */
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
-        return std::vector<elem_type>(getSuccessors(i).size(), true);
-    }
+    BasicK2Tree* combineInit(const BasicK2Tree& other, SetOperation op) const {
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
-        return getSuccessors(i);
-    }
+        if ((k_ != other.k_) || (h_ != other.h_)) {
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "Both K2Trees have to have the same arity (k) and height (h)."
+            ;
 
-        auto pos = getSuccessors(i);
+            throw std::runtime_error(err);
 
-        pairs_type succs;
-        for (auto j : pos) {
-            succs.push_back(ValuedPosition<elem_type>(i, j, true));
         }
 
-        return succs;
+        auto res = new BasicK2Tree();
 
-    }
+        res->k_ = k_;
+        res->h_ = h_;
+        res->nPrime_ = nPrime_;
+        res->null_ = null_;
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
-        return std::vector<elem_type>(getPredecessors(j).size(), true);
-    }
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        res->combine(*this, other, op, levels, 1, !L_.empty(), 0, !other.L_.empty(), 0);
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
-        return getPredecessors(j);
-    }
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res->T_ = bit_vector_type(total);
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-        auto pos = getPredecessors(j);
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
-        pairs_type preds;
-        for (auto i : pos) {
-            preds.push_back(ValuedPosition<elem_type>(i, j, true));
         }
 
-        return preds;
-
-    }
+        res->R_ = rank_type(&res->T_);
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
-    }
+        return res;
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
-
-        auto pos = getRange(i1, i2, j1, j2);
-
-        pairs_type pairs;
-        for (auto& p : pos) {
-            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
-        }
-
-        return pairs;
+    // merges the subtrees of the current node (on level l) of a and b, i.e. appends the children of this node in the result
+    // to levels resp. L_ and returns whether there are any; zA (zB) is the start of the block of children of the node in a (b)
+    // and only relevant if the node is non-empty in a (b), which is indicated by inA (inB)
+    bool combine(const BasicK2Tree& a, const BasicK2Tree& b, SetOperation op, std::vector<std::vector<bool>>& levels, size_type l, bool inA, size_type zA, bool inB, size_type zB) {
 
-    }
+        if (l == h_) {
 
-    std::vector<elem_type> getAllElements() override {
-        return std::vector<elem_type>(countLinks(), true);
-    }
+            std::vector<elem_type> C;
 
-    positions_type getAllPositions() override {
-        return getRange(0, nPrime_ - 1, 0, nPrime_ - 1);
-    }
+            for (size_type j = 0; j < k_ * k_; j++) {
 
-    pairs_type getAllValuedPositions() override {
+                auto valA = inA ? a.L_[zA + j - a.T_.size()] : a.null_;
+                auto valB = inB ? b.L_[zB + j - b.T_.size()] : b.null_;
 
-        auto pos = getAllPositions();
+                C.push_back(isInResult(op, valA != a.null_, valB != b.null_) ? ((valA != a.null_) ? valA : valB) : null_);
 
-        pairs_type pairs;
-        for (auto& p : pos) {
-            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
-        }
+            }
 
-        return pairs;
+            if (isAll(C, null_)) {
+                return false;
+            } else {
 
-    }
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
-        return linkInRangeInit(i1, i2, j1, j2);
-//        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
-    }
+            }
 
-    size_type countElements() override {
-        return countLinks();
-    }
+        } else {
 
+            std::vector<bool> C;
 
-    BasicK2Tree* clone() const override {
-        return new BasicK2Tree<elem_type>(*this);
-    }
+            for (size_type j = 0; j < k_ * k_; j++) {
 
-    void print(bool all = false) override {
+                bool childA = inA && a.T_[zA + j];
+                bool childB = inB && b.T_[zB + j];
 
-        std::cout << "### Parameters ###" << std::endl;
-        std::cout << "h  = " << h_ << std::endl;
-        std::cout << "k  = " << k_ << std::endl;
-        std::cout << "n' = " << nPrime_ << std::endl;
-        std::cout << "null = " << null_ << std::endl;
+                C.push_back(mayBeInResult(op, childA, childB) && combine(
+                        a,
+                        b,
+                        op,
+                        levels,
+                        l + 1,
+                        childA,
+                        childA ? a.R_.rank(zA + j + 1) * k_ * k_ : 0,
+                        childB,
+                        childB ? b.R_.rank(zB + j + 1) * k_ * k_ : 0
+                ));
 
-        if (all) {
+            }
 
-            std::cout << "### T ###" << std::endl;
-            for (size_type i = 0; i < T_.size(); i++) std::cout << T_[i];
-            std::cout << std::endl << std::endl;
+            if (isAllZero(C)) {
+                return false;
+            } else {
 
-            std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
-            std::cout << std::endl << std::endl;
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
 
-            std::cout << "### R ###" << std::endl;
-            printRanks(R_);
-            std::cout << std::endl;
+            }
 
         }
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
-    void setNull(size_type i, size_type j) override {
-        setInit(i, j);
-    }
+    /* transpose() */
 
-    size_type getFirstSuccessor(size_type i) override {
-//        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
-    }
+    BasicK2Tree* transposeInit() const {
 
+        auto res = new BasicK2Tree();
 
+        res->k_ = k_;
+        res->h_ = h_;
+        res->nPrime_ = nPrime_;
+        res->null_ = null_;
 
-private:
-    // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = std::vector<elem_type>(L_.size());
+        res->M_ = std::vector<elem_type>(M_.size());
 
-    // representation of the last level of the K2Tree (actual values of the relation)
-    bit_vector_type L_;
+        if (!L_.empty()) {
 
-    // rank data structure for navigation in T_
-    rank_type R_;
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            std::vector<size_type> ones(h_, 0); // next index in M_ on every level
+            for (size_type l = 1; l < h_ - 1; l++) {
 
-    size_type h_; // height of the K2Tree
-    size_type k_; // arity of the K2Tree
-    size_type nPrime_; // edge length of the represented relation matrix
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * k_ * k_;
+                ones[l] = R_.rank(cursors[l]);
 
-    elem_type null_; // null element
+            }
 
+            transposeBlock(res, cursors, ones, 1, 0);
 
-    /* helper method for construction from relation matrix */
+        }
 
-    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type n, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
+        res->R_ = rank_type(&res->T_);
 
-        std::vector<bool> C;
+        return res;
+
+    }
+
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors (and the maxima of the written 1-bits to M_ at the indices given by ones)
+    void transposeBlock(BasicK2Tree* res, std::vector<size_type>& cursors, std::vector<size_type>& ones, size_type l, size_type z) const {
 
         if (l == h_) {
 
             for (size_type i = 0; i < k_; i++) {
                 for (size_type j = 0; j < k_; j++) {
-                    C.push_back((((p + i) < numRows) && ((q + j) < numCols)) ? mat[p + i][q + j] : false);
+                    res->L_[cursors[l - 1]++] = L_[z + j * k_ + i - T_.size()];
                 }
             }
 
@@ -2244,802 +2705,2437 @@ private:
 
             for (size_type i = 0; i < k_; i++) {
                 for (size_type j = 0; j < k_; j++) {
-                    C.push_back(buildFromMatrix(mat, levels, numRows, numCols, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_)));
+
+                    size_type y = z + j * k_ + i;
+                    size_type pos = cursors[l - 1]++;
+
+                    if (T_[y]) {
+
+                        res->T_[pos] = true;
+
+                        size_type r = R_.rank(y + 1);
+                        if (r - 1 < M_.size()) {
+                            res->M_[ones[l - 1]++] = M_[r - 1];
+                        }
+
+                        transposeBlock(res, cursors, ones, l + 1, r * k_ * k_);
+
+                    }
+
                 }
             }
 
         }
 
+    }
 
-        if (isAllZero(C)) {
-            return false;
-        } else {
+    /* getSuccessorPositionsBatch(), expandRows() */
 
-            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
-            return true;
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
 
+        if (!L_.empty() && (first < last)) {
+            successorsBatch(rows, first, last, nPrime_ / k_, 0, 0, 0, func);
         }
 
     }
 
-    /* helper method for construction from relation lists */
-
-    bool buildFromLists(const RelationLists& lists, std::vector<RelationList::const_iterator>& cursors, std::vector<std::vector<bool>>& levels, size_type n, size_type l, size_type p, size_type q) {// 3.3.2
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children starts at z and whose children have edge length n);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type n, size_type dp, size_type dq, size_type z, Func& func) const {
 
-        std::vector<bool> C;
+        size_type lenT = T_.size();
 
-        if (l == h_) {
+        for (size_type t = first; t < last;) {
 
-            for (size_type i = 0; i < k_; i++) {
-                for (size_type j = 0; j < k_; j++) {
+            size_type r = (rows[t] - dp) / n;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / n == r)) e++;
 
-                    C.push_back(((p + i) < lists.size()) && (cursors[p + i] != lists[p + i].end()) && ((q + j) == *(cursors[p + i])));
-                    if (C.back()) cursors[p + i]++;
+            if (z >= lenT) {
 
+                for (size_type c = 0; c < k_; c++) {
+                    if (L_[z - lenT + r * k_ + c] != null_) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
                 }
-            }
 
-        } else {
+            } else {
 
-            for (size_type i = 0; i < k_; i++) {
-                for (size_type j = 0; j < k_; j++) {
-                    C.push_back(buildFromLists(lists, cursors, levels, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_)));
+                for (size_type c = 0, y = z + r * k_; c < k_; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, n / k_, dp + r * n, dq + c * n, R_.rank(y + 1) * k_ * k_, func);
+                    }
                 }
-            }
-
-        }
 
-        if (isAllZero(C)) {
-            return false;
-        } else {
+            }
 
-            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
-            return true;
+            t = e;
 
         }
 
     }
 
-    /* helper methods for construction from relation lists via temporary tree */
+};
 
-    void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
 
-        Node<bool>* root = new Node<bool>(false);
+/**
+ * Bool specialisation of BasicK2Tree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but makes use of some simplifications since the only non-null value is 1 / true.
+ */
+template<size_type K>
+class BasicK2Tree<bool, K> final : virtual public K2Tree<bool> {
 
-        for (size_type i = 0; i < lists.size(); i++) {
-            for (size_type j = 0; j < lists[i].size(); j++) {
-                insert(root, nPrime_, i, lists[i][j]);
-            }
-        }
+public:
+    typedef bool elem_type;
 
-        if (!root->isLeaf()) {
+    typedef K2Tree<elem_type>::matrix_type matrix_type;
+    typedef K2Tree<elem_type>::list_type list_type;
+    typedef K2Tree<elem_type>::positions_type positions_type;
+    typedef K2Tree<elem_type>::pairs_type pairs_type;
 
-            std::vector<bool> T, L;
+    static_assert((K != 1) && ((K & (K - 1)) == 0), "The compile-time arity (K) has to be 0 or a power of two.");
 
-            // traverse over tree and generate T and L while doing it
-            std::queue<Node<bool>*> queue;
-            Node<bool>* node;
-            Node<bool>* child;
-            queue.push(root);
 
-            while (!queue.empty()) {
+    BasicK2Tree() {
+        // nothing to do
+    }
 
-                node = queue.front();
-                queue.pop();
+    BasicK2Tree(const BasicK2Tree& other) {
 
-                for (size_type i = 0; i < k_ * k_; i++) {
+        h_ = other.h_;
+        k_ = other.k_;
+        nPrime_ = other.nPrime_;
+        null_ = other.null_;
 
-                    child = node->getChild(i);
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
 
-                    if (child != 0 && child->isLeaf()) {
-                        L.push_back(child->getLabel());
-                    } else {
+    }
 
-                        T.push_back(child != 0);
+    BasicK2Tree& operator=(const BasicK2Tree& other) {
 
-                        if (T.back()) {
-                            queue.push(child);
-                        }
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
 
-                    }
+        h_ = other.h_;
+        k_ = other.k_;
+        nPrime_ = other.nPrime_;
+        null_ = other.null_;
 
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
+
+        return *this;
+
+    }
+
+    /**
+     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
+     *
+     * Assumes that all rows of mat are equally long.
+     */
+    BasicK2Tree(const matrix_type& mat, const size_type k) {
+
+        null_ = false;
+
+        k_ = k;
+        checkArity();
+        h_ = std::max((size_type)1, logK(std::max(mat.size(), mat[0].size()), k_));
+        nPrime_ = size_type(pow(k_, h_));
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromMatrix(mat, levels, mat.size(), mat[0].size(), nPrime_, 1, 0, 0);
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
+     *
+     * The actually used method depends on parameter mode.
+     */
+    BasicK2Tree(const RelationLists& lists, const size_type k, const int mode) {
+
+        null_ = false;
+
+        size_type maxCol = 0;
+        for (auto& row : lists) {
+            for (auto& elem : row) {
+                maxCol = std::max(maxCol, elem);
+            }
+        }
+
+        k_ = k;
+        checkArity();
+        h_ = std::max((size_type)1, logK(std::max(lists.size(), maxCol + 1), k_));
+        nPrime_ = size_type(pow(k_, h_));
+
+        switch (mode) {
+
+            case 0: { // 3.3.2.
+
+                std::vector<std::vector<bool>> levels(h_);
+                std::vector<RelationList::const_iterator> cursors;
+                for (auto iter = lists.begin(); iter != lists.end(); iter++) {
+                    cursors.push_back(iter->begin());
+                }
+
+                buildFromLists(lists, cursors, levels, nPrime_, 1, 0, 0);
+
+                size_type total = 0;
+                for (size_type l = 0; l < h_ - 1; l++) {
+                    total += levels[l].size();
+                }
+                T_ = bit_vector_type(total);
+
+                bit_vector_type::iterator outIter = T_.begin();
+                for (size_type l = 0; l < h_ - 1; l++) {
+
+                    outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                    levels[l].clear();
+                    levels[l].shrink_to_fit();
+
+                }
+
+                L_ = bit_vector_type(levels[h_ - 1].size());
+                std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+                levels[h_ - 1].clear();
+                levels[h_ - 1].shrink_to_fit();
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 1: { // 3.3.3.
+
+                buildFromListsViaTree(lists);
+
+                R_ = rank_type(&T_);
+
+                break;
+
+            }
+
+            case 2: { // 3.3.4.
+
+                buildFromListsDynamicBitmaps(lists);
+
+                break;
+
+            }
+
+            default: {
+
+                buildFromListsDynamicBitmaps(lists);
+                break;
+
+            }
+
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     */
+    BasicK2Tree(positions_type& pairs, const size_type k) {
+
+        null_ = false;
+
+        size_type maxIndex = 0;
+        for (auto& p : pairs) {
+            maxIndex = std::max({maxIndex, p.first, p.second});
+        }
+
+        k_ = k;
+        checkArity();
+        h_ = std::max((size_type)1, logK(maxIndex + 1, k_));
+        nPrime_ = size_type(pow(k_, h_));
+
+        if (pairs.size() != 0) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+
+    // returns the height of the K2Tree
+    size_type getH() const {
+        return h_;
+    }
+
+    // returns the arity of the K2Tree
+    size_type getK() const {
+        return k_;
+    }
+
+    size_type getNumRows() const override {
+        return nPrime_;
+    }
+
+    size_type getNumCols() const override {
+        return nPrime_;
+    }
+
+    elem_type getNull() const override {
+        return null_;
+    }
+
+
+    bool areRelated(size_type i, size_type j) const override {
+        return checkLinkInit(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+
+        std::vector<size_type> succs;
+//        successorsInit(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
+
+        return succs;
+
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+
+        std::vector<size_type> preds;
+        predecessorsInit(preds, j);
+
+        return preds;
+
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        rangeInit(pairs, i1, i2, j1, j2);
+//        rangeInit(pairs, i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
+
+        return pairs;
+
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const {
+        return linkInRangeInit(i1, i2, j1, j2);
+//        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
+    }
+
+    size_type countLinks() const override {
+
+        size_type res = 0;
+        for (size_type i = 0; i < L_.size(); i++) {
+            res += L_[i];
+        }
+
+        return res;
+
+    }
+
+
+    /*
+     * General methods for completeness' sake (are redundant / useless for bool)
+     */
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return areRelated(i, j);
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+        return areRelated(i, j);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+        return std::vector<elem_type>(getSuccessors(i).size(), true);
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+        return getSuccessors(i);
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        auto pos = getSuccessors(i);
+
+        pairs_type succs;
+        for (auto j : pos) {
+            succs.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+        return std::vector<elem_type>(getPredecessors(j).size(), true);
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+        return getPredecessors(j);
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        auto pos = getPredecessors(j);
+
+        pairs_type preds;
+        for (auto i : pos) {
+            preds.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getRange(i1, i2, j1, j2);
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        auto pos = getRange(i1, i2, j1, j2);
+
+        pairs_type pairs;
+        for (auto& p : pos) {
+            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
+        }
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return std::vector<elem_type>(countLinks(), true);
+    }
+
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
+
+        return pairs;
+
+    }
+
+    pairs_type getAllValuedPositions() const override {
+
+        pairs_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(ValuedPosition<elem_type>(i, j, true)); });
+
+        return pairs;
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return linkInRangeInit(i1, i2, j1, j2);
+//        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
+    }
+
+    size_type countElements() const override {
+        return countLinks();
+    }
+
+
+    BasicK2Tree* clone() const override {
+        return new BasicK2Tree(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "h  = " << h_ << std::endl;
+        std::cout << "k  = " << k_ << std::endl;
+        std::cout << "n' = " << nPrime_ << std::endl;
+        std::cout << "null = " << null_ << std::endl;
+
+        if (all) {
+
+            std::cout << "### T ###" << std::endl;
+            for (size_type i = 0; i < T_.size(); i++) std::cout << T_[i];
+            std::cout << std::endl << std::endl;
+
+            std::cout << "### L ###" << std::endl;
+            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            std::cout << std::endl << std::endl;
+
+            std::cout << "### R ###" << std::endl;
+            printRanks(R_);
+            std::cout << std::endl;
+
+        }
+
+    }
+
+    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void setNull(size_type i, size_type j) override {
+        setInit(i, j);
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+//        return firstSuccessorInit(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void multiply(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<false>(x, y, 1);
+    }
+
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y) const override {
+        multiplyInit<true>(x, y, 1);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+    // multi-threaded version of multiply(), the top-level row bands are distributed among numThreads threads
+    void multiply(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<false>(x, y, numThreads);
+    }
+
+    // multi-threaded version of multiplyTransposed(), the top-level column bands are distributed among numThreads threads
+    void multiplyTransposed(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
+        multiplyInit<true>(x, y, numThreads);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j, true); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j, true); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i) with (i,j) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    BasicK2Tree* transpose() const {
+        return transposeInit();
+    }
+
+
+    /*
+     * Set operations on K2Trees with the same parameters (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this or the other relation
+    // (with the values of this relation for pairs in both)
+    BasicK2Tree* unite(const BasicK2Tree& other) const {
+        return combineInit(other, SET_UNION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in both relations (with the values of this relation)
+    BasicK2Tree* intersect(const BasicK2Tree& other) const {
+        return combineInit(other, SET_INTERSECTION);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in this, but not in the other relation
+    BasicK2Tree* subtract(const BasicK2Tree& other) const {
+        return combineInit(other, SET_DIFFERENCE);
+    }
+
+    // returns a new K2Tree (to be deleted by the caller) of all pairs in exactly one of the relations
+    BasicK2Tree* symmetricDifference(const BasicK2Tree& other) const {
+        return combineInit(other, SET_SYMMETRIC_DIFFERENCE);
+    }
+
+
+    /*
+     * Boolean matrix multiplication (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the composition of this and the other relation, i.e. of all pairs (i,j)
+    // with (i,m) in this and (m,j) in the other relation for some m (the boolean matrix product);
+    // the top-level submatrices of the result are distributed among numThreads threads
+    BasicK2Tree* compose(const BasicK2Tree& other, unsigned numThreads = 1) const {
+        return composeInit(other, numThreads);
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+    /*
+     * Triangle counting (not part of the K2Tree interface)
+     */
+
+    // regards R as an undirected graph (i.e. assumes that R is symmetric and ignores pairs (i,i)) and returns its number of triangles;
+    // the successors shared by two adjacent nodes are determined by descending both rows simultaneously (without materialising them)
+    // and blocks of rows are distributed among numThreads threads
+    size_type countTriangles(unsigned numThreads = 1) const {
+        return countTrianglesInit(nullptr, numThreads);
+    }
+
+    // as countTriangles(), but additionally stores the local clustering coefficient of every node in coefficients, i.e. the number of
+    // pairs of its neighbours that are adjacent divided by the number of pairs of its neighbours (0 for nodes with less than two neighbours)
+    size_type countTriangles(std::vector<double>& coefficients, unsigned numThreads = 1) const {
+        return countTrianglesInit(&coefficients, numThreads);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
+
+private:
+    // representation of all but the last levels of the K2Tree (internal structure)
+    bit_vector_type T_;
+
+    // representation of the last level of the K2Tree (actual values of the relation)
+    bit_vector_type L_;
+
+    // rank data structure for navigation in T_
+    rank_type R_;
+
+    size_type h_; // height of the K2Tree
+    size_type k_; // arity of the K2Tree
+    size_type nPrime_; // edge length of the represented relation matrix
+
+    elem_type null_; // null element
+
+
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((K > 0) && (k_ != K)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arity (k) has to be equal to the compile-time arity (K)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
+    /* helper method for construction from relation matrix */
+
+    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type n, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    C.push_back((((p + i) < numRows) && ((q + j) < numCols)) ? mat[p + i][q + j] : false);
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    C.push_back(buildFromMatrix(mat, levels, numRows, numCols, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_)));
+                }
+            }
+
+        }
+
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
+    /* helper method for construction from relation lists */
+
+    bool buildFromLists(const RelationLists& lists, std::vector<RelationList::const_iterator>& cursors, std::vector<std::vector<bool>>& levels, size_type n, size_type l, size_type p, size_type q) {// 3.3.2
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+
+                    C.push_back(((p + i) < lists.size()) && (cursors[p + i] != lists[p + i].end()) && ((q + j) == *(cursors[p + i])));
+                    if (C.back()) cursors[p + i]++;
+
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    C.push_back(buildFromLists(lists, cursors, levels, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_)));
+                }
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
+    /* helper methods for construction from relation lists via temporary tree */
+
+    void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
+
+        Node<bool>* root = new Node<bool>(false);
+
+        for (size_type i = 0; i < lists.size(); i++) {
+            for (size_type j = 0; j < lists[i].size(); j++) {
+                insert(root, nPrime_, i, lists[i][j]);
+            }
+        }
+
+        if (!root->isLeaf()) {
+
+            std::vector<bool> T, L;
+
+            // traverse over tree and generate T and L while doing it
+            std::queue<Node<bool>*> queue;
+            Node<bool>* node;
+            Node<bool>* child;
+            queue.push(root);
+
+            while (!queue.empty()) {
+
+                node = queue.front();
+                queue.pop();
+
+                for (size_type i = 0; i < k_ * k_; i++) {
+
+                    child = node->getChild(i);
+
+                    if (child != 0 && child->isLeaf()) {
+                        L.push_back(child->getLabel());
+                    } else {
+
+                        T.push_back(child != 0);
+
+                        if (T.back()) {
+                            queue.push(child);
+                        }
+
+                    }
+
+                }
+
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        delete root;
+
+    }
+
+    void insert(Node<bool>* node, size_type n, size_type p, size_type q) {
+
+        if (n == k_) {
+
+            if (node->isLeaf()) {
+                node->turnInternal(k_ * k_, true);
+            }
+
+            node->addChild(p * k_ + q, true);
+
+        } else {
+
+            if (node->isLeaf()) {
+                node->turnInternal(k_ * k_, false);
+            }
+
+            size_type z = (p / (n / k_)) * k_ + q / (n / k_);
+
+            insert(node->hasChild(z) ? node->getChild(z) : node->addChild(z, true), n / k_, p % (n / k_), q % (n / k_));
+
+        }
+
+    }
+
+    /* helper methods for construction from relation lists via dynamic bitmap representations */
+
+    void buildFromListsDynamicBitmaps(const RelationLists& lists) {// 3.3.4, currently no succinct dynamic bitmaps
+
+        if (h_ == 1) {
+
+            L_ = bit_vector_type(k_ * k_, 0);
+
+            for (size_type i = 0; i < lists.size(); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    L_[i * k_ + lists[i][j]] = 1;
+                }
+            }
+
+            if (isAllZero(L_)) {
+                L_ = bit_vector_type(0);
+            }
+
+        } else {
+
+            std::vector<bool> T, L;
+            NaiveDynamicRank R;
+
+            for (size_type i = 0; i < lists.size(); i++) {
+                for (size_type j = 0; j < lists[i].size(); j++) {
+                    insertInit(T, L, R, i, lists[i][j]);
+                }
+            }
+
+            L_ = bit_vector_type(L.size());
+            std::move(L.begin(), L.end(), L_.begin());
+            L.clear();
+            L.shrink_to_fit();
+
+            T_ = bit_vector_type(T.size());
+            std::move(T.begin(), T.end(), T_.begin());
+
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+
+        if (T.empty()) {
+
+            T = std::vector<bool>(k_ * k_);
+            R = NaiveDynamicRank(T);
+
+        }
+
+        insert(T, L, R, nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_), 1);
+
+    }
+
+    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
+
+        if (!T[z]) {
+
+            T[z] = 1;
+            R.increaseFrom(z + 1);
+
+            size_type y = R.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_);
+
+            if ((l + 1) == h_) {
+
+                L.insert(L.begin() + R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, 0);
+                L[y - T.size()] = 1;
+
+            } else {
+
+                T.insert(T.begin() + R.rank(z + 1) * k_ * k_, k_ * k_, 0);
+                R.insert(R.rank(z + 1) * k_ * k_ + 1, k_ * k_);
+
+                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), y, l + 1);
+
+            }
+
+        } else {
+
+            size_type y = R.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_);
+
+            if ((l + 1) == h_) {
+                L[y - T.size()] = 1;
+            } else {
+                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), y, l + 1);
+            }
+
+        }
+
+    }
+
+    /* helper methods for inplace construction from single list of pairs */
+
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width) const {
+        return ((pair.first - sp.firstRow) / width) * k_ + (pair.second - sp.firstCol) / width;
+    }
+
+    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
+
+        std::vector<size_type> counts(sup);
+
+        // determine key frequencies
+        for (size_type i = sp.left; i < sp.right; i++) {
+            counts[computeKey(pairs[i], sp, width)]++;
+        }
+
+        // determine starting index for each key
+        size_type total = 0;
+        size_type tmp;
+
+        for (size_type key = 0; key < sup; key++) {
+
+            tmp = counts[key];
+            counts[key] = total;
+            total += tmp;
+
+            intervals[key].first = counts[key];
+            intervals[key].second = total;
+
+        }
+
+        // reorder pairs of current subproblem
+        positions_type tmpPairs(sp.right - sp.left + 1);
+        for (size_type i = sp.left; i < sp.right; i++) {
+
+            tmpPairs[counts[computeKey(pairs[i], sp, width)]] = pairs[i];
+            counts[computeKey(pairs[i], sp, width)]++;
+
+        }
+
+        for (size_type i = sp.left; i < sp.right; i++) {
+            pairs[i] = tmpPairs[i - sp.left];
+        }
+
+    }
+
+    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+
+        std::queue<Subproblem> queue;
+        Subproblem sp;
+        size_type S;
+        std::vector<std::pair<size_type, size_type>> intervals(k_ * k_);
+        std::vector<bool> T, L;
+        bit_vector_type appToL;
+
+        queue.push(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+
+        while (!queue.empty()) {
+
+            sp = queue.front();
+            queue.pop();
+
+            S = sp.lastRow - sp.firstRow + 1;
+
+            if (S > k_) {
+
+                countingSort(pairs, intervals, sp, S / k_, k_ * k_);
+
+                for (size_type i = 0; i < k_ * k_; i++) {
+
+                    if (intervals[i].first < intervals[i].second) {
+
+                        T.push_back(true);
+                        queue.push(Subproblem(
+                                sp.firstRow + (i / k_) * (S / k_),
+                                sp.firstRow + (i / k_ + 1) * (S / k_) - 1,
+                                sp.firstCol + (i % k_) * (S / k_),
+                                sp.firstCol + (i % k_ + 1) * (S / k_) - 1,
+                                sp.left + intervals[i].first,
+                                sp.left + intervals[i].second
+                        ));
+
+                    } else {
+                        T.push_back(false);
+                    }
+
+                }
+
+            } else {
+
+                appToL = bit_vector_type(k_ * k_);
+
+                for (size_type i = sp.left; i < sp.right; i++) {
+                    appToL[(pairs[i].first - sp.firstRow) * k_ + (pairs[i].second - sp.firstCol)] = true;
+                }
+
+                L.insert(L.end(), appToL.begin(), appToL.end());
+
+            }
+
+        }
+
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
+
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
+
+    }
+
+
+    /* areRelated() */
+
+    bool checkLinkInit(size_type p, size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return !L_.empty() && descend(p, q, z) && L_[z - T_.size()];
+
+        }
+
+        return (L_.empty()) ? false : checkLink(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+
+    }
+
+    bool checkLink(size_type n, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+            return L_[z - T_.size()];
+        } else {
+            return T_[z] ? checkLink(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : false;
+        }
+
+    }
+
+    /* isNotNull(), getElement() and areRelated() with compile-time arity */
+
+    // descends to the leaf of (p, q) using shifts and masks instead of divisions (requires K > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type p, size_type q, size_type& z) const {
+
+        const size_type logK = log2Pow2(K);
+        size_type s = (h_ - 1) * logK; // log2(n / K) on the current level
+
+        z = (p >> s) * K + (q >> s);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            s -= logK;
+            z = R_.rank(z + 1) * K * K + ((p >> s) & (K - 1)) * K + ((q >> s) & (K - 1));
+
+        }
+
+        return true;
+
+    }
+
+    /* getSuccessors() */
+
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
+
+        if (L_.empty()) return;
+
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
+        size_type lenT = T_.size();
+
+        if (lenT == 0) {
+
+            size_type offset = p * nPrime_;
+            forEachSetBit(L_, offset, nPrime_, [&](size_type i) { succs.push_back(i); });
+
+        } else {
+
+            // successorsPosInit
+            size_type n = nPrime_/ k_;
+            size_type relP = p;
+            for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
+                queue.emplace_back(dq, z);
+            }
+
+            // successorsPos
+            relP %= n;
+            n /= k_;
+            for (; n > 1; relP %= n, n /= k_) {
+
+                for (size_type i = 0; i < queue.size(); i++) {
+
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
+
+                    if (T_[cur.z]) {
+
+                        auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
+
+                        forEachSetBit(T_, y, k_, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
+
+                    }
+
+                }
+
+                queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
+
+            }
+
+
+            for (size_type i = 0; i < queue.size(); i++) {
+
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
+
+                if (T_[cur.z]) {
+
+                    auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
+
+                    forEachSetBit(L_, y, k_, [&](size_type j) { succs.push_back(cur.dq + j * n); });
+
+                }
+
+            }
+
+        }
+
+    }
+
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
+
+        if (!L_.empty()) {
+
+            size_type y = k_ * (p / (nPrime_ / k_));
+
+            for (size_type j = 0; j < k_; j++) {
+                successors(succs, nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j);
+            }
+
+        }
+
+    }
+
+    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                succs.push_back(q);
+            }
+
+        } else {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+
+                for (size_type j = 0; j < k_; j++) {
+                    successors(succs, n / k_, p % (n / k_), q + (n / k_) * j, y + j);
+                }
+
+            }
+
+        }
+
+
+    }
+
+    /* getFirstSuccessor() */
+
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
+
+        if (L_.empty()) return nPrime_;
+
+        if (T_.size() == 0) {
+
+            size_type offset = p * nPrime_;
+            for (size_type i = 0; i < nPrime_; i++) {
+                if (L_[offset + i]) {
+                    return i;
+                }
+            }
+
+        } else {
+
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
+
+            while (!stack.empty()) {
+
+                auto& cur = stack.back();
+
+                if (cur.j == k_) {
+                    stack.pop_back();
+                } else {
+
+                    if (cur.z >= T_.size()) {
+
+                        if (L_[cur.z - T_.size()]) {
+                            return cur.dq;
+                        }
+
+                    } else {
+
+                        if (T_[cur.z]) {
+                            stack.emplace_back(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
+                        }
+
+                    }
+
+                    cur.dq += cur.nc;
+                    cur.z++;
+                    cur.j++;
+
+                }
+
+            }
+        }
+
+        return nPrime_;
+
+    }
+
+    size_type firstSuccessorInit(size_type p) const {
+
+        size_type pos = nPrime_;
+
+        if (!L_.empty()) {
+
+            size_type y = k_ * (p / (nPrime_ / k_));
+
+            for (size_type j = 0; j < k_ && pos == nPrime_; j++) {
+                pos = firstSuccessor(nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j);
+            }
+
+        }
+
+        return pos;
+
+    }
+
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) const {
+
+        size_type pos = nPrime_;
+
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                pos = q;
+            }
+
+        } else {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+
+                for (size_type j = 0; j < k_ && pos == nPrime_; j++) {
+                    pos = firstSuccessor(n / k_, p % (n / k_), q + (n / k_) * j, y + j);
+                }
+
+            }
+
+        }
+
+        return pos;
+
+    }
+
+    /* getPredecessors() */
+
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type y = q / (nPrime_ / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+                predecessors(preds, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_);
+            }
+
+        }
+
+    }
+
+    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                preds.push_back(p);
+            }
+
+        } else {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+
+                for (size_type i = 0; i < k_; i++) {
+                    predecessors(preds, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_);
                 }
 
             }
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+        }
 
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+    }
+
+    /* getFirstPredecessorIn() */
+
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type y = q / (nPrime_ / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+
+                auto p = firstPredecessorIn(rows, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_);
+
+                if (p < nPrime_) {
+                    return p;
+                }
+
+            }
 
         }
 
-        delete root;
+        return nPrime_;
+
+    }
+
+    // same descent as in predecessors(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type n, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+            return (L_[z - T_.size()] && rows[p]) ? p : nPrime_;
+        }
+
+        if (T_[z]) {
+
+            size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+
+                auto res = firstPredecessorIn(rows, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_);
+
+                if (res < nPrime_) {
+                    return res;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
+    /* getRange() */
+
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (!L_.empty()) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+                    range(
+                            pairs,
+                            nPrime_ / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
+                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
+                            (nPrime_ / k_) * i,
+                            (nPrime_ / k_) * j,
+                            k_ * i + j
+                    );
+                }
+
+            }
+
+        }
+
+    }
+
+    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (L_[z - T_.size()]) {
+                pairs.push_back(std::make_pair(dp, dq));
+            }
+
+        } else {
+
+            if (T_[z]) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+                        forEachSetBit(L_, y - T_.size() + k_ * i + q1, q2 - q1 + 1, [&](size_type j) { pairs.push_back(std::make_pair(dp + i, dq + q1 + j)); });
+                    }
+
+                    return;
+
+                }
+
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+                    p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                        range(
+                                pairs,
+                                n / k_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                                (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                                dp + (n / k_) * i,
+                                dq + (n / k_) * j,
+                                y + k_ * i + j
+                        );
+                    }
+
+                }
+
+            }
+
+        }
+
+    }
+
+    /* linkInRange() */
+
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (!L_.empty()) {
+
+            // dividing by k_ (as stated in the paper) in not correct,
+            // because it does not use the size of the currently considered submatrix but of its submatrices
+            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
+                return 1;
+            }
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? (p2 % (nPrime_ / k_)) : nPrime_ / k_ - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+
+                    if (linkInRange(nPrime_ / k_, p1Prime, p2Prime, (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)), (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : nPrime_ / k_ - 1, k_ * i + j)) {
+                        return true;
+                    }
+
+                }
+
+            }
+
+        }
+
+        return false;
+
+    }
+
+    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            return L_[z - T_.size()];
+
+        } else {
+
+            if (T_[z]) {
+
+                // dividing by k_ (as stated in the paper) in not correct,
+                // because it does not use the size of the currently considered submatrix but of its submatrices
+                if ((p1 == 0) && (q1 == 0) && (p2 == (n /*/ k_*/ - 1)) && (q2 == (n /*/ k_*/ - 1))) {
+                    return true;
+                }
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+                    p2Prime = (i == p2 / (n / k_)) ? (p2 % (n / k_)) : n / k_ - 1;
+
+                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+
+                        if (linkInRange(n / k_, p1Prime, p2Prime, (j == q1 / (n / k_)) * (q1 % (n / k_)), (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1, y + k_ * i + j)) {
+                            return true;
+                        }
+
+                    }
+
+                }
+
+            }
+
+            return false;
+
+        }
+
+    }
+
+
+    /* setNull() */
+
+    void setInit(size_type p, size_type q) {
+
+        if (!L_.empty()) {
+            set(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+        }
+
+    }
+
+    void set(size_type n, size_type p, size_type q, size_type z) {
+
+        if (z >= T_.size()) {
+            L_[z - T_.size()] = null_;
+        } else {
+
+            if (T_[z]) {
+                set(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_));
+            }
+
+        }
 
     }
 
-    void insert(Node<bool>* node, size_type n, size_type p, size_type q) {
 
-        if (n == k_) {
+    /* multiply() / multiplyTransposed() */
 
-            if (node->isLeaf()) {
-                node->turnInternal(k_ * k_, true);
-            }
+    template<bool Transposed>
+    void multiplyInit(const std::vector<double>& x, std::vector<double>& y, unsigned numThreads) const {
 
-            node->addChild(p * k_ + q, true);
+        std::fill(y.begin(), y.end(), 0.0);
 
-        } else {
+        if (L_.empty()) return;
 
-            if (node->isLeaf()) {
-                node->turnInternal(k_ * k_, false);
-            }
+        if ((numThreads <= 1) || (T_.size() == 0)) {
 
-            size_type z = (p / (n / k_)) * k_ + q / (n / k_);
+            multiplyBlock<Transposed>(x, y, nPrime_ / k_, 0, 0, 0);
+            return;
 
-            insert(node->hasChild(z) ? node->getChild(z) : node->addChild(z, true), n / k_, p % (n / k_), q % (n / k_));
+        }
 
+        // determine the submatrices on the shallowest level that provides enough row (column) bands for all threads
+        size_type n = nPrime_ / k_;
+        size_type bands = k_;
+        std::vector<SubmatrixInfo> level, nextLevel;
+        for (size_type i = 0; i < k_; i++) {
+            for (size_type j = 0; j < k_; j++) {
+                level.push_back(SubmatrixInfo(i * n, j * n, i * k_ + j));
+            }
         }
 
-    }
+        for (; (bands < numThreads) && (n > 1); n /= k_, bands *= k_) {
 
-    /* helper methods for construction from relation lists via dynamic bitmap representations */
+            for (auto& cur : level) {
 
-    void buildFromListsDynamicBitmaps(const RelationLists& lists) {// 3.3.4, currently no succinct dynamic bitmaps
+                if (T_[cur.z]) {
 
-        if (h_ == 1) {
+                    size_type pos = R_.rank(cur.z + 1) * k_ * k_;
 
-            L_ = bit_vector_type(k_ * k_, 0);
+                    for (size_type i = 0; i < k_; i++) {
+                        for (size_type j = 0; j < k_; j++) {
+                            nextLevel.push_back(SubmatrixInfo(cur.dp + i * (n / k_), cur.dq + j * (n / k_), pos + i * k_ + j));
+                        }
+                    }
 
-            for (size_type i = 0; i < lists.size(); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    L_[i * k_ + lists[i][j]] = 1;
                 }
-            }
 
-            if (isAllZero(L_)) {
-                L_ = bit_vector_type(0);
             }
 
-        } else {
+            level.swap(nextLevel);
+            nextLevel.clear();
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+        }
 
-            for (size_type i = 0; i < lists.size(); i++) {
-                for (size_type j = 0; j < lists[i].size(); j++) {
-                    insertInit(T, L, R, i, lists[i][j]);
-                }
-            }
+        // all submatrices of a band write to the same entries of y and are therefore processed by the same thread
+        std::stable_sort(level.begin(), level.end(), [](const SubmatrixInfo& a, const SubmatrixInfo& b) {
+            return Transposed ? (a.dq < b.dq) : (a.dp < b.dp);
+        });
 
-            L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+        std::vector<size_type> bandStarts;
+        for (size_type t = 0; t < level.size(); t++) {
+            if ((t == 0) || (Transposed ? (level[t].dq != level[t - 1].dq) : (level[t].dp != level[t - 1].dp))) {
+                bandStarts.push_back(t);
+            }
+        }
+        bandStarts.push_back(level.size());
 
-            T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+        std::atomic<size_type> nextBand(0);
+        std::vector<std::thread> workers;
 
+        for (unsigned w = 0; w < numThreads; w++) {
+            workers.emplace_back([&]() {
+                for (size_type b = nextBand++; b + 1 < bandStarts.size(); b = nextBand++) {
+                    for (size_type t = bandStarts[b]; t < bandStarts[b + 1]; t++) {
+                        multiplyNode<Transposed>(x, y, n, level[t].dp, level[t].dq, level[t].z);
+                    }
+                }
+            });
         }
 
-        R_ = rank_type(&T_);
+        for (auto& w : workers) {
+            w.join();
+        }
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+    template<bool Transposed>
+    void multiplyNode(const std::vector<double>& x, std::vector<double>& y, size_type n, size_type dp, size_type dq, size_type z) const {
 
-        if (T.empty()) {
+        if (z >= T_.size()) {
 
-            T = std::vector<bool>(k_ * k_);
-            R = NaiveDynamicRank(T);
+            if (L_[z - T_.size()]) {
+                y[Transposed ? dq : dp] += x[Transposed ? dp : dq];
+            }
 
+        } else if (T_[z]) {
+            multiplyBlock<Transposed>(x, y, n / k_, dp, dq, R_.rank(z + 1) * k_ * k_);
         }
 
-        insert(T, L, R, nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_), 1);
-
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
-
-        if (!T[z]) {
-
-            T[z] = 1;
-            R.increaseFrom(z + 1);
-
-            size_type y = R.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_);
-
-            if ((l + 1) == h_) {
-
-                L.insert(L.begin() + R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, 0);
-                L[y - T.size()] = 1;
+    // processes the block of children starting at index z in the (conceptual concatenation of) T and L,
+    // n is the edge length of the children
+    template<bool Transposed>
+    void multiplyBlock(const std::vector<double>& x, std::vector<double>& y, size_type n, size_type dp, size_type dq, size_type z) const {
 
-            } else {
+        size_type lenT = T_.size();
 
-                T.insert(T.begin() + R.rank(z + 1) * k_ * k_, k_ * k_, 0);
-                R.insert(R.rank(z + 1) * k_ * k_ + 1, k_ * k_);
+        if (z >= lenT) {
 
-                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), y, l + 1);
+            size_type pos = z - lenT;
 
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++, pos++) {
+                    if (L_[pos]) {
+                        y[Transposed ? dq + j : dp + i] += x[Transposed ? dp + i : dq + j];
+                    }
+                }
             }
 
         } else {
 
-            size_type y = R.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_);
+            size_type pos = z;
 
-            if ((l + 1) == h_) {
-                L[y - T.size()] = 1;
-            } else {
-                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), y, l + 1);
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++, pos++) {
+                    if (T_[pos]) {
+                        multiplyBlock<Transposed>(x, y, n / k_, dp + i * n, dq + j * n, R_.rank(pos + 1) * k_ * k_);
+                    }
+                }
             }
 
         }
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
+    /* getSuccessorPositionsBatch(), expandRows() */
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width) {
-        return ((pair.first - sp.firstRow) / width) * k_ + (pair.second - sp.firstCol) / width;
-    }
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+        if (!L_.empty() && (first < last)) {
+            successorsBatch(rows, first, last, nPrime_ / k_, 0, 0, 0, func);
+        }
 
-        std::vector<size_type> counts(sup);
+    }
 
-        // determine key frequencies
-        for (size_type i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, width)]++;
-        }
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children starts at z and whose children have edge length n);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type n, size_type dp, size_type dq, size_type z, Func& func) const {
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+        size_type lenT = T_.size();
 
-        for (size_type key = 0; key < sup; key++) {
+        for (size_type t = first; t < last;) {
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+            size_type r = (rows[t] - dp) / n;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / n == r)) e++;
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            if (z >= lenT) {
 
-        }
+                for (size_type c = 0; c < k_; c++) {
+                    if (L_[z - lenT + r * k_ + c]) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
+                }
 
-        // reorder pairs of current subproblem
-        positions_type tmpPairs(sp.right - sp.left + 1);
-        for (size_type i = sp.left; i < sp.right; i++) {
+            } else {
 
-            tmpPairs[counts[computeKey(pairs[i], sp, width)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, width)]++;
+                for (size_type c = 0, y = z + r * k_; c < k_; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, n / k_, dp + r * n, dq + c * n, R_.rank(y + 1) * k_ * k_, func);
+                    }
+                }
 
-        }
+            }
+
+            t = e;
 
-        for (size_type i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
         }
 
     }
 
-    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type S;
-        std::vector<std::pair<size_type, size_type>> intervals(k_ * k_);
-        std::vector<bool> T, L;
-        bit_vector_type appToL;
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
 
-        queue.push(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        if (L_.empty()) return;
 
-        while (!queue.empty()) {
+        size_type numLevels = h_ - 1;
+        size_type kSq = k_ * k_;
 
-            sp = queue.front();
-            queue.pop();
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), n(numLevels + 1, nPrime_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
 
-            S = sp.lastRow - sp.firstRow + 1;
+        for (size_type l = 0; l < numLevels; l++) {
 
-            if (S > k_) {
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * kSq;
+            n[l + 1] = n[l] / k_;
 
-                countingSort(pairs, intervals, sp, S / k_, k_ * k_);
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
 
-                for (size_type i = 0; i < k_ * k_; i++) {
+        }
 
-                    if (intervals[i].first < intervals[i].second) {
+        size_type l = 0; // topmost level whose cursor has been moved
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
-                                sp.firstRow + (i / k_) * (S / k_),
-                                sp.firstRow + (i / k_ + 1) * (S / k_) - 1,
-                                sp.firstCol + (i % k_) * (S / k_),
-                                sp.firstCol + (i % k_ + 1) * (S / k_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
-                        ));
+        for (size_type y = 0; y < L_.size(); y += kSq) {
 
-                    } else {
-                        T.push_back(false);
-                    }
+            for (; l < numLevels; l++) {
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % kSq / k_) * n[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % k_) * n[l + 1];
+            }
 
+            for (size_type z = 0; z < kSq; z++) {
+                if (L_[y + z]) {
+                    func(dp[numLevels] + z / k_, dq[numLevels] + z % k_, y + z);
                 }
+            }
 
-            } else {
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
 
-                appToL = bit_vector_type(k_ * k_);
+                l--;
+                size_type block = (cur[l] - start[l]) / kSq;
 
-                for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * k_ + (pairs[i].second - sp.firstCol)] = true;
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
                 }
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
+                steps = (cur[l] - start[l]) / kSq - block;
 
             }
 
         }
 
-        L_ = bit_vector_type(L.size());
-        std::move(L.begin(), L.end(), L_.begin());
-        L.clear();
-        L.shrink_to_fit();
-
-        T_ = bit_vector_type(T.size());
-        std::move(T.begin(), T.end(), T_.begin());
-
     }
 
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
 
-    /* areRelated() */
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of nPrime_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
 
-    bool checkLinkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : checkLink(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
-    }
+        if (!L_.empty()) {
 
-    bool checkLink(size_type n, size_type p, size_type q, size_type z) {
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
+
+            rowMajorScan(func, frontiers, nPrime_, 0, 0);
 
-        if (z >= T_.size()) {
-            return L_[z - T_.size()];
-        } else {
-            return T_[z] ? checkLink(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : false;
         }
 
     }
 
-    /* getSuccessors() */
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the n rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type n, size_type dp, size_type l) const {
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+        for (size_type i = 0; i < k_; i++) {
 
-        if (L_.empty()) return;
+            if (l == h_ - 1) {
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
-        size_type lenT = T_.size();
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k_; j++) {
 
-        if (lenT == 0) {
+                        auto y = node.z + i * k_ + j - T_.size();
 
-            size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
-                    succs.push_back(i);
+                        if (L_[y]) {
+                            func(dp + i, node.dq + j, y);
+                        }
+
+                    }
                 }
-            }
 
-        } else {
+            } else {
+
+                frontiers[l + 1].clear();
+
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k_; j++) {
+
+                        auto z = node.z + i * k_ + j;
+
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (n / k_), node.dq + j * (n / k_), R_.rank(z + 1) * k_ * k_));
+                        }
+
+                    }
+                }
+
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, n / k_, dp + i * (n / k_), l + 1);
+                }
 
-            // successorsPosInit
-            size_type n = nPrime_/ k_;
-            size_type relP = p;
-            for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
-                queue.push(SubrowInfo(dq, z));
             }
 
-            // successorsPos
-            relP %= n;
-            n /= k_;
-            for (; n > 1; relP %= n, n /= k_) {
+        }
 
-                while (!queue.empty()) {
+    }
 
-                    auto& cur = queue.front();
+    /* toCSR(), toCSC() */
 
-                    if (T_[cur.z]) {
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
 
-                        auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
+        offsets.assign(nPrime_ + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
 
-                        for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
 
-                    }
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
 
-                    queue.pop();
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type) {
 
-                }
+            auto pos = offsets[Transposed ? j : i]++;
 
-                queue.swap(nextLevelQueue);
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = true;
 
-            }
+        });
 
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
 
-            while (!queue.empty()) {
+    }
 
-                auto& cur = queue.front();
+    /* unite(), intersect(), subtract(), symmetricDifference() */
 
-                if (T_[cur.z]) {
+    BasicK2Tree* combineInit(const BasicK2Tree& other, SetOperation op) const {
 
-                    auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
+        if ((k_ != other.k_) || (h_ != other.h_)) {
 
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            succs.push_back(newDq);
-                        }
-                    }
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "Both K2Trees have to have the same arity (k) and height (h)."
+            ;
 
-                }
+            throw std::runtime_error(err);
 
-                queue.pop();
+        }
 
-            }
+        auto res = new BasicK2Tree();
 
+        res->k_ = k_;
+        res->h_ = h_;
+        res->nPrime_ = nPrime_;
+        res->null_ = false;
+
+        std::vector<std::vector<bool>> levels(h_);
+        res->combine(*this, other, op, levels, 1, !L_.empty(), 0, !other.L_.empty(), 0);
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
         }
+        res->T_ = bit_vector_type(total);
 
-    }
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
-        if (!L_.empty()) {
+        }
 
-            size_type y = k_ * (p / (nPrime_ / k_));
+        res->L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), res->L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
 
-            for (size_type j = 0; j < k_; j++) {
-                successors(succs, nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j);
-            }
+        res->R_ = rank_type(&res->T_);
 
-        }
+        return res;
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    // merges the subtrees of the current node (on level l) of a and b, i.e. appends the children of this node in the result
+    // to levels resp. L_ and returns whether there are any; zA (zB) is the start of the block of children of the node in a (b)
+    // and only relevant if the node is non-empty in a (b), which is indicated by inA (inB)
+    bool combine(const BasicK2Tree& a, const BasicK2Tree& b, SetOperation op, std::vector<std::vector<bool>>& levels, size_type l, bool inA, size_type zA, bool inB, size_type zB) {
 
-        if (z >= T_.size()) {
+        std::vector<bool> C;
 
-            if (L_[z - T_.size()]) {
-                succs.push_back(q);
+        if (l == h_) {
+
+            for (size_type j = 0; j < k_ * k_; j++) {
+                C.push_back(isInResult(op, inA && a.L_[zA + j - a.T_.size()], inB && b.L_[zB + j - b.T_.size()]));
             }
 
         } else {
 
-            if (T_[z]) {
+            for (size_type j = 0; j < k_ * k_; j++) {
 
-                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+                bool childA = inA && a.T_[zA + j];
+                bool childB = inB && b.T_[zB + j];
 
-                for (size_type j = 0; j < k_; j++) {
-                    successors(succs, n / k_, p % (n / k_), q + (n / k_) * j, y + j);
-                }
+                C.push_back(mayBeInResult(op, childA, childB) && combine(
+                        a,
+                        b,
+                        op,
+                        levels,
+                        l + 1,
+                        childA,
+                        childA ? a.R_.rank(zA + j + 1) * k_ * k_ : 0,
+                        childB,
+                        childB ? b.R_.rank(zB + j + 1) * k_ * k_ : 0
+                ));
 
             }
 
         }
 
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
 
     }
 
-    /* getFirstSuccessor() */
+    /* compose() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    BasicK2Tree* composeInit(const BasicK2Tree& other, unsigned numThreads) const {
 
-        if (L_.empty()) return nPrime_;
+        if ((k_ != other.k_) || (h_ != other.h_)) {
 
-        if (T_.size() == 0) {
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "Both K2Trees have to have the same arity (k) and height (h)."
+            ;
 
-            size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
-                    return i;
-                }
-            }
+            throw std::runtime_error(err);
 
-        } else {
+        }
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
+        auto res = new BasicK2Tree();
 
-            while (!stack.empty()) {
+        res->k_ = k_;
+        res->h_ = h_;
+        res->nPrime_ = nPrime_;
+        res->null_ = false;
 
-                auto& cur = stack.top();
+        std::vector<std::vector<bool>> levels(h_);
 
-                if (cur.j == k_) {
-                    stack.pop();
-                } else {
+        if (!L_.empty() && !other.L_.empty()) {
 
-                    if (cur.z >= T_.size()) {
+            std::vector<std::pair<size_type, size_type>> root(1, std::make_pair(0, 0));
 
-                        if (L_[cur.z - T_.size()]) {
-                            return cur.dq;
-                        }
+            if ((numThreads <= 1) || (h_ == 1)) {
+                res->composeBlocks(*this, other, root, levels, 1);
+            } else {
 
-                    } else {
+                // every top-level submatrix of the result is computed independently into its own levels,
+                // which are concatenated afterwards (as all submatrices of a level are stored from left to right)
+                size_type num = res->k_ * res->k_;
+                std::vector<std::vector<std::vector<bool>>> partLevels(num, std::vector<std::vector<bool>>(h_));
+                std::vector<char> nonEmpty(num, false);
 
-                        if (T_[cur.z]) {
-                            stack.emplace(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
-                        }
+                std::atomic<size_type> nextPart(0);
+                std::vector<std::thread> workers;
 
-                    }
+                for (unsigned w = 0; w < numThreads; w++) {
+                    workers.emplace_back([&]() {
+                        for (size_type t = nextPart++; t < num; t = nextPart++) {
 
-                    cur.dq += cur.nc;
-                    cur.z++;
-                    cur.j++;
+                            auto blocks = res->composeChildren(*this, other, root, t / res->k_, t % res->k_);
+                            nonEmpty[t] = !blocks.empty() && res->composeBlocks(*this, other, blocks, partLevels[t], 2);
 
+                        }
+                    });
                 }
 
-            }
-        }
+                for (auto& w : workers) {
+                    w.join();
+                }
 
-        return nPrime_;
+                if (std::find(nonEmpty.begin(), nonEmpty.end(), true) != nonEmpty.end()) {
 
-    }
+                    levels[0].assign(nonEmpty.begin(), nonEmpty.end());
 
-    size_type firstSuccessorInit(size_type p) {
+                    for (size_type l = 1; l < h_; l++) {
+                        for (size_type t = 0; t < num; t++) {
 
-        size_type pos = nPrime_;
+                            levels[l].insert(levels[l].end(), partLevels[t][l].begin(), partLevels[t][l].end());
+                            partLevels[t][l].clear();
+                            partLevels[t][l].shrink_to_fit();
 
-        if (!L_.empty()) {
+                        }
+                    }
 
-            size_type y = k_ * (p / (nPrime_ / k_));
+                }
 
-            for (size_type j = 0; j < k_ && pos == nPrime_; j++) {
-                pos = firstSuccessor(nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j);
             }
 
         }
 
-        return pos;
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res->T_ = bit_vector_type(total);
 
-    }
+        bit_vector_type::iterator outIter = res->T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
 
-        size_type pos = nPrime_;
+        }
 
-        if (z >= T_.size()) {
+        res->L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), res->L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
 
-            if (L_[z - T_.size()]) {
-                pos = q;
-            }
+        res->R_ = rank_type(&res->T_);
 
-        } else {
+        return res;
 
-            if (T_[z]) {
+    }
 
-                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+    // computes the children of the current node (on level l) of the result, i.e. appends them to levels and returns
+    // whether there are any; the node is the sum of the products of the submatrices whose blocks of children
+    // start at the positions (zA, zB) in blocks
+    bool composeBlocks(const BasicK2Tree& a, const BasicK2Tree& b, const std::vector<std::pair<size_type, size_type>>& blocks, std::vector<std::vector<bool>>& levels, size_type l) const {
 
-                for (size_type j = 0; j < k_ && pos == nPrime_; j++) {
-                    pos = firstSuccessor(n / k_, p % (n / k_), q + (n / k_) * j, y + j);
-                }
+        std::vector<bool> C;
 
-            }
+        for (size_type i = 0; i < k_; i++) {
+            for (size_type j = 0; j < k_; j++) {
 
-        }
+                if (l == h_) {
 
-        return pos;
+                    bool found = false;
 
-    }
+                    for (auto it = blocks.begin(); !found && (it != blocks.end()); it++) {
+                        for (size_type m = 0; !found && (m < k_); m++) {
+                            found = a.L_[it->first + i * k_ + m - a.T_.size()] && b.L_[it->second + m * k_ + j - b.T_.size()];
+                        }
+                    }
 
-    /* getPredecessors() */
+                    C.push_back(found);
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+                } else {
 
-        if (!L_.empty()) {
+                    auto children = composeChildren(a, b, blocks, i, j);
+                    C.push_back(!children.empty() && composeBlocks(a, b, children, levels, l + 1));
 
-            size_type y = q / (nPrime_ / k_);
+                }
 
-            for (size_type i = 0; i < k_; i++) {
-                predecessors(preds, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_);
             }
-
         }
 
-    }
+        if (isAllZero(C)) {
+            return false;
+        } else {
 
-    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
 
-        if (z >= T_.size()) {
+        }
 
-            if (L_[z - T_.size()]) {
-                preds.push_back(p);
-            }
+    }
 
-        } else {
+    // returns the blocks of children of all pairs of non-empty submatrices (i,m) of a and (m,j) of b
+    // that contribute to the submatrix (i,j) of the current node of the result
+    std::vector<std::pair<size_type, size_type>> composeChildren(const BasicK2Tree& a, const BasicK2Tree& b, const std::vector<std::pair<size_type, size_type>>& blocks, size_type i, size_type j) const {
 
-            if (T_[z]) {
+        std::vector<std::pair<size_type, size_type>> children;
 
-                size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+        for (auto& block : blocks) {
+            for (size_type m = 0; m < k_; m++) {
 
-                for (size_type i = 0; i < k_; i++) {
-                    predecessors(preds, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_);
+                size_type zA = block.first + i * k_ + m;
+                size_type zB = block.second + m * k_ + j;
+
+                if (a.T_[zA] && b.T_[zB]) {
+                    children.push_back(std::make_pair(a.R_.rank(zA + 1) * k_ * k_, b.R_.rank(zB + 1) * k_ * k_));
                 }
 
             }
-
         }
 
+        return children;
+
     }
 
-    /* getRange() */
+    /* transpose() */
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    BasicK2Tree* transposeInit() const {
 
-        if (!L_.empty()) {
+        auto res = new BasicK2Tree();
 
-            size_type p1Prime, p2Prime;
+        res->k_ = k_;
+        res->h_ = h_;
+        res->nPrime_ = nPrime_;
+        res->null_ = null_;
 
-            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = bit_vector_type(L_.size());
 
-                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
-                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+        if (!L_.empty()) {
 
-                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
-                    range(
-                            pairs,
-                            nPrime_ / k_,
-                            p1Prime,
-                            p2Prime,
-                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
-                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
-                            (nPrime_ / k_) * i,
-                            (nPrime_ / k_) * j,
-                            k_ * i + j
-                    );
-                }
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            for (size_type l = 1; l < h_ - 1; l++) {
+
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * k_ * k_;
 
             }
 
+            transposeBlock(res, cursors, 1, 0);
+
         }
 
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
     }
 
-    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors
+    void transposeBlock(BasicK2Tree* res, std::vector<size_type>& cursors, size_type l, size_type z) const {
 
-        if (z >= T_.size()) {
+        if (l == h_) {
 
-            if (L_[z - T_.size()]) {
-                pairs.push_back(std::make_pair(dp, dq));
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    res->L_[cursors[l - 1]++] = L_[z + j * k_ + i - T_.size()];
+                }
             }
 
         } else {
 
-            if (T_[z]) {
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
 
-                size_type y = R_.rank(z + 1) * k_ * k_;
-                size_type p1Prime, p2Prime;
+                    size_type y = z + j * k_ + i;
+                    size_type pos = cursors[l - 1]++;
 
-                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+                    if (T_[y]) {
 
-                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
-                    p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+                        res->T_[pos] = true;
+                        transposeBlock(res, cursors, l + 1, R_.rank(y + 1) * k_ * k_);
 
-                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
-                        range(
-                                pairs,
-                                n / k_,
-                                p1Prime,
-                                p2Prime,
-                                (j == q1 / (n / k_)) * (q1 % (n / k_)),
-                                (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
-                                dp + (n / k_) * i,
-                                dq + (n / k_) * j,
-                                y + k_ * i + j
-                        );
                     }
 
                 }
-
             }
 
         }
 
     }
 
-    /* linkInRange() */
-
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
-
-        if (!L_.empty()) {
-
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
-            }
-
-            size_type p1Prime, p2Prime;
-
-            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
-
-                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
-                p2Prime = (i == p2 / (nPrime_ / k_)) ? (p2 % (nPrime_ / k_)) : nPrime_ / k_ - 1;
-
-                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
-
-                    if (linkInRange(nPrime_ / k_, p1Prime, p2Prime, (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)), (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : nPrime_ / k_ - 1, k_ * i + j)) {
-                        return true;
-                    }
+    /* countTriangles() */
 
-                }
+    size_type countTrianglesInit(std::vector<double>* coefficients, unsigned numThreads) const {
 
-            }
+        size_type n = nPrime_;
 
+        if (coefficients != nullptr) {
+            coefficients->assign(n, 0.0);
         }
 
-        return false;
+        if (L_.empty()) return 0;
 
-    }
+        numThreads = std::max(numThreads, 1u);
+        size_type numChunks = numThreads * 4;
+        size_type chunkSize = (n + numChunks - 1) / numChunks;
+        std::vector<size_type> counts(numChunks, 0);
 
-    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+        runChunks(numChunks, numThreads, [&](size_type c) {
 
-        if (z >= T_.size()) {
+            std::vector<size_type> row(1);
 
-            return L_[z - T_.size()];
+            for (size_type u = c * chunkSize; u < std::min(n, (c + 1) * chunkSize); u++) {
 
-        } else {
+                row[0] = u;
 
-            if (T_[z]) {
+                if (coefficients == nullptr) {
 
-                // dividing by k_ (as stated in the paper) in not correct,
-                // because it does not use the size of the currently considered submatrix but of its submatrices
-                if ((p1 == 0) && (q1 == 0) && (p2 == (n /*/ k_*/ - 1)) && (q2 == (n /*/ k_*/ - 1))) {
-                    return true;
-                }
+                    // every triangle u < v < w is counted once (at its smallest node)
+                    auto func = [&](size_type, size_type v) {
+                        if (v > u) {
+                            counts[c] += countCommonSuccessors(u, v, v + 1);
+                        }
+                    };
+                    successorsBatchInit(row, 0, 1, func);
 
-                size_type y = R_.rank(z + 1) * k_ * k_;
-                size_type p1Prime, p2Prime;
+                } else {
 
-                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+                    // every triangle is counted twice at each of its nodes
+                    size_type degree = 0;
+                    size_type paired = 0;
 
-                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
-                    p2Prime = (i == p2 / (n / k_)) ? (p2 % (n / k_)) : n / k_ - 1;
+                    auto func = [&](size_type, size_type v) {
+                        if (v != u) {
 
-                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                            degree++;
+                            paired += countCommonSuccessors(u, v, 0) - areRelated(u, u) - areRelated(v, v);
 
-                        if (linkInRange(n / k_, p1Prime, p2Prime, (j == q1 / (n / k_)) * (q1 % (n / k_)), (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1, y + k_ * i + j)) {
-                            return true;
                         }
+                    };
+                    successorsBatchInit(row, 0, 1, func);
 
-                    }
+                    counts[c] += paired;
+                    (*coefficients)[u] = (degree < 2) ? 0.0 : double(paired) / (degree * (degree - 1));
 
                 }
 
             }
 
-            return false;
+        });
 
+        size_type total = 0;
+        for (auto cnt : counts) {
+            total += cnt;
         }
 
-    }
+        return (coefficients == nullptr) ? total : total / 6;
 
+    }
 
-    /* setNull() */
+    // returns the number of columns j >= minCol such that (p1,j) and (p2,j) are in R
+    size_type countCommonSuccessors(size_type p1, size_type p2, size_type minCol) const {
 
-    void setInit(size_type p, size_type q) {
+        size_type n = nPrime_ / k_;
 
-        if (!L_.empty()) {
-            set(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
-        }
+        return countCommon(n, p1 % n, p2 % n, 0, k_ * (p1 / n), k_ * (p2 / n), minCol);
 
     }
 
-    void set(size_type n, size_type p, size_type q, size_type z) {
+    // z1 (z2) is the position of the first child of the current node of row p1 (p2) in T_ resp. L_,
+    // whose columns start at dq and have width n
+    size_type countCommon(size_type n, size_type p1, size_type p2, size_type dq, size_type z1, size_type z2, size_type minCol) const {
+
+        size_type lenT = T_.size();
+        size_type cnt = 0;
+
+        if (z1 >= lenT) {
+
+            for (size_type c = 0; c < k_; c++) {
+                cnt += ((dq + c) >= minCol) && L_[z1 + c - lenT] && L_[z2 + c - lenT];
+            }
 
-        if (z >= T_.size()) {
-            L_[z - T_.size()] = null_;
         } else {
 
-            if (T_[z]) {
-                set(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_));
+            // children whose columns are all smaller than minCol are skipped
+            for (size_type c = (minCol > dq) ? std::min(k_, (minCol - dq) / n) : 0; c < k_; c++) {
+
+                if (T_[z1 + c] && T_[z2 + c]) {
+                    cnt += countCommon(
+                            n / k_,
+                            p1 % (n / k_),
+                            p2 % (n / k_),
+                            dq + c * n,
+                            R_.rank(z1 + c + 1) * k_ * k_ + k_ * (p1 / (n / k_)),
+                            R_.rank(z2 + c + 1) * k_ * k_ + k_ * (p2 / (n / k_)),
+                            minCol
+                    );
+                }
+
             }
 
         }
 
+        return cnt;
+
     }
 
 };
@@ -0,0 +1,880 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_STATICDENSEK2TREE_HPP
+#define K2TREES_STATICDENSEK2TREE_HPP
+
+#include "K2Tree.hpp"
+#include "Utility.hpp"
+
+/**
+ * Naive implementation of a relation matrix with a K2Tree interface for very dense relations.
+ *
+ * Simply contains the whole relation matrix (row by row), i.e. numRows * numCols values.
+ */
+template<typename E>
+class DenseK2Tree final : public virtual K2Tree<E> {
+
+public:
+    typedef E elem_type;
+
+    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
+    typedef typename K2Tree<elem_type>::list_type list_type;
+    typedef typename K2Tree<elem_type>::positions_type positions_type;
+    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+
+
+    DenseK2Tree() {
+
+        numRows_ = 0;
+        numCols_ = 0;
+        count_ = 0;
+
+    }
+
+    /**
+     * Matrix-based constructor
+     *
+     * Assumes that all rows of mat are equally long.
+     */
+    DenseK2Tree(const matrix_type& mat, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        numRows_ = mat.size();
+        numCols_ = mat.empty() ? 0 : mat[0].size();
+        values_.assign(numRows_ * numCols_, null_);
+        count_ = 0;
+
+        for (size_type i = 0; i < numRows_; i++) {
+            for (size_type j = 0; j < numCols_; j++) {
+
+                values_[i * numCols_ + j] = mat[i][j];
+                count_ += (mat[i][j] != null_);
+
+            }
+        }
+
+    }
+
+    /**
+     * List-of-lists-based constructor
+     */
+    DenseK2Tree(const std::vector<list_type>& lists, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        numRows_ = lists.size();
+        numCols_ = 0;
+        for (auto& l : lists) {
+            for (auto& e : l) {
+                numCols_ = std::max(numCols_, e.first + 1);
+            }
+        }
+
+        values_.assign(numRows_ * numCols_, null_);
+        count_ = 0;
+
+        for (size_type i = 0; i < numRows_; i++) {
+            for (auto& e : lists[i]) {
+                setValue(i, e.first, e.second);
+            }
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     */
+    DenseK2Tree(pairs_type& pairs, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        numRows_ = 0;
+        numCols_ = 0;
+        for (auto& p : pairs) {
+
+            numRows_ = std::max(numRows_, p.row + 1);
+            numCols_ = std::max(numCols_, p.col + 1);
+
+        }
+
+        values_.assign(numRows_ * numCols_, null_);
+        count_ = 0;
+
+        for (auto& p : pairs) {
+            setValue(p.row, p.col, p.val);
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor similar to the one above, but only a part of the relation matrix is used:
+     *  x = first row of the submatrix
+     *  y = first column of the submatrix
+     *  nr = number of rows of the submatrix
+     *  nc = number of columns of the submatrix
+     *
+     * Internally, only positions relative to row x and column y are used.
+     */
+    DenseK2Tree(const typename pairs_type::iterator& first, const typename pairs_type::iterator& last, const size_type x, const size_type y, const size_type nr, const size_type nc, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        numRows_ = nr;
+        numCols_ = nc;
+        values_.assign(numRows_ * numCols_, null_);
+        count_ = 0;
+
+        for (auto iter = first; iter != last; iter++) {
+            setValue(iter->row - x, iter->col - y, iter->val);
+        }
+
+    }
+
+    size_type getNumRows() const override {
+        return numRows_;
+    }
+
+    size_type getNumCols() const override {
+        return numCols_;
+    }
+
+    elem_type getNull() const override {
+        return null_;
+    }
+
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return (i < numRows_) && (j < numCols_) && (values_[i * numCols_ + j] != null_);
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+        return ((i < numRows_) && (j < numCols_)) ? values_[i * numCols_ + j] : null_;
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+
+        std::vector<elem_type> succs;
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (values_[pos] != null_) {
+                    succs.push_back(values_[pos]);
+                }
+            }
+        }
+
+        return succs;
+
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+
+        std::vector<size_type> succs;
+        QueryContext ctx;
+        getSuccessorPositions(i, succs, ctx);
+
+        return succs;
+
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        pairs_type succs;
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (values_[pos] != null_) {
+                    succs.push_back(ValuedPosition<elem_type>(i, j, values_[pos]));
+                }
+            }
+        }
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+
+        std::vector<elem_type> preds;
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if (values_[pos] != null_) {
+                    preds.push_back(values_[pos]);
+                }
+            }
+        }
+
+        return preds;
+
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+
+        std::vector<size_type> preds;
+        QueryContext ctx;
+        getPredecessorPositions(j, preds, ctx);
+
+        return preds;
+
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        pairs_type preds;
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if (values_[pos] != null_) {
+                    preds.push_back(ValuedPosition<elem_type>(i, j, values_[pos]));
+                }
+            }
+        }
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        std::vector<elem_type> elements;
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (values_[pos] != null_) {
+                    elements.push_back(values_[pos]);
+                }
+            }
+        }
+
+        return elements;
+
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (values_[pos] != null_) {
+                    pairs.push_back(std::make_pair(i, j));
+                }
+            }
+        }
+
+        return pairs;
+
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        pairs_type pairs;
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (values_[pos] != null_) {
+                    pairs.push_back(ValuedPosition<elem_type>(i, j, values_[pos]));
+                }
+            }
+        }
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+
+        std::vector<elem_type> elements;
+        elements.reserve(count_);
+        for (auto& v : values_) {
+            if (v != null_) {
+                elements.push_back(v);
+            }
+        }
+
+        return elements;
+
+    }
+
+    positions_type getAllPositions() const override {
+        return (numRows_ == 0) ? positions_type() : getPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    pairs_type getAllValuedPositions() const override {
+        return (numRows_ == 0) ? pairs_type() : getValuedPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (values_[pos] != null_) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+
+    }
+
+    size_type countElements() const override {
+        return count_;
+    }
+
+
+    DenseK2Tree* clone() const override {
+        return new DenseK2Tree<elem_type>(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "numRows  = " << numRows_ << std::endl;
+        std::cout << "numCols  = " << numCols_ << std::endl;
+        std::cout << "null = " << null_ << std::endl;
+
+        if (all) {
+
+            std::cout << "### Values ###" << std::endl;
+            for (size_type i = 0; i < numRows_; i++) {
+                for (size_type j = 0; j < numCols_; j++) {
+                    std::cout << values_[i * numCols_ + j] << " ";
+                }
+                std::cout << std::endl;
+            }
+            std::cout << std::endl;
+
+        }
+
+    }
+
+    void setNull(size_type i, size_type j) override {
+
+        if (isNotNull(i, j)) {
+
+            values_[i * numCols_ + j] = null_;
+            count_--;
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (values_[pos] != null_) {
+                    return j;
+                }
+            }
+        }
+
+        return numCols_;
+
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext&) const override {
+
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (values_[pos] != null_) {
+                    succs.push_back(j);
+                }
+            }
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if (values_[pos] != null_) {
+                    preds.push_back(i);
+                }
+            }
+        }
+
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if ((values_[pos] != null_) && rows[i]) {
+                    return i;
+                }
+            }
+        }
+
+        return numRows_;
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext&) const override {
+        return getFirstSuccessor(i);
+    }
+
+
+    /*
+     * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
+     */
+
+    bool areRelated(size_type i, size_type j) const override {
+        return isNotNull(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+        return getSuccessorPositions(i);
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+        return getPredecessorPositions(j);
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getPositionsInRange(i1, i2, j1, j2);
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return containsElement(i1, i2, j1, j2);
+    }
+
+    size_type countLinks() const override {
+        return countElements();
+    }
+
+
+
+private:
+    std::vector<elem_type> values_; // values of the whole relation matrix (row by row)
+
+    size_type numRows_; // number of rows of the relation matrix
+    size_type numCols_; // number of columns of the relation matrix
+    size_type count_; // number of non-null values
+
+    elem_type null_; // null element
+
+
+    /* helper method for construction */
+
+    void setValue(size_type i, size_type j, const elem_type& val) {
+
+        auto& v = values_[i * numCols_ + j];
+        count_ = count_ - (v != null_) + (val != null_);
+        v = val;
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of DenseK2Tree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but stores the relation matrix as a bitmap (one bit per cell).
+ */
+template<>
+class DenseK2Tree<bool> final : public virtual K2Tree<bool> {
+
+public:
+    typedef bool elem_type;
+
+    typedef K2Tree<elem_type>::matrix_type matrix_type;
+    typedef RelationList list_type;
+    typedef K2Tree<elem_type>::positions_type positions_type;
+    typedef K2Tree<elem_type>::pairs_type pairs_type;
+
+
+    DenseK2Tree() {
+
+        numRows_ = 0;
+        numCols_ = 0;
+        count_ = 0;
+
+    }
+
+    /**
+     * Matrix-based constructor
+     *
+     * Assumes that all rows of mat are equally long.
+     */
+    DenseK2Tree(const matrix_type& mat) {
+
+        numRows_ = mat.size();
+        numCols_ = mat.empty() ? 0 : mat[0].size();
+        bits_ = bit_vector_type(numRows_ * numCols_, 0);
+        count_ = 0;
+
+        for (size_type i = 0; i < numRows_; i++) {
+            for (size_type j = 0; j < numCols_; j++) {
+                if (mat[i][j]) {
+                    setBit(i, j);
+                }
+            }
+        }
+
+    }
+
+    /**
+     * List-of-lists-based constructor
+     */
+    DenseK2Tree(const std::vector<list_type>& lists) {
+
+        numRows_ = lists.size();
+        numCols_ = 0;
+        for (auto& l : lists) {
+            for (auto j : l) {
+                numCols_ = std::max(numCols_, j + 1);
+            }
+        }
+
+        bits_ = bit_vector_type(numRows_ * numCols_, 0);
+        count_ = 0;
+
+        for (size_type i = 0; i < numRows_; i++) {
+            for (auto j : lists[i]) {
+                setBit(i, j);
+            }
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     */
+    DenseK2Tree(positions_type& pairs) {
+
+        numRows_ = 0;
+        numCols_ = 0;
+        for (auto& p : pairs) {
+
+            numRows_ = std::max(numRows_, p.first + 1);
+            numCols_ = std::max(numCols_, p.second + 1);
+
+        }
+
+        bits_ = bit_vector_type(numRows_ * numCols_, 0);
+        count_ = 0;
+
+        for (auto& p : pairs) {
+            setBit(p.first, p.second);
+        }
+
+    }
+
+    /**
+     * List-of-pairs-based constructor similar to the one above, but only a part of the relation matrix is used:
+     *  x = first row of the submatrix
+     *  y = first column of the submatrix
+     *  nr = number of rows of the submatrix
+     *  nc = number of columns of the submatrix
+     *
+     * Internally, only positions relative to row x and column y are used.
+     */
+    DenseK2Tree(const positions_type::iterator& first, const positions_type::iterator& last, const size_type x, const size_type y, const size_type nr, const size_type nc) {
+
+        numRows_ = nr;
+        numCols_ = nc;
+        bits_ = bit_vector_type(numRows_ * numCols_, 0);
+        count_ = 0;
+
+        for (auto iter = first; iter != last; iter++) {
+            setBit(iter->first - x, iter->second - y);
+        }
+
+    }
+
+    size_type getNumRows() const override {
+        return numRows_;
+    }
+
+    size_type getNumCols() const override {
+        return numCols_;
+    }
+
+    elem_type getNull() const override {
+        return false;
+    }
+
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return (i < numRows_) && (j < numCols_) && bits_[i * numCols_ + j];
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+        return isNotNull(i, j);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+        return std::vector<elem_type>(getSuccessorPositions(i).size(), true);
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+
+        std::vector<size_type> succs;
+        QueryContext ctx;
+        getSuccessorPositions(i, succs, ctx);
+
+        return succs;
+
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        pairs_type succs;
+        for (auto j : getSuccessorPositions(i)) {
+            succs.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+        return std::vector<elem_type>(getPredecessorPositions(j).size(), true);
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+
+        std::vector<size_type> preds;
+        QueryContext ctx;
+        getPredecessorPositions(j, preds, ctx);
+
+        return preds;
+
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        pairs_type preds;
+        for (auto i : getPredecessorPositions(j)) {
+            preds.push_back(ValuedPosition<elem_type>(i, j, true));
+        }
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return std::vector<elem_type>(getPositionsInRange(i1, i2, j1, j2).size(), true);
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (bits_[pos]) {
+                    pairs.push_back(std::make_pair(i, j));
+                }
+            }
+        }
+
+        return pairs;
+
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        pairs_type pairs;
+        for (auto& p : getPositionsInRange(i1, i2, j1, j2)) {
+            pairs.push_back(ValuedPosition<elem_type>(p, true));
+        }
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return std::vector<elem_type>(count_, true);
+    }
+
+    positions_type getAllPositions() const override {
+        return (numRows_ == 0) ? positions_type() : getPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    pairs_type getAllValuedPositions() const override {
+        return (numRows_ == 0) ? pairs_type() : getValuedPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        for (size_type i = i1; i < std::min(i2 + 1, numRows_); i++) {
+            for (size_type j = j1, pos = i * numCols_ + j1; j < std::min(j2 + 1, numCols_); j++, pos++) {
+                if (bits_[pos]) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+
+    }
+
+    size_type countElements() const override {
+        return count_;
+    }
+
+
+    DenseK2Tree* clone() const override {
+        return new DenseK2Tree<elem_type>(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "numRows  = " << numRows_ << std::endl;
+        std::cout << "numCols  = " << numCols_ << std::endl;
+        std::cout << "null = " << false << std::endl;
+
+        if (all) {
+
+            std::cout << "### Bits ###" << std::endl;
+            for (size_type i = 0; i < numRows_; i++) {
+                for (size_type j = 0; j < numCols_; j++) {
+                    std::cout << bits_[i * numCols_ + j];
+                }
+                std::cout << std::endl;
+            }
+            std::cout << std::endl;
+
+        }
+
+    }
+
+    void setNull(size_type i, size_type j) override {
+
+        if (isNotNull(i, j)) {
+
+            bits_[i * numCols_ + j] = 0;
+            count_--;
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (bits_[pos]) {
+                    return j;
+                }
+            }
+        }
+
+        return numCols_;
+
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext&) const override {
+
+        if (i < numRows_) {
+            for (size_type j = 0, pos = i * numCols_; j < numCols_; j++, pos++) {
+                if (bits_[pos]) {
+                    succs.push_back(j);
+                }
+            }
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if (bits_[pos]) {
+                    preds.push_back(i);
+                }
+            }
+        }
+
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+
+        if (j < numCols_) {
+            for (size_type i = 0, pos = j; i < numRows_; i++, pos += numCols_) {
+                if (bits_[pos] && rows[i]) {
+                    return i;
+                }
+            }
+        }
+
+        return numRows_;
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext&) const override {
+        return getFirstSuccessor(i);
+    }
+
+
+    /*
+     * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
+     */
+
+    bool areRelated(size_type i, size_type j) const override {
+        return isNotNull(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+        return getSuccessorPositions(i);
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+        return getPredecessorPositions(j);
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getPositionsInRange(i1, i2, j1, j2);
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return containsElement(i1, i2, j1, j2);
+    }
+
+    size_type countLinks() const override {
+        return countElements();
+    }
+
+
+
+private:
+    bit_vector_type bits_; // bits of the whole relation matrix (row by row)
+
+    size_type numRows_; // number of rows of the relation matrix
+    size_type numCols_; // number of columns of the relation matrix
+    size_type count_; // number of 1-bits
+
+
+    /* helper method for construction */
+
+    void setBit(size_type i, size_type j) {
+
+        auto pos = i * numCols_ + j;
+        count_ += !bits_[pos];
+        bits_[pos] = 1;
+
+    }
+
+};
+
+#endif //K2TREES_STATICDENSEK2TREE_HPP
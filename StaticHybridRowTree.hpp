@@ -37,7 +37,7 @@
  * the positions of all elements.
  */
 template<typename E>
-class HybridRowTree : public virtual RowTree<E> {
+class HybridRowTree final : public virtual RowTree<E> {
 
 public:
     typedef E elem_type;
@@ -300,53 +300,53 @@ public:
 
 
     // returns the arity of the upper part of the RowTree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the RowTree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the RowTree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the RowTree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the RowTree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return getInit(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         rangeElemInit(elems, l, r);
@@ -356,7 +356,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangePosInit(positions, l, r);
@@ -366,7 +366,7 @@ public:
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
         rangeValPosInit(positions, l, r);
@@ -376,7 +376,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 //        return getElementsInRange(0, nPrime_ - 1);
         std::vector<elem_type> elements;
         fullRangeElemIterative(elements);
@@ -384,15 +384,20 @@ public:
 
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
-        fullRangePosIterative(positions);
+        QueryContext ctx;
+        fullRangePosIterative(positions, ctx);
         return positions;
 
     }
 
-    list_type getAllValuedPositions() override {
+    void getAllPositions(std::vector<size_type>& positions, QueryContext& ctx) const override {
+        fullRangePosIterative(positions, ctx);
+    }
+
+    list_type getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         list_type positions;
         fullRangeValPosIterative(positions);
@@ -400,12 +405,12 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
@@ -421,7 +426,7 @@ public:
         return new HybridRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -456,11 +461,52 @@ public:
         setInit(i);
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return nextGEQIterative(x, cursor);
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return prevLEQIterative(x, cursor);
+
+    }
+
+    size_type nextGEQ(size_type x, RowTreeCursor& cursor) const override {
+        return nextGEQIterative(x, cursor);
+    }
+
+    size_type prevLEQ(size_type x, RowTreeCursor& cursor) const override {
+        return prevLEQIterative(x, cursor);
+    }
+
+
+    /*
+     * Set operations on RowTrees with the same parameters (not part of the RowTree interface)
+     */
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in every one of the given RowTrees
+    // (with the values of trees[0]); the RowTrees are traversed in lockstep and a subtree is skipped
+    // as soon as one of them has a 0-bit for it
+    static HybridRowTree* intersect(const std::vector<HybridRowTree*>& trees) {
+        return combineInit(trees, true);
+    }
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in at least one of the given RowTrees
+    // (with the value of the first RowTree that contains the element); the RowTrees are traversed in lockstep
+    // and a subtree is skipped if all of them have a 0-bit for it
+    static HybridRowTree* unite(const std::vector<HybridRowTree*>& trees) {
+        return combineInit(trees, false);
+    }
+
 
 
 private:
@@ -766,11 +812,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename list_type::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const typename list_type::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair.first - sp.firstCol) / width;
     }
 
-    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -884,7 +930,7 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -892,7 +938,7 @@ private:
 
     }
 
-    bool check(size_type n, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return (L_[z - T_.size()] != null_);
@@ -908,7 +954,7 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type q) {
+    elem_type getInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -916,7 +962,7 @@ private:
 
     }
 
-    elem_type get(size_type n, size_type q, size_type z, size_type l) {
+    elem_type get(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -932,7 +978,7 @@ private:
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
@@ -985,7 +1031,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -1010,7 +1056,7 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         size_type pos = nPrime_;
 
@@ -1049,11 +1095,11 @@ private:
 
     /* getElementsInRange() */
 
-    void fullRangeElemIterative(std::vector<elem_type>& elems) {
+    void fullRangeElemIterative(std::vector<elem_type>& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -1072,7 +1118,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
@@ -1083,34 +1129,35 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1124,15 +1171,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) {
+    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1154,7 +1199,7 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -1169,6 +1214,16 @@ private:
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
 
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. the range is a contiguous part of L_
+                    size_type offset = y - T_.size() + l;
+                    forEachNonNull(L_.data() + offset, r - l + 1, null_, [&](size_type j) { elems.push_back(L_[offset + j]); });
+
+                    return;
+
+                }
+
                 for (auto j = l / (n / k); j <= r / (n / k); j++) {
                     rangeElem(
                             elems,
@@ -1189,11 +1244,13 @@ private:
 
     /* getPositionsInRange() */
 
-    void fullRangePosIterative(std::vector<size_type>& elems) {
+    void fullRangePosIterative(std::vector<size_type>& elems, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -1212,7 +1269,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
@@ -1223,34 +1280,35 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1264,15 +1322,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1294,7 +1350,7 @@ private:
 
     }
 
-    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -1329,11 +1385,11 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void fullRangeValPosIterative(list_type& elems) {
+    void fullRangeValPosIterative(list_type& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -1352,7 +1408,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
@@ -1363,34 +1419,35 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1404,15 +1461,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeValPosInit(list_type& elems, size_type l, size_type r) {
+    void rangeValPosInit(list_type& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1434,7 +1489,7 @@ private:
 
     }
 
-    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -1469,7 +1524,7 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1493,7 +1548,7 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -1555,6 +1610,288 @@ private:
 
     }
 
+    /* nextGEQ(), prevLEQ() */
+
+    // initialises an unused cursor, otherwise moves it up to the deepest node on its path whose subrow contains x
+    void moveCursorUp(RowTreeCursor& cursor, size_type x) const {
+
+        if (cursor.z.empty()) {
+
+            cursor.n.assign(h_, nPrime_ / ((upperH_ > 0) ? upperK_ : lowerK_));
+            cursor.dq.assign(h_, 0);
+            cursor.z.assign(h_, 0);
+            cursor.level = 0;
+
+        } else {
+
+            while (cursor.level > 0 && (x < cursor.dq[cursor.level] || x >= cursor.dq[cursor.level] + cursor.n[cursor.level] * ((cursor.level < upperH_) ? upperK_ : lowerK_))) {
+                cursor.level--;
+            }
+
+        }
+
+    }
+
+    // descends from the node the cursor points to and checks its children from left to right,
+    // skipping 0-bits and backtracking to the parent (next child) when a subrow does not contain an element >= x
+    size_type nextGEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty() || x >= nPrime_) return -1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()] != null_) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                auto k = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                cursor.n[l + 1] = cursor.n[l] / k;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * k;
+                l++;
+
+                j = (x > cursor.dq[l]) ? (x - cursor.dq[l]) / cursor.n[l] : 0;
+                continue;
+
+            }
+
+            while (j == ((l < upperH_) ? upperK_ : lowerK_) - 1) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j++;
+
+        }
+
+    }
+
+    // like nextGEQIterative(), but checks the children from right to left
+    size_type prevLEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty()) return -1;
+        if (x >= nPrime_) x = nPrime_ - 1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()] != null_) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                auto k = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                cursor.n[l + 1] = cursor.n[l] / k;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * k;
+                l++;
+
+                j = std::min(((l < upperH_) ? upperK_ : lowerK_) - 1, (x - cursor.dq[l]) / cursor.n[l]);
+                continue;
+
+            }
+
+            while (j == 0) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j--;
+
+        }
+
+    }
+
+    /* intersect(), unite() */
+
+    static HybridRowTree* combineInit(const std::vector<HybridRowTree*>& trees, bool intersection) {
+
+        if (trees.empty()) {
+            throw std::runtime_error(std::string() + "Unsuitable parameters! " + "At least one RowTree is needed.");
+        }
+
+        for (auto t : trees) {
+
+            if ((t->upperK_ != trees[0]->upperK_) || (t->upperH_ != trees[0]->upperH_) || (t->lowerK_ != trees[0]->lowerK_) || (t->h_ != trees[0]->h_)) {
+
+                std::string err = std::string() +
+                                  "Unsuitable parameters! " +
+                                  "All RowTrees have to have the same arities (upperK, lowerK) and heights (upperH, h)."
+                ;
+
+                throw std::runtime_error(err);
+
+            }
+
+        }
+
+        auto res = new HybridRowTree();
+
+        res->upperK_ = trees[0]->upperK_;
+        res->lowerK_ = trees[0]->lowerK_;
+        res->upperH_ = trees[0]->upperH_;
+        res->h_ = trees[0]->h_;
+        res->nPrime_ = trees[0]->nPrime_;
+        res->null_ = trees[0]->null_;
+
+        // nodes on the current level (index of the RowTree and start of the block of children) in all RowTrees containing them
+        std::vector<std::pair<size_type, size_type>> nodes;
+        for (size_type t = 0; t < trees.size(); t++) {
+            if (!trees[t]->L_.empty()) nodes.push_back(std::make_pair(t, 0));
+        }
+
+        if (!nodes.empty() && (!intersection || (nodes.size() == trees.size()))) {
+
+            std::vector<std::vector<bool>> levels(res->h_ - 1);
+            res->combine(trees, intersection, nodes, levels, 1);
+
+            // helper variables (describe top section of conceptual k^2-tree) for navigation on T and L
+            res->upperOnes_ = 0;
+            res->upperLength_ = 0;
+
+            if (res->upperH_ > 0) {
+
+                for (size_t l = 0; l < res->upperH_ - 1; l++) {
+                    for (auto i = 0; i < levels[l].size(); i++) {
+                        res->upperOnes_ += levels[l][i];
+                    }
+                }
+                res->upperLength_ = (res->upperOnes_ + 1) * res->upperK_;
+
+            }
+
+            size_type total = 0;
+            for (auto l = 0; l < res->h_ - 1; l++) {
+                total += levels[l].size();
+            }
+            res->T_ = bit_vector_type(total);
+
+            bit_vector_type::iterator outIter = res->T_.begin();
+            for (size_type l = 0; l < res->h_ - 1; l++) {
+
+                outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                levels[l].clear();
+                levels[l].shrink_to_fit();
+
+            }
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // appends the children of the current node (on level l) to levels resp. L_ and returns whether there are any,
+    // nodes contains the index and the start of the block of children of the current node in every relevant RowTree
+    bool combine(const std::vector<HybridRowTree*>& trees, bool intersection, const std::vector<std::pair<size_type, size_type>>& nodes, std::vector<std::vector<bool>>& levels, size_type l) {
+
+        auto k = (l <= upperH_) ? upperK_ : lowerK_;
+
+        if (l == h_) {
+
+            std::vector<elem_type> C;
+
+            for (size_type j = 0; j < k; j++) {
+
+                size_type cnt = 0;
+                elem_type val = null_;
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+                    auto& e = t->L_[node.second + j - t->T_.size()];
+
+                    if (e != t->null_) {
+
+                        if (cnt == 0) val = e;
+                        cnt++;
+
+                    }
+
+                }
+
+                C.push_back((intersection && (cnt != trees.size())) ? null_ : val);
+
+            }
+
+            if (isAll(C, null_)) {
+                return false;
+            } else {
+
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        } else {
+
+            std::vector<bool> C;
+            std::vector<std::pair<size_type, size_type>> children;
+
+            for (size_type j = 0; j < k; j++) {
+
+                children.clear();
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+
+                    if (t->T_[node.second + j]) {
+                        children.push_back(std::make_pair(node.first, (l >= upperH_) * t->upperLength_ + (t->R_.rank(node.second + j + 1) - (l >= upperH_) * (t->upperOnes_ + 1)) * ((l < upperH_) ? upperK_ : lowerK_)));
+                    } else if (intersection) {
+                        break;
+                    }
+
+                }
+
+                C.push_back(!children.empty() && (!intersection || (children.size() == trees.size())) && combine(trees, intersection, children, levels, l + 1));
+
+            }
+
+            if (isAllZero(C)) {
+                return false;
+            } else {
+
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        }
+    }
+
 };
 
 
@@ -1565,7 +1902,7 @@ private:
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
-class HybridRowTree<bool> : public virtual RowTree<bool> {
+class HybridRowTree<bool> final : public virtual RowTree<bool> {
 
 public:
     typedef bool elem_type;
@@ -1878,57 +2215,57 @@ public:
 
 
     // returns the arity of the upper part of the RowTree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the RowTree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the RowTree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the RowTree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the RowTree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return isNotNull(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
         return std::vector<elem_type>(getPositionsInRange(l, r).size(), 1);
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1938,7 +2275,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1953,19 +2290,24 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countElements(), 1);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
-        fullRangeIterative(positions);
+        QueryContext ctx;
+        fullRangeIterative(positions, ctx);
         return positions;
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    void getAllPositions(std::vector<size_type>& positions, QueryContext& ctx) const override {
+        fullRangeIterative(positions, ctx);
+    }
+
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         std::vector<std::pair<size_type, elem_type>> positions;
         fullRangeValPosIterative(positions);
@@ -1973,12 +2315,12 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
@@ -1994,7 +2336,7 @@ public:
         return new HybridRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2029,11 +2371,52 @@ public:
         setInit(i);
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return nextGEQIterative(x, cursor);
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return prevLEQIterative(x, cursor);
+
+    }
+
+    size_type nextGEQ(size_type x, RowTreeCursor& cursor) const override {
+        return nextGEQIterative(x, cursor);
+    }
+
+    size_type prevLEQ(size_type x, RowTreeCursor& cursor) const override {
+        return prevLEQIterative(x, cursor);
+    }
+
+
+    /*
+     * Set operations on RowTrees with the same parameters (not part of the RowTree interface)
+     */
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in every one of the given RowTrees
+    // (with the values of trees[0]); the RowTrees are traversed in lockstep and a subtree is skipped
+    // as soon as one of them has a 0-bit for it
+    static HybridRowTree* intersect(const std::vector<HybridRowTree*>& trees) {
+        return combineInit(trees, true);
+    }
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in at least one of the given RowTrees
+    // (with the value of the first RowTree that contains the element); the RowTrees are traversed in lockstep
+    // and a subtree is skipped if all of them have a 0-bit for it
+    static HybridRowTree* unite(const std::vector<HybridRowTree*>& trees) {
+        return combineInit(trees, false);
+    }
+
 
 
 private:
@@ -2324,11 +2707,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const list_type::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const list_type::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair - sp.firstCol) / width;
     }
 
-    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2446,11 +2829,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs given as iterators */
 
-    size_type computeKey(const std::vector<std::pair<size_type, size_type>>::iterator::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const std::vector<std::pair<size_type, size_type>>::iterator::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair.second - sp.firstCol) / width;
     }
 
-    void countingSort(const std::vector<std::pair<size_type, size_type>>::iterator& first, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(const std::vector<std::pair<size_type, size_type>>::iterator& first, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2570,7 +2953,7 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -2578,7 +2961,7 @@ private:
 
     }
 
-    bool check(size_type n, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -2594,21 +2977,19 @@ private:
 
     /* getRange() */
 
-    void fullRangeIterative(std::vector<size_type>& elems) {
+    void fullRangeIterative(std::vector<size_type>& elems, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(i);
-                }
-            }
+            forEachSetBit(L_, 0, nPrime_, [&](size_type i) { elems.push_back(i); });
 
         } else {
 
@@ -2617,7 +2998,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
@@ -2628,70 +3009,59 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
-                        for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+                        forEachSetBit(T_, y, k, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(newDq);
-                        }
-                    }
+                    forEachSetBit(L_, y, k, [&](size_type j) { elems.push_back(cur.dq + j * n); });
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) {
+    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(std::make_pair(i, 1));
-                }
-            }
+            forEachSetBit(L_, 0, nPrime_, [&](size_type i) { elems.push_back(std::make_pair(i, 1)); });
 
         } else {
 
@@ -2700,7 +3070,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
@@ -2711,56 +3081,49 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
-                        for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+                        forEachSetBit(T_, y, k, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(std::make_pair(newDq, 1));
-                        }
-                    }
+                    forEachSetBit(L_, y, k, [&](size_type j) { elems.push_back(std::make_pair(cur.dq + j * n, 1)); });
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2782,7 +3145,7 @@ private:
 
     }
 
-    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -2797,6 +3160,15 @@ private:
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
 
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. the range is a contiguous part of L_
+                    forEachSetBit(L_, y - T_.size() + l, r - l + 1, [&](size_type j) { elems.push_back(dq + l + j); });
+
+                    return;
+
+                }
+
                 for (auto j = l / (n / k); j <= r / (n / k); j++) {
                     range(
                             elems,
@@ -2817,7 +3189,7 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2841,7 +3213,7 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
@@ -2905,7 +3277,7 @@ private:
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
@@ -2958,7 +3330,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -2983,7 +3355,7 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         size_type pos = nPrime_;
 
@@ -3019,6 +3391,272 @@ private:
 
     }
 
+    /* nextGEQ(), prevLEQ() */
+
+    // initialises an unused cursor, otherwise moves it up to the deepest node on its path whose subrow contains x
+    void moveCursorUp(RowTreeCursor& cursor, size_type x) const {
+
+        if (cursor.z.empty()) {
+
+            cursor.n.assign(h_, nPrime_ / ((upperH_ > 0) ? upperK_ : lowerK_));
+            cursor.dq.assign(h_, 0);
+            cursor.z.assign(h_, 0);
+            cursor.level = 0;
+
+        } else {
+
+            while (cursor.level > 0 && (x < cursor.dq[cursor.level] || x >= cursor.dq[cursor.level] + cursor.n[cursor.level] * ((cursor.level < upperH_) ? upperK_ : lowerK_))) {
+                cursor.level--;
+            }
+
+        }
+
+    }
+
+    // descends from the node the cursor points to and checks its children from left to right,
+    // skipping 0-bits and backtracking to the parent (next child) when a subrow does not contain an element >= x
+    size_type nextGEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty() || x >= nPrime_) return -1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()]) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                auto k = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                cursor.n[l + 1] = cursor.n[l] / k;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * k;
+                l++;
+
+                j = (x > cursor.dq[l]) ? (x - cursor.dq[l]) / cursor.n[l] : 0;
+                continue;
+
+            }
+
+            while (j == ((l < upperH_) ? upperK_ : lowerK_) - 1) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j++;
+
+        }
+
+    }
+
+    // like nextGEQIterative(), but checks the children from right to left
+    size_type prevLEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty()) return -1;
+        if (x >= nPrime_) x = nPrime_ - 1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()]) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                auto k = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                cursor.n[l + 1] = cursor.n[l] / k;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * k;
+                l++;
+
+                j = std::min(((l < upperH_) ? upperK_ : lowerK_) - 1, (x - cursor.dq[l]) / cursor.n[l]);
+                continue;
+
+            }
+
+            while (j == 0) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j--;
+
+        }
+
+    }
+
+    /* intersect(), unite() */
+
+    static HybridRowTree* combineInit(const std::vector<HybridRowTree*>& trees, bool intersection) {
+
+        if (trees.empty()) {
+            throw std::runtime_error(std::string() + "Unsuitable parameters! " + "At least one RowTree is needed.");
+        }
+
+        for (auto t : trees) {
+
+            if ((t->upperK_ != trees[0]->upperK_) || (t->upperH_ != trees[0]->upperH_) || (t->lowerK_ != trees[0]->lowerK_) || (t->h_ != trees[0]->h_)) {
+
+                std::string err = std::string() +
+                                  "Unsuitable parameters! " +
+                                  "All RowTrees have to have the same arities (upperK, lowerK) and heights (upperH, h)."
+                ;
+
+                throw std::runtime_error(err);
+
+            }
+
+        }
+
+        auto res = new HybridRowTree();
+
+        res->upperK_ = trees[0]->upperK_;
+        res->lowerK_ = trees[0]->lowerK_;
+        res->upperH_ = trees[0]->upperH_;
+        res->h_ = trees[0]->h_;
+        res->nPrime_ = trees[0]->nPrime_;
+        res->null_ = false;
+
+        // nodes on the current level (index of the RowTree and start of the block of children) in all RowTrees containing them
+        std::vector<std::pair<size_type, size_type>> nodes;
+        for (size_type t = 0; t < trees.size(); t++) {
+            if (!trees[t]->L_.empty()) nodes.push_back(std::make_pair(t, 0));
+        }
+
+        if (!nodes.empty() && (!intersection || (nodes.size() == trees.size()))) {
+
+            std::vector<std::vector<bool>> levels(res->h_);
+            res->combine(trees, intersection, nodes, levels, 1);
+
+            // helper variables (describe top section of conceptual k^2-tree) for navigation on T and L
+            res->upperOnes_ = 0;
+            res->upperLength_ = 0;
+
+            if (res->upperH_ > 0) {
+
+                for (size_t l = 0; l < res->upperH_ - 1; l++) {
+                    for (auto i = 0; i < levels[l].size(); i++) {
+                        res->upperOnes_ += levels[l][i];
+                    }
+                }
+                res->upperLength_ = (res->upperOnes_ + 1) * res->upperK_;
+
+            }
+
+            size_type total = 0;
+            for (auto l = 0; l < res->h_ - 1; l++) {
+                total += levels[l].size();
+            }
+            res->T_ = bit_vector_type(total);
+
+            bit_vector_type::iterator outIter = res->T_.begin();
+            for (size_type l = 0; l < res->h_ - 1; l++) {
+
+                outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                levels[l].clear();
+                levels[l].shrink_to_fit();
+
+            }
+
+            res->L_ = bit_vector_type(levels[res->h_ - 1].size());
+            std::move(levels[res->h_ - 1].begin(), levels[res->h_ - 1].end(), res->L_.begin());
+            levels[res->h_ - 1].clear();
+            levels[res->h_ - 1].shrink_to_fit();
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // appends the children of the current node (on level l) to levels resp. L_ and returns whether there are any,
+    // nodes contains the index and the start of the block of children of the current node in every relevant RowTree
+    bool combine(const std::vector<HybridRowTree*>& trees, bool intersection, const std::vector<std::pair<size_type, size_type>>& nodes, std::vector<std::vector<bool>>& levels, size_type l) {
+
+        auto k = (l <= upperH_) ? upperK_ : lowerK_;
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (size_type j = 0; j < k; j++) {
+
+                size_type cnt = 0;
+
+                for (auto& node : nodes) {
+                    cnt += trees[node.first]->L_[node.second + j - trees[node.first]->T_.size()];
+                }
+
+                C.push_back(intersection ? (cnt == trees.size()) : (cnt > 0));
+
+            }
+
+        } else {
+
+            std::vector<std::pair<size_type, size_type>> children;
+
+            for (size_type j = 0; j < k; j++) {
+
+                children.clear();
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+
+                    if (t->T_[node.second + j]) {
+                        children.push_back(std::make_pair(node.first, (l >= upperH_) * t->upperLength_ + (t->R_.rank(node.second + j + 1) - (l >= upperH_) * (t->upperOnes_ + 1)) * ((l < upperH_) ? upperK_ : lowerK_)));
+                    } else if (intersection) {
+                        break;
+                    }
+
+                }
+
+                C.push_back(!children.empty() && (!intersection || (children.size() == trees.size())) && combine(trees, intersection, children, levels, l + 1));
+
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+    }
+
 };
 
 #endif //K2TREES_STATICHYBRIDROWTREE_HPP
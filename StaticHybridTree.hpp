@@ -40,7 +40,7 @@
  * of all relation pairs.
  */
 template<typename E>
-class HybridK2Tree : public virtual K2Tree<E> {
+class HybridK2Tree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -306,57 +306,57 @@ public:
 
 
     // returns the arity of the upper part of the K2Tree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the K2Tree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the K2Tree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the K2Tree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the K2Tree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
 //        successorsElemInit(succs, i);
@@ -366,17 +366,18 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
 
         return succs;
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
 //        successorsValPosInit(succs, i);
@@ -386,7 +387,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -395,7 +396,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -404,7 +405,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -413,7 +414,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -423,7 +424,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -433,7 +434,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -443,24 +444,39 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
-        return getElementsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    std::vector<elem_type> getAllElements() const override {
+
+        std::vector<elem_type> elements;
+        zOrderScan([&](size_type, size_type, size_type y) { elements.push_back(L_[y]); });
+
+        return elements;
+
     }
 
-    positions_type getAllPositions() override {
-        return getPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
+
+        return pairs;
+
     }
 
-    pairs_type getAllValuedPositions() override {
-        return getValuedPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
+    pairs_type getAllValuedPositions() const override {
+
+        pairs_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type y) { pairs.push_back(ValuedPosition<elem_type>(i, j, L_[y])); });
+
+        return pairs;
+
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type i = 0; i < L_.size(); i++) {
@@ -476,7 +492,7 @@ public:
         return new HybridK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -511,9 +527,83 @@ public:
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsPosInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type y) { func(i, j, L_[y]); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i,val) with (i,j,val) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    HybridK2Tree* transpose() const {
+        return transposeInit();
     }
 
 
@@ -521,31 +611,66 @@ public:
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
 
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
@@ -863,11 +988,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) const {
         return ((pair.row - sp.firstRow) / width) * k + (pair.col - sp.firstCol) / width;
     }
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) {
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) const {
 
         std::vector<size_type> counts(sup);
 
@@ -981,7 +1106,7 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type p, size_type q) {
+    bool checkInit(size_type p, size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -989,7 +1114,7 @@ private:
 
     }
 
-    bool check(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return (L_[z - T_.size()] != null_);
@@ -1005,7 +1130,7 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type p, size_type q) {
+    elem_type getInit(size_type p, size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -1013,7 +1138,7 @@ private:
 
     }
 
-    elem_type get(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    elem_type get(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -1030,7 +1155,7 @@ private:
 
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -1042,11 +1167,7 @@ private:
         if (lenT == 0) {
 
             size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
-                }
-            }
+            forEachNonNull(L_.data() + offset, nPrime_, null_, [&](size_type i) { succs.push_back(L_[offset + i]); });
 
         } else {
 
@@ -1100,11 +1221,7 @@ private:
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
-                        }
-                    }
+                    forEachNonNull(L_.data() + y, k, null_, [&](size_type j) { succs.push_back(L_[y + j]); });
 
                 }
 
@@ -1116,7 +1233,7 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1131,7 +1248,7 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1159,11 +1276,13 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
@@ -1184,7 +1303,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // successorsPos
@@ -1196,34 +1315,35 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1237,15 +1357,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1260,7 +1378,7 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1288,7 +1406,7 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
         if (L_.empty()) return;
 
@@ -1374,7 +1492,7 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -1393,7 +1511,7 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1421,7 +1539,7 @@ private:
 
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return nPrime_;
 
@@ -1439,16 +1557,18 @@ private:
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type l = 1;
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
 
             while (!stack.empty()) {
 
-                auto& cur = stack.top();
+                auto& cur = stack.back();
 
                 if (cur.j == ((l <= upperH_) ? upperK_ : lowerK_)) {
 
-                    stack.pop();
+                    stack.pop_back();
                     l--;
 
                 } else {
@@ -1464,7 +1584,7 @@ private:
                         if (T_[cur.z]) {
 
                             k = (l < upperH_) ? upperK_ : lowerK_;
-                            stack.emplace(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
+                            stack.emplace_back(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
                             l++;
 
                         }
@@ -1484,7 +1604,7 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
@@ -1503,7 +1623,7 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         size_type pos = nPrime_;
 
@@ -1535,7 +1655,7 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1550,7 +1670,7 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1577,7 +1697,7 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1592,7 +1712,7 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1617,9 +1737,62 @@ private:
 
     }
 
+    /* getFirstPredecessorIn() */
+
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = q / (nPrime_ / k);
+
+            for (size_type i = 0; i < k; i++) {
+
+                auto p = firstPredecessorIn(rows, nPrime_ / k, q % (nPrime_ / k), (nPrime_ / k) * i, y + i * k, 1);
+
+                if (p < nPrime_) {
+                    return p;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
+    // same descent as in predecessorsPos(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type n, size_type q, size_type p, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+            return ((L_[z - T_.size()] != null_) && rows[p]) ? p : nPrime_;
+        }
+
+        if (T_[z]) {
+
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
+            size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
+
+            for (size_type i = 0; i < k; i++) {
+
+                auto res = firstPredecessorIn(rows, n / k, q % (n / k), p + (n / k) * i, y + i * k, l + 1);
+
+                if (res < nPrime_) {
+                    return res;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -1638,7 +1811,7 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1666,7 +1839,7 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1700,7 +1873,7 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1714,6 +1887,21 @@ private:
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+
+                        size_type offset = y - T_.size() + k * i + q1;
+                        forEachNonNull(L_.data() + offset, q2 - q1 + 1, null_, [&](size_type j) { elements.push_back(L_[offset + j]); });
+
+                    }
+
+                    return;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
@@ -1746,7 +1934,7 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1780,7 +1968,7 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1826,7 +2014,7 @@ private:
 
     /* getValuedPositionsRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1860,7 +2048,7 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -1907,7 +2095,7 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -1942,7 +2130,7 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) {
+    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -2014,148 +2202,457 @@ private:
 
     }
 
-};
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
 
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
 
-/**
- * Bool specialisation of HybridK2Tree.
- *
- * Has the same characteristics as the general implementation above,
- * but makes use of some simplifications since the only non-null value is 1 / true.
- */
-template<>
-class HybridK2Tree<bool> : public virtual K2Tree<bool> {
+        if (L_.empty()) return;
 
-public:
-    typedef bool elem_type;
+        size_type numLevels = h_ - 1;
 
-    typedef K2Tree<elem_type>::matrix_type matrix_type;
-    typedef K2Tree<elem_type>::list_type list_type;
-    typedef K2Tree<elem_type>::positions_type positions_type;
-    typedef K2Tree<elem_type>::pairs_type pairs_type;
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), n(numLevels + 1, nPrime_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
 
+        for (size_type l = 0; l < numLevels; l++) {
 
-    HybridK2Tree() {
-        // nothing to do
-    }
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-    HybridK2Tree(const HybridK2Tree& other) {
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * k * k;
+            n[l + 1] = n[l] / k;
 
-        h_ = other.h_;
-        upperH_ = other.upperH_;
-        upperOnes_ = other.upperOnes_;
-        upperLength_ = other.upperLength_;
-        upperK_ = other.upperK_;
-        lowerK_ = other.lowerK_;
-        nPrime_ = other.nPrime_;
-        null_ = other.null_;
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+        }
 
-    }
+        size_type l = 0; // topmost level whose cursor has been moved
 
-    HybridK2Tree& operator=(const HybridK2Tree& other) {
+        for (size_type y = 0; y < L_.size(); y += lowerK_ * lowerK_) {
 
-        // check for self-assignment
-        if (&other == this) {
-            return *this;
-        }
+            for (; l < numLevels; l++) {
 
-        h_ = other.h_;
-        upperH_ = other.upperH_;
-        upperOnes_ = other.upperOnes_;
-        upperLength_ = other.upperLength_;
-        upperK_ = other.upperK_;
-        lowerK_ = other.lowerK_;
-        nPrime_ = other.nPrime_;
-        null_ = other.null_;
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % (k * k) / k) * n[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % k) * n[l + 1];
 
-        return *this;
+            }
 
-    }
+            for (size_type z = 0; z < lowerK_ * lowerK_; z++) {
+                if (L_[y + z] != null_) {
+                    func(dp[numLevels] + z / lowerK_, dq[numLevels] + z % lowerK_, y + z);
+                }
+            }
 
-    /**
-     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
-     *
-     * Assumes that all rows of mat are equally long.
-     */
-    HybridK2Tree(const matrix_type& mat, const size_type upperK, const size_type upperH, const size_type lowerK) {
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
 
-        null_ = false;
+                l--;
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type block = (cur[l] - start[l]) / (k * k);
 
-        upperK_ = upperK;
-        lowerK_ = lowerK;
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
+                }
 
-        size_type maxDim = std::max(mat.size(), mat[0].size());
+                steps = (cur[l] - start[l]) / (k * k) - block;
 
-        nPrime_ = size_type(ceil((1.0 * maxDim) / lowerK_));
-        upperH_ = std::min(upperH, std::max((size_type)1, logK(nPrime_, upperK_)));
+            }
 
-        nPrime_ = size_type(pow(upperK_, upperH_));
-        h_ = upperH_;
-        do {
+        }
 
-            nPrime_ *= lowerK_;
-            h_++;
+    }
 
-        } while (nPrime_ < maxDim);
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
 
-        std::vector<std::vector<bool>> levels(h_);
-        buildFromMatrix(mat, levels, mat.size(), mat[0].size(), nPrime_, 1, 0, 0);
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of nPrime_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
 
-        // helper variables (describe top section of conceptual k^2-tree) for navigation on T and L
-        upperOnes_ = 0;
-        upperLength_ = 0;
+        if (!L_.empty()) {
 
-        if (upperH_ > 0) {
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
 
-            for (size_t l = 0; l < upperH_ - 1; l++) {
-                for (auto i = 0; i < levels[l].size(); i++) {
-                    upperOnes_ += levels[l][i];
-                }
-            }
-            upperLength_ = (upperOnes_ + 1) * upperK_ * upperK_;
+            rowMajorScan(func, frontiers, nPrime_, 0, 0);
 
         }
 
-        size_type total = 0;
-        for (size_type l = 0; l < h_ - 1; l++) {
-            total += levels[l].size();
-        }
-        T_ = bit_vector_type(total);
+    }
 
-        bit_vector_type::iterator outIter = T_.begin();
-        for (size_type l = 0; l < h_ - 1; l++) {
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the n rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type n, size_type dp, size_type l) const {
 
-            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
-            levels[l].clear();
-            levels[l].shrink_to_fit();
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-        }
+        for (size_type i = 0; i < k; i++) {
 
-        L_ = bit_vector_type(levels[h_ - 1].size());
-        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
-        levels[h_ - 1].clear();
-        levels[h_ - 1].shrink_to_fit();
+            if (l == h_ - 1) {
 
-        R_ = rank_type(&T_);
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k; j++) {
 
-    }
+                        auto y = node.z + i * k + j - T_.size();
 
-    /**
-     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
-     *
-     * The actually used method depends on parameter mode.
-     */
-    HybridK2Tree(const RelationLists& lists, const size_type upperK, const size_type upperH, const size_type lowerK, const int mode) {
+                        if (L_[y] != null_) {
+                            func(dp + i, node.dq + j, y);
+                        }
 
-        null_ = false;
+                    }
+                }
+
+            } else {
+
+                auto kChild = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                frontiers[l + 1].clear();
+
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k; j++) {
+
+                        auto z = node.z + i * k + j;
+
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (n / k), node.dq + j * (n / k), (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kChild * kChild));
+                        }
+
+                    }
+                }
+
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, n / k, dp + i * (n / k), l + 1);
+                }
+
+            }
+
+        }
+
+    }
+
+    /* toCSR(), toCSC() */
+
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
+
+        offsets.assign(nPrime_ + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
+
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
+
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
+
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type y) {
+
+            auto pos = offsets[Transposed ? j : i]++;
+
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = L_[y];
+
+        });
+
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
+
+    }
+
+    /* transpose() */
+
+    HybridK2Tree* transposeInit() const {
+
+        auto res = new HybridK2Tree();
+
+        res->h_ = h_;
+        res->upperH_ = upperH_;
+        res->upperOnes_ = upperOnes_;
+        res->upperLength_ = upperLength_;
+        res->upperK_ = upperK_;
+        res->lowerK_ = lowerK_;
+        res->nPrime_ = nPrime_;
+        res->null_ = null_;
+
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = std::vector<elem_type>(L_.size());
+
+        if (!L_.empty()) {
+
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            for (size_type l = 1; l < h_ - 1; l++) {
+
+                auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * k * k;
+
+            }
+
+            transposeBlock(res, cursors, 1, 0);
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors
+    void transposeBlock(HybridK2Tree* res, std::vector<size_type>& cursors, size_type l, size_type z) const {
+
+        auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < k; i++) {
+                for (size_type j = 0; j < k; j++) {
+                    res->L_[cursors[l - 1]++] = L_[z + j * k + i - T_.size()];
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < k; i++) {
+                for (size_type j = 0; j < k; j++) {
+
+                    size_type y = z + j * k + i;
+                    size_type pos = cursors[l - 1]++;
+
+                    if (T_[y]) {
+
+                        res->T_[pos] = true;
+
+                        auto kc = (l < upperH_) ? upperK_ : lowerK_;
+                        transposeBlock(res, cursors, l + 1, (l >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l >= upperH_) * (upperOnes_ + 1)) * kc * kc);
+
+                    }
+
+                }
+            }
+
+        }
+
+    }
+
+    /* getSuccessorPositionsBatch(), expandRows() */
+
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
+
+        if (!L_.empty() && (first < last)) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            successorsBatch(rows, first, last, nPrime_ / k, 0, 0, 0, 1, func);
+
+        }
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children (on level l) starts at z and whose children have edge length n);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type n, size_type dp, size_type dq, size_type z, size_type l, Func& func) const {
+
+        size_type lenT = T_.size();
+        auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+
+        for (size_type t = first; t < last;) {
+
+            size_type r = (rows[t] - dp) / n;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / n == r)) e++;
+
+            if (z >= lenT) {
+
+                for (size_type c = 0; c < k; c++) {
+                    if (L_[z - lenT + r * k + c] != null_) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
+                }
+
+            } else {
+
+                auto kc = (l < upperH_) ? upperK_ : lowerK_;
+
+                for (size_type c = 0, y = z + r * k; c < k; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, n / kc, dp + r * n, dq + c * n, (l >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l >= upperH_) * (upperOnes_ + 1)) * kc * kc, l + 1, func);
+                    }
+                }
+
+            }
+
+            t = e;
+
+        }
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of HybridK2Tree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but makes use of some simplifications since the only non-null value is 1 / true.
+ */
+template<>
+class HybridK2Tree<bool> final : public virtual K2Tree<bool> {
+
+public:
+    typedef bool elem_type;
+
+    typedef K2Tree<elem_type>::matrix_type matrix_type;
+    typedef K2Tree<elem_type>::list_type list_type;
+    typedef K2Tree<elem_type>::positions_type positions_type;
+    typedef K2Tree<elem_type>::pairs_type pairs_type;
+
+
+    HybridK2Tree() {
+        // nothing to do
+    }
+
+    HybridK2Tree(const HybridK2Tree& other) {
+
+        h_ = other.h_;
+        upperH_ = other.upperH_;
+        upperOnes_ = other.upperOnes_;
+        upperLength_ = other.upperLength_;
+        upperK_ = other.upperK_;
+        lowerK_ = other.lowerK_;
+        nPrime_ = other.nPrime_;
+        null_ = other.null_;
+
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
+
+    }
+
+    HybridK2Tree& operator=(const HybridK2Tree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        h_ = other.h_;
+        upperH_ = other.upperH_;
+        upperOnes_ = other.upperOnes_;
+        upperLength_ = other.upperLength_;
+        upperK_ = other.upperK_;
+        lowerK_ = other.lowerK_;
+        nPrime_ = other.nPrime_;
+        null_ = other.null_;
+
+        T_ = other.T_;
+        L_ = other.L_;
+        R_ = rank_type(&T_);
+
+        return *this;
+
+    }
+
+    /**
+     * Matrix-based constructor (based on section 3.3.1. of Brisaboa et al.)
+     *
+     * Assumes that all rows of mat are equally long.
+     */
+    HybridK2Tree(const matrix_type& mat, const size_type upperK, const size_type upperH, const size_type lowerK) {
+
+        null_ = false;
+
+        upperK_ = upperK;
+        lowerK_ = lowerK;
+
+        size_type maxDim = std::max(mat.size(), mat[0].size());
+
+        nPrime_ = size_type(ceil((1.0 * maxDim) / lowerK_));
+        upperH_ = std::min(upperH, std::max((size_type)1, logK(nPrime_, upperK_)));
+
+        nPrime_ = size_type(pow(upperK_, upperH_));
+        h_ = upperH_;
+        do {
+
+            nPrime_ *= lowerK_;
+            h_++;
+
+        } while (nPrime_ < maxDim);
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromMatrix(mat, levels, mat.size(), mat[0].size(), nPrime_, 1, 0, 0);
+
+        // helper variables (describe top section of conceptual k^2-tree) for navigation on T and L
+        upperOnes_ = 0;
+        upperLength_ = 0;
+
+        if (upperH_ > 0) {
+
+            for (size_t l = 0; l < upperH_ - 1; l++) {
+                for (auto i = 0; i < levels[l].size(); i++) {
+                    upperOnes_ += levels[l][i];
+                }
+            }
+            upperLength_ = (upperOnes_ + 1) * upperK_ * upperK_;
+
+        }
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-lists-based constructor (based on sections 3.3.2. - 3.3.4. of Brisaboa et al.)
+     *
+     * The actually used method depends on parameter mode.
+     */
+    HybridK2Tree(const RelationLists& lists, const size_type upperK, const size_type upperH, const size_type lowerK, const int mode) {
+
+        null_ = false;
 
         upperK_ = upperK;
         lowerK_ = lowerK;
@@ -2300,63 +2797,64 @@ public:
 
 
     // returns the arity of the upper part of the K2Tree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the K2Tree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the K2Tree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the K2Tree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the K2Tree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return checkLinkInit(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsInit(succs, i);
-        allSuccessorPositionsIterative(succs, i);
+        QueryContext ctx;
+        allSuccessorPositionsIterative(succs, i, ctx);
 
         return succs;
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsInit(preds, j);
@@ -2365,7 +2863,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangeInit(pairs, i1, i2, j1, j2);
@@ -2375,12 +2873,12 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
 
         size_type res = 0;
         for (size_type i = 0; i < L_.size(); i++) {
@@ -2396,23 +2894,23 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -2425,15 +2923,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -2446,15 +2944,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2467,33 +2965,34 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
-        return getRange(0, nPrime_ - 1, 0, nPrime_ - 1);
-    }
+    positions_type getAllPositions() const override {
+
+        positions_type pairs;
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(std::make_pair(i, j)); });
 
-    pairs_type getAllValuedPositions() override {
+        return pairs;
 
-        auto pos = getAllPositions();
+    }
+
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type pairs;
-        for (auto& p : pos) {
-            pairs.push_back(ValuedPosition<elem_type>(p.first, p.second, true));
-        }
+        zOrderScan([&](size_type i, size_type j, size_type) { pairs.push_back(ValuedPosition<elem_type>(i, j, true)); });
 
         return pairs;
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
@@ -2502,7 +3001,7 @@ public:
         return new HybridK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2520,26 +3019,135 @@ public:
             for (size_type i = 0; i < T_.size(); i++) std::cout << T_[i];
             std::cout << std::endl << std::endl;
 
-            std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
-            std::cout << std::endl << std::endl;
+            std::cout << "### L ###" << std::endl;
+            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            std::cout << std::endl << std::endl;
+
+            std::cout << "### R ###" << std::endl;
+            printRanks(R_);
+            std::cout << std::endl;
+
+        }
+
+    }
+
+    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void setNull(size_type i, size_type j) override {
+        setInit(i, j);
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+//        return firstSuccessorInit(i);
+        QueryContext ctx;
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+        allSuccessorPositionsIterative(succs, i, ctx);
+    }
+
+    // the column descent is recursive and needs no scratch memory, so the context is not used
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+        predecessorsInit(preds, j);
+    }
+
+    size_type getFirstPredecessorIn(size_type j, const std::vector<bool>& rows, QueryContext&) const override {
+        return firstPredecessorInInit(rows, j);
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+        return firstSuccessorPositionIterative(i, ctx);
+    }
+
+    void toCSR(std::vector<size_type>& offsets, std::vector<size_type>& cols, std::vector<elem_type>* vals) const override {
+        compressInit<false>(offsets, cols, vals);
+    }
+
+    void toCSC(std::vector<size_type>& offsets, std::vector<size_type>& rows, std::vector<elem_type>* vals) const override {
+        compressInit<true>(offsets, rows, vals);
+    }
+
+
+    /*
+     * Full traversals (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, in Z-order (i.e. in the order of L_);
+    // walks over the tree level-wise from left to right and uses only O(h) additional memory
+    template<typename Func>
+    void forEachValuedPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j, true); });
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, in Z-order (i.e. in the order of L_)
+    template<typename Func>
+    void forEachPosition(Func func) const {
+        zOrderScan([&](size_type i, size_type j, size_type) { func(i, j); });
+    }
+
+    // calls func(i, j, val) for every valued pair (i,j,val) in R, sorted by row and column;
+    // processes the rows in bands and only keeps the nodes of the current bands (no materialisation, no sorting)
+    template<typename Func>
+    void forEachValuedPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j, true); };
+        rowMajorScanInit(f);
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R, sorted by row and column
+    template<typename Func>
+    void forEachPositionRowMajor(Func func) const {
+
+        auto f = [&](size_type i, size_type j, size_type) { func(i, j); };
+        rowMajorScanInit(f);
+
+    }
+
+
+    /*
+     * Transposition (not part of the K2Tree interface)
+     */
+
+    // returns a new K2Tree (to be deleted by the caller) of the transposed relation, i.e. of all pairs (j,i) with (i,j) in R;
+    // only permutes the children of every node, the levels of the new tree are written sequentially (in linear time)
+    HybridK2Tree* transpose() const {
+        return transposeInit();
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
 
-            std::cout << "### R ###" << std::endl;
-            printRanks(R_);
-            std::cout << std::endl;
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
 
-        }
+        successorsBatchInit(sorted, 0, sorted.size(), func);
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
-    void setNull(size_type i, size_type j) override {
-        setInit(i, j);
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
-//        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
     }
 
 
@@ -2848,11 +3456,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) const {
         return ((pair.first - sp.firstRow) / width) * k + (pair.second - sp.firstCol) / width;
     }
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) {
+    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2971,7 +3579,7 @@ private:
 
     /* areRelated() */
 
-    bool checkLinkInit(size_type p, size_type q) {
+    bool checkLinkInit(size_type p, size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -2979,7 +3587,7 @@ private:
 
     }
 
-    bool checkLink(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    bool checkLink(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -2995,11 +3603,13 @@ private:
 
     /* getSuccessors() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
@@ -3007,11 +3617,7 @@ private:
         if (lenT == 0) {
 
             size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
-                    succs.push_back(i);
-                }
-            }
+            forEachSetBit(L_, offset, nPrime_, [&](size_type i) { succs.push_back(i); });
 
         } else {
 
@@ -3020,7 +3626,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // successorsPos
@@ -3032,56 +3638,49 @@ private:
                 size_type a = (l >= upperH_) * upperLength_;
                 size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
-                        for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+                        forEachSetBit(T_, y, k, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
             size_type a = (l >= upperH_) * upperLength_;
             size_type b = (l >= upperH_) * (upperOnes_ + 1);
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            succs.push_back(newDq);
-                        }
-                    }
+                    forEachSetBit(L_, y, k, [&](size_type j) { succs.push_back(cur.dq + j * n); });
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
 
         if (!L_.empty()) {
 
@@ -3096,7 +3695,7 @@ private:
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -3124,7 +3723,7 @@ private:
 
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p, QueryContext& ctx) const {
 
         if (L_.empty()) return nPrime_;
 
@@ -3142,16 +3741,18 @@ private:
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type l = 1;
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
+            auto& stack = ctx.stack;
+            stack.clear();
+            stack.reserve(h_ + 1); // cur has to stay valid when a child is pushed
+            stack.emplace_back(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
 
             while (!stack.empty()) {
 
-                auto& cur = stack.top();
+                auto& cur = stack.back();
 
                 if (cur.j == ((l <= upperH_) ? upperK_ : lowerK_)) {
 
-                    stack.pop();
+                    stack.pop_back();
                     l--;
 
                 } else {
@@ -3167,7 +3768,7 @@ private:
                         if (T_[cur.z]) {
 
                             k = (l < upperH_) ? upperK_ : lowerK_;
-                            stack.emplace(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
+                            stack.emplace_back(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
                             l++;
 
                         }
@@ -3187,7 +3788,7 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
@@ -3206,7 +3807,7 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         size_type pos = nPrime_;
 
@@ -3237,7 +3838,7 @@ private:
 
     /* getPredecessors() */
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
 
         if (!L_.empty()) {
 
@@ -3252,7 +3853,7 @@ private:
 
     }
 
-    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -3277,9 +3878,62 @@ private:
 
     }
 
+    /* getFirstPredecessorIn() */
+
+    size_type firstPredecessorInInit(const std::vector<bool>& rows, size_type q) const {
+
+        if (!L_.empty()) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = q / (nPrime_ / k);
+
+            for (size_type i = 0; i < k; i++) {
+
+                auto p = firstPredecessorIn(rows, nPrime_ / k, q % (nPrime_ / k), (nPrime_ / k) * i, y + i * k, 1);
+
+                if (p < nPrime_) {
+                    return p;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
+    // same descent as in predecessors(), but stops at the first row p with rows[p]
+    size_type firstPredecessorIn(const std::vector<bool>& rows, size_type n, size_type q, size_type p, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+            return (L_[z - T_.size()] && rows[p]) ? p : nPrime_;
+        }
+
+        if (T_[z]) {
+
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
+            size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
+
+            for (size_type i = 0; i < k; i++) {
+
+                auto res = firstPredecessorIn(rows, n / k, q % (n / k), p + (n / k) * i, y + i * k, l + 1);
+
+                if (res < nPrime_) {
+                    return res;
+                }
+
+            }
+
+        }
+
+        return nPrime_;
+
+    }
+
     /* getRange() */
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -3313,7 +3967,7 @@ private:
 
     }
 
-    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -3327,6 +3981,18 @@ private:
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. every row of the range is a contiguous part of L_
+                    for (size_type i = p1; i <= p2; i++) {
+                        forEachSetBit(L_, y - T_.size() + k * i + q1, q2 - q1 + 1, [&](size_type j) { pairs.push_back(std::make_pair(dp + i, dq + q1 + j)); });
+                    }
+
+                    return;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
@@ -3359,7 +4025,7 @@ private:
 
     /* linkInRange() */
 
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
 
         if (!L_.empty()) {
 
@@ -3394,7 +4060,7 @@ private:
 
     }
 
-    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) {
+    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
@@ -3466,6 +4132,315 @@ private:
 
     }
 
+    /* getAllElements(), getAllPositions(), getAllValuedPositions(), forEachPosition(), forEachValuedPosition() */
+
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, in the order of L_ (Z-order);
+    // instead of a stack or queue of subproblems, only the current 1-bit ("cursor") on every level of T_ is kept
+    template<typename Func>
+    void zOrderScan(Func func) const {
+
+        if (L_.empty()) return;
+
+        size_type numLevels = h_ - 1;
+
+        // start of every level in T_, cursor on every level, and size and offsets of the submatrices
+        // that correspond to the cursors (index l + 1 belongs to the cursor on level l, index 0 to the whole matrix)
+        std::vector<size_type> start(numLevels + 1, 0), cur(numLevels), n(numLevels + 1, nPrime_), dp(numLevels + 1, 0), dq(numLevels + 1, 0);
+
+        for (size_type l = 0; l < numLevels; l++) {
+
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+            start[l + 1] = start[l] + ((l == 0) ? 1 : (R_.rank(start[l]) - R_.rank(start[l - 1]))) * k * k;
+            n[l + 1] = n[l] / k;
+
+            cur[l] = start[l];
+            while (!T_[cur[l]]) cur[l]++;
+
+        }
+
+        size_type l = 0; // topmost level whose cursor has been moved
+
+        for (size_type y = 0; y < L_.size(); y += lowerK_ * lowerK_) {
+
+            for (; l < numLevels; l++) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+                dp[l + 1] = dp[l] + ((cur[l] - start[l]) % (k * k) / k) * n[l + 1];
+                dq[l + 1] = dq[l] + ((cur[l] - start[l]) % k) * n[l + 1];
+
+            }
+
+            for (size_type z = 0; z < lowerK_ * lowerK_; z++) {
+                if (L_[y + z]) {
+                    func(dp[numLevels] + z / lowerK_, dq[numLevels] + z % lowerK_, y + z);
+                }
+            }
+
+            // move the cursor on the last level of T_ to its next 1-bit; whenever a cursor leaves its block,
+            // the cursor on the level above is moved once per block passed
+            size_type steps = 1;
+            while (steps > 0 && l > 0) {
+
+                l--;
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type block = (cur[l] - start[l]) / (k * k);
+
+                for (; steps > 0; steps--) {
+                    do {
+                        cur[l]++;
+                    } while (cur[l] < start[l + 1] && !T_[cur[l]]);
+                }
+
+                steps = (cur[l] - start[l]) / (k * k) - block;
+
+            }
+
+        }
+
+    }
+
+    /* forEachPositionRowMajor(), forEachValuedPositionRowMajor() */
+
+    // calls func(i, j, y) for every position y in L_ that holds a pair (i,j) of R, sorted by i and j;
+    // the rows are processed in bands of nPrime_ / k^l rows (depth-first, top to bottom), every band knows
+    // its nodes on level l ordered by column (its frontier) and refines them into the frontiers of its sub-bands
+    template<typename Func>
+    void rowMajorScanInit(Func& func) const {
+
+        if (!L_.empty()) {
+
+            // one frontier per level, reused by all bands on this level
+            std::vector<std::vector<SubmatrixInfo>> frontiers(h_);
+            frontiers[0].push_back(SubmatrixInfo(0, 0, 0));
+
+            rowMajorScan(func, frontiers, nPrime_, 0, 0);
+
+        }
+
+    }
+
+    // frontiers[l] contains the nodes of the current band on level l (the band consists of the n rows starting at row dp);
+    // every entry holds the offsets of a node and the start z of its block of children in T_ or L_
+    template<typename Func>
+    void rowMajorScan(Func& func, std::vector<std::vector<SubmatrixInfo>>& frontiers, size_type n, size_type dp, size_type l) const {
+
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+        for (size_type i = 0; i < k; i++) {
+
+            if (l == h_ - 1) {
+
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k; j++) {
+
+                        auto y = node.z + i * k + j - T_.size();
+
+                        if (L_[y]) {
+                            func(dp + i, node.dq + j, y);
+                        }
+
+                    }
+                }
+
+            } else {
+
+                auto kChild = (l + 1 < upperH_) ? upperK_ : lowerK_;
+
+                frontiers[l + 1].clear();
+
+                for (auto& node : frontiers[l]) {
+                    for (size_type j = 0; j < k; j++) {
+
+                        auto z = node.z + i * k + j;
+
+                        if (T_[z]) {
+                            frontiers[l + 1].push_back(SubmatrixInfo(dp + i * (n / k), node.dq + j * (n / k), (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kChild * kChild));
+                        }
+
+                    }
+                }
+
+                if (!frontiers[l + 1].empty()) {
+                    rowMajorScan(func, frontiers, n / k, dp + i * (n / k), l + 1);
+                }
+
+            }
+
+        }
+
+    }
+
+    /* toCSR(), toCSC() */
+
+    // counts the pairs per row (column, if Transposed) in a first Z-order scan and fills indices and vals in a second one;
+    // Z-order lists the pairs of every row by increasing column (and of every column by increasing row), so no sorting is needed
+    template<bool Transposed>
+    void compressInit(std::vector<size_type>& offsets, std::vector<size_type>& indices, std::vector<elem_type>* vals) const {
+
+        offsets.assign(nPrime_ + 1, 0);
+        zOrderScan([&](size_type i, size_type j, size_type) { offsets[(Transposed ? j : i) + 1]++; });
+
+        for (size_type i = 1; i < offsets.size(); i++) {
+            offsets[i] += offsets[i - 1];
+        }
+
+        indices.resize(offsets.back());
+        if (vals != nullptr) vals->resize(offsets.back());
+
+        // offsets[i] serves as insertion position of row (column) i (and equals offsets[i + 1] afterwards)
+        zOrderScan([&](size_type i, size_type j, size_type) {
+
+            auto pos = offsets[Transposed ? j : i]++;
+
+            indices[pos] = Transposed ? i : j;
+            if (vals != nullptr) (*vals)[pos] = true;
+
+        });
+
+        for (size_type i = offsets.size() - 1; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
+
+    }
+
+    /* transpose() */
+
+    HybridK2Tree* transposeInit() const {
+
+        auto res = new HybridK2Tree();
+
+        res->h_ = h_;
+        res->upperH_ = upperH_;
+        res->upperOnes_ = upperOnes_;
+        res->upperLength_ = upperLength_;
+        res->upperK_ = upperK_;
+        res->lowerK_ = lowerK_;
+        res->nPrime_ = nPrime_;
+        res->null_ = null_;
+
+        res->T_ = bit_vector_type(T_.size());
+        res->L_ = bit_vector_type(L_.size());
+
+        if (!L_.empty()) {
+
+            // every level of the new tree is a permutation of the same level of this tree, so its blocks are written
+            // one after another starting at the beginning of the level in T_ (resp. L_ for the last level)
+            std::vector<size_type> cursors(h_, 0);
+            for (size_type l = 1; l < h_ - 1; l++) {
+
+                auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+                cursors[l] = cursors[l - 1] + ((l == 1) ? 1 : (R_.rank(cursors[l - 1]) - R_.rank(cursors[l - 2]))) * k * k;
+
+            }
+
+            transposeBlock(res, cursors, 1, 0);
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // writes the transposed block of children starting at index z (on level l) and (recursively) their descendants
+    // to the positions of res given by cursors
+    void transposeBlock(HybridK2Tree* res, std::vector<size_type>& cursors, size_type l, size_type z) const {
+
+        auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < k; i++) {
+                for (size_type j = 0; j < k; j++) {
+                    res->L_[cursors[l - 1]++] = L_[z + j * k + i - T_.size()];
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < k; i++) {
+                for (size_type j = 0; j < k; j++) {
+
+                    size_type y = z + j * k + i;
+                    size_type pos = cursors[l - 1]++;
+
+                    if (T_[y]) {
+
+                        res->T_[pos] = true;
+
+                        auto kc = (l < upperH_) ? upperK_ : lowerK_;
+                        transposeBlock(res, cursors, l + 1, (l >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l >= upperH_) * (upperOnes_ + 1)) * kc * kc);
+
+                    }
+
+                }
+            }
+
+        }
+
+    }
+
+    /* getSuccessorPositionsBatch(), expandRows() */
+
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
+
+        if (!L_.empty() && (first < last)) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            successorsBatch(rows, first, last, nPrime_ / k, 0, 0, 0, 1, func);
+
+        }
+
+    }
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows[first], ..., rows[last - 1] (sorted ascending and
+    // all within the submatrix at (dp, dq) whose block of children (on level l) starts at z and whose children have edge length n);
+    // the rows are grouped by the child row they fall into, so that every child is visited only once per group
+    template<typename Func>
+    void successorsBatch(const std::vector<size_type>& rows, size_type first, size_type last, size_type n, size_type dp, size_type dq, size_type z, size_type l, Func& func) const {
+
+        size_type lenT = T_.size();
+        auto k = (l - 1 < upperH_) ? upperK_ : lowerK_;
+
+        for (size_type t = first; t < last;) {
+
+            size_type r = (rows[t] - dp) / n;
+            size_type e = t + 1;
+            while ((e < last) && ((rows[e] - dp) / n == r)) e++;
+
+            if (z >= lenT) {
+
+                for (size_type c = 0; c < k; c++) {
+                    if (L_[z - lenT + r * k + c]) {
+                        for (size_type u = t; u < e; u++) {
+                            func(rows[u], dq + c);
+                        }
+                    }
+                }
+
+            } else {
+
+                auto kc = (l < upperH_) ? upperK_ : lowerK_;
+
+                for (size_type c = 0, y = z + r * k; c < k; c++, y++) {
+                    if (T_[y]) {
+                        successorsBatch(rows, t, e, n / kc, dp + r * n, dq + c * n, (l >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l >= upperH_) * (upperOnes_ + 1)) * kc * kc, l + 1, func);
+                    }
+                }
+
+            }
+
+            t = e;
+
+        }
+
+    }
+
 };
 
 #endif //K2TREES_STATICHYBRIDTREE_HPP
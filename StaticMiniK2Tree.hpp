@@ -31,7 +31,7 @@
  * Simply contains a list of the relation pairs.
  */
 template<typename E>
-class MiniK2Tree : public virtual K2Tree<E> {
+class MiniK2Tree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -189,7 +189,6 @@ public:
 
             positions_[pos] = std::make_pair(iter->row - x, iter->col - y);
             values_[pos++] = iter->val;
-            pos++;
 
         }
 
@@ -202,7 +201,7 @@ public:
 
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
 
         size_type max = 0;
         for (size_type k = 0; k < length_; k++) {
@@ -213,7 +212,7 @@ public:
 
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
 
         size_type max = 0;
         for (size_type k = 0; k < length_; k++) {
@@ -224,19 +223,19 @@ public:
 
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return std::find_if(positions_, positions_ + length_,
                             [i, j](const std::pair<size_type, size_type>& val) {
                                 return val.first == i && val.second == j;
                             }) != positions_ + length_;
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
 
         auto iter = std::find_if(positions_, positions_ + length_,
                                  [i, j](const std::pair<size_type, size_type>& val) {
@@ -247,7 +246,7 @@ public:
 
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         for (size_type k = 0; k < length_; k++) {
@@ -260,7 +259,7 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
         for (size_type k = 0; k < length_; k++) {
@@ -273,7 +272,7 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         for (size_type k = 0; k < length_; k++) {
@@ -286,7 +285,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         for (size_type k = 0; k < length_; k++) {
@@ -299,7 +298,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         for (size_type k = 0; k < length_; k++) {
@@ -312,7 +311,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         for (size_type k = 0; k < length_; k++) {
@@ -325,7 +324,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         for (size_type k = 0; k < length_; k++) {
@@ -338,7 +337,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -351,7 +350,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -364,15 +363,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(values_, values_ + length_);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return positions_type(positions_, positions_ + length_);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -383,7 +382,7 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         bool flag = false;
         for (size_type k = 0; k < length_ && !flag; k++) {
@@ -394,7 +393,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -403,7 +402,7 @@ public:
         return new MiniK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "numRows  = " << getNumRows() << std::endl;
@@ -460,7 +459,7 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type min = getNumCols();
         for (size_type k = 0; k < length_; k++) {
@@ -473,32 +472,57 @@ public:
 
     }
 
+    // the pairs are scanned linearly, so the context is not used by the following overloads
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext&) const override {
+
+        for (size_type k = 0; k < length_; k++) {
+            if (positions_[k].first == i) {
+                succs.push_back(positions_[k].second);
+            }
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+
+        for (size_type k = 0; k < length_; k++) {
+            if (positions_[k].second == j) {
+                preds.push_back(positions_[k].first);
+            }
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext&) const override {
+        return getFirstSuccessor(i);
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -521,7 +545,7 @@ private:
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
-class MiniK2Tree<bool> : public virtual K2Tree<bool> {
+class MiniK2Tree<bool> final : public virtual K2Tree<bool> {
 
 public:
     typedef bool elem_type;
@@ -656,7 +680,7 @@ public:
         delete[] positions_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
 
         size_type max = 0;
         for (size_type i = 0; i < length_; i++) {
@@ -668,7 +692,7 @@ public:
 
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
 
         size_type max = 0;
         for (size_type i = 0; i < length_; i++) {
@@ -679,26 +703,26 @@ public:
 
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return false;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return std::find_if(positions_, positions_ + length_,
                             [i, j](const std::pair<size_type, size_type>& val) {
                                 return val.first == i && val.second == j;
                             }) != positions_ + length_;
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return std::find_if(positions_, positions_ + length_,
                             [i, j](const std::pair<size_type, size_type>& val) {
                                 return val.first == i && val.second == j;
                             }) != positions_ + length_;
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         for (size_type k = 0; k < length_; k++) {
@@ -711,7 +735,7 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
         for (size_type k = 0; k < length_; k++) {
@@ -724,7 +748,7 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         for (size_type k = 0; k < length_; k++) {
@@ -737,7 +761,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         for (size_type k = 0; k < length_; k++) {
@@ -750,7 +774,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         for (size_type k = 0; k < length_; k++) {
@@ -763,7 +787,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         for (size_type k = 0; k < length_; k++) {
@@ -776,7 +800,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         for (size_type k = 0; k < length_; k++) {
@@ -789,7 +813,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -802,7 +826,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -815,15 +839,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(length_, true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return positions_type(positions_, positions_ + length_);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -834,7 +858,7 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         bool flag = false;
         for (size_type k = 0; k < length_ && !flag; k++) {
@@ -845,7 +869,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -854,7 +878,7 @@ public:
         return new MiniK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "numRows  = " << getNumRows() << std::endl;
@@ -906,7 +930,7 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type min = getNumCols();
         for (size_type k = 0; k < length_; k++) {
@@ -919,32 +943,57 @@ public:
 
     }
 
+    // the pairs are scanned linearly, so the context is not used by the following overloads
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext&) const override {
+
+        for (size_type k = 0; k < length_; k++) {
+            if (positions_[k].first == i) {
+                succs.push_back(positions_[k].second);
+            }
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext&) const override {
+
+        for (size_type k = 0; k < length_; k++) {
+            if (positions_[k].second == j) {
+                preds.push_back(positions_[k].first);
+            }
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext&) const override {
+        return getFirstSuccessor(i);
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
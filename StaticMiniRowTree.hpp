@@ -33,7 +33,7 @@
  * Simply contains a list of the elements.
  */
 template<typename E>
-class MiniRowTree : public virtual RowTree<E> {
+class MiniRowTree final : public virtual RowTree<E> {
 
 public:
     typedef E elem_type;
@@ -142,20 +142,20 @@ public:
     }
 
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return length_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return std::find(positions_, positions_ + length_, i) != positions_ + length_;
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
 
         auto iter = std::find(positions_, positions_ + length_, i);
 
@@ -163,7 +163,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         for (size_type i = 0; i < length_; i++) {
@@ -176,7 +176,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -189,7 +189,7 @@ public:
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
         for (size_type i = 0; i < length_; i++) {
@@ -202,15 +202,20 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(values_, values_ + length_);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
         return std::vector<size_type>(positions_, positions_ + length_);
     }
 
-    list_type getAllValuedPositions() override {
+    // the positions are stored explicitly, so the context is not used
+    void getAllPositions(std::vector<size_type>& positions, QueryContext&) const override {
+        positions.insert(positions.end(), positions_, positions_ + length_);
+    }
+
+    list_type getAllValuedPositions() const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -221,7 +226,7 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
 
         bool flag = false;
         for (auto i = 0; i < length_ && !flag; i++) {
@@ -232,7 +237,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -241,7 +246,7 @@ public:
         return new MiniRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "length  = " << length_ << std::endl;
@@ -295,7 +300,7 @@ public:
 
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 
         size_type min = -1;
         for (auto i = 0; i < length_; i++) {
@@ -306,6 +311,38 @@ public:
 
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        size_type min = -1;
+        for (size_type i = 0; i < length_; i++) {
+            if (positions_[i] >= x) min = std::min(min, positions_[i]);
+        }
+
+        return min;
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        size_type max = -1;
+        for (size_type i = 0; i < length_; i++) {
+            if (positions_[i] <= x && (max == size_type(-1) || positions_[i] > max)) max = positions_[i];
+        }
+
+        return max;
+
+    }
+
+    // the positions are scanned anyway, so the cursor is not used
+    size_type nextGEQ(size_type x, RowTreeCursor&) const override {
+        return nextGEQ(x);
+    }
+
+    // the positions are scanned anyway, so the cursor is not used
+    size_type prevLEQ(size_type x, RowTreeCursor&) const override {
+        return prevLEQ(x);
+    }
+
 
 
 private:
@@ -325,7 +362,7 @@ private:
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
-class MiniRowTree<bool> : public virtual RowTree<bool> {
+class MiniRowTree<bool> final : public virtual RowTree<bool> {
 
 public:
     typedef bool elem_type;
@@ -423,24 +460,24 @@ public:
         delete positions_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return length_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return false;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return std::find(positions_, positions_ + length_, i) != positions_ + length_;
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return std::find(positions_, positions_ + length_, i) != positions_ + length_;
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         for (size_type i = 0; i < length_; i++) {
@@ -453,7 +490,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -466,7 +503,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -479,15 +516,20 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(length_, true);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
         return std::vector<size_type>(positions_, positions_ + length_);
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    // the positions are stored explicitly, so the context is not used
+    void getAllPositions(std::vector<size_type>& positions, QueryContext&) const override {
+        positions.insert(positions.end(), positions_, positions_ + length_);
+    }
+
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -498,7 +540,7 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
 
         bool flag = false;
         for (auto i = 0; i < length_ && !flag; i++) {
@@ -509,7 +551,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -518,7 +560,7 @@ public:
         return new MiniRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "length  = " << length_ << std::endl;
@@ -559,7 +601,7 @@ public:
 
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 
         size_type min = -1;
         for (auto i = 0; i < length_; i++) {
@@ -570,6 +612,38 @@ public:
 
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        size_type min = -1;
+        for (size_type i = 0; i < length_; i++) {
+            if (positions_[i] >= x) min = std::min(min, positions_[i]);
+        }
+
+        return min;
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        size_type max = -1;
+        for (size_type i = 0; i < length_; i++) {
+            if (positions_[i] <= x && (max == size_type(-1) || positions_[i] > max)) max = positions_[i];
+        }
+
+        return max;
+
+    }
+
+    // the positions are scanned anyway, so the cursor is not used
+    size_type nextGEQ(size_type x, RowTreeCursor&) const override {
+        return nextGEQ(x);
+    }
+
+    // the positions are scanned anyway, so the cursor is not used
+    size_type prevLEQ(size_type x, RowTreeCursor&) const override {
+        return prevLEQ(x);
+    }
+
 
 
 private:
@@ -33,15 +33,21 @@
  * Uses the same arity (k) on all levels and the described universe
  * has a size of nPrime, where nPrime is the smallest power of k
  * that exceeds the positions of all elements.
+ *
+ * The arity can be fixed at compile time (K > 0, a power of two, e.g. BasicRowTree<E, 2>),
+ * then point queries descend with shifts and masks instead of divisions and the constructors
+ * only accept k = K. With K = 0 (default) the arity is a pure run-time parameter.
  */
-template<typename E>
-class BasicRowTree : public virtual RowTree<E> {
+template<typename E, size_type K = 0>
+class BasicRowTree final : public virtual RowTree<E> {
 
 public:
     typedef E elem_type;
 
     typedef typename RowTree<elem_type>::list_type list_type;
 
+    static_assert((K != 1) && ((K & (K - 1)) == 0), "The compile-time arity (K) has to be 0 or a power of two.");
+
 
     BasicRowTree() {
         // nothing to do
@@ -88,6 +94,7 @@ public:
         null_ = null;
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(v.size(), k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -128,6 +135,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxCol + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -203,6 +211,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxCol + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -216,33 +225,33 @@ public:
 
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the RowTree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return getInit(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         rangeElemInit(elems, l, r);
@@ -252,7 +261,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangePosInit(positions, l, r);
@@ -262,7 +271,7 @@ public:
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
         rangeValPosInit(positions, l, r);
@@ -272,7 +281,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 //        return getElementsInRange(0, nPrime_ - 1);
         std::vector<elem_type> elements;
         fullRangeElemIterative(elements);
@@ -280,15 +289,20 @@ public:
 
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
-        fullRangePosIterative(positions);
+        QueryContext ctx;
+        fullRangePosIterative(positions, ctx);
         return positions;
 
     }
 
-    list_type getAllValuedPositions() override {
+    void getAllPositions(std::vector<size_type>& positions, QueryContext& ctx) const override {
+        fullRangePosIterative(positions, ctx);
+    }
+
+    list_type getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         list_type positions;
         fullRangeValPosIterative(positions);
@@ -296,12 +310,12 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
@@ -314,10 +328,10 @@ public:
 
 
     BasicRowTree* clone() const override {
-        return new BasicRowTree<elem_type>(*this);
+        return new BasicRowTree(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -348,11 +362,52 @@ public:
         setInit(i);
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return nextGEQIterative(x, cursor);
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return prevLEQIterative(x, cursor);
+
+    }
+
+    size_type nextGEQ(size_type x, RowTreeCursor& cursor) const override {
+        return nextGEQIterative(x, cursor);
+    }
+
+    size_type prevLEQ(size_type x, RowTreeCursor& cursor) const override {
+        return prevLEQIterative(x, cursor);
+    }
+
+
+    /*
+     * Set operations on RowTrees with the same parameters (not part of the RowTree interface)
+     */
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in every one of the given RowTrees
+    // (with the values of trees[0]); the RowTrees are traversed in lockstep and a subtree is skipped
+    // as soon as one of them has a 0-bit for it
+    static BasicRowTree* intersect(const std::vector<BasicRowTree*>& trees) {
+        return combineInit(trees, true);
+    }
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in at least one of the given RowTrees
+    // (with the value of the first RowTree that contains the element); the RowTrees are traversed in lockstep
+    // and a subtree is skipped if all of them have a 0-bit for it
+    static BasicRowTree* unite(const std::vector<BasicRowTree*>& trees) {
+        return combineInit(trees, false);
+    }
+
 
 
 private:
@@ -372,6 +427,23 @@ private:
     elem_type null_; // null element
 
 
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((K > 0) && (k_ != K)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arity (k) has to be equal to the compile-time arity (K)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
     /* helper method for construction from vector */
 
     bool buildFromVector(const std::vector<elem_type>& v, std::vector<std::vector<bool>>& levels, size_type numCols, size_type l, size_type q) {
@@ -624,11 +696,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename list_type::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const typename list_type::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair.first - sp.firstCol) / width;
     }
 
-    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -731,11 +803,20 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return !L_.empty() && descend(q, z) && (L_[z - T_.size()] != null_);
+
+        }
+
         return (L_.empty()) ? false : check(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
+
     }
 
-    bool check(size_type n, size_type q, size_type z) {
+    bool check(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return (L_[z - T_.size()] != null_);
@@ -747,11 +828,20 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type q) {
+    elem_type getInit(size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return (!L_.empty() && descend(q, z)) ? L_[z - T_.size()] : null_;
+
+        }
+
         return (L_.empty()) ? null_ : get(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
+
     }
 
-    elem_type get(size_type n, size_type q, size_type z) {
+    elem_type get(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -761,9 +851,33 @@ private:
 
     }
 
+    /* isNotNull() and getElement() with compile-time arity */
+
+    // descends to the leaf of q using shifts and masks instead of divisions (requires K > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type q, size_type& z) const {
+
+        const size_type logK = log2Pow2(K);
+        size_type s = (h_ - 1) * logK; // log2(n / K) on the current level
+
+        z = q >> s;
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            s -= logK;
+            z = R_.rank(z + 1) * K + ((q >> s) & (K - 1));
+
+        }
+
+        return true;
+
+    }
+
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
@@ -811,7 +925,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -833,7 +947,7 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         size_type pos = nPrime_;
 
@@ -869,11 +983,11 @@ private:
 
     /* getElementsInRange() */
 
-    void fullRangeElemIterative(std::vector<elem_type>& elems) {
+    void fullRangeElemIterative(std::vector<elem_type>& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
 
         if (lenT == 0) {
@@ -890,38 +1004,39 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
             n /= k_;
             for (; n > 1; n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -935,15 +1050,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) {
+    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -962,7 +1075,7 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -976,6 +1089,16 @@ private:
 
                 auto y = R_.rank(z + 1) * k_;
 
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. the range is a contiguous part of L_
+                    size_type offset = y - T_.size() + l;
+                    forEachNonNull(L_.data() + offset, r - l + 1, null_, [&](size_type j) { elems.push_back(L_[offset + j]); });
+
+                    return;
+
+                }
+
                 for (auto j = l / (n / k_); j <= r / (n / k_); j++) {
                     rangeElem(
                             elems,
@@ -996,11 +1119,13 @@ private:
 
     /* getPositionsInRange() */
 
-    void fullRangePosIterative(std::vector<size_type>& elems) {
+    void fullRangePosIterative(std::vector<size_type>& elems, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         if (lenT == 0) {
@@ -1017,38 +1142,39 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
             n /= k_;
             for (; n > 1; n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1062,15 +1188,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1089,7 +1213,7 @@ private:
 
     }
 
-    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1123,11 +1247,11 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void fullRangeValPosIterative(list_type& elems) {
+    void fullRangeValPosIterative(list_type& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
 
         if (lenT == 0) {
@@ -1144,38 +1268,39 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
             n /= k_;
             for (; n > 1; n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
+                            nextLevelQueue.emplace_back(newDq, y);
                         }
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
@@ -1189,15 +1314,13 @@ private:
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeValPosInit(list_type& elems, size_type l, size_type r) {
+    void rangeValPosInit(list_type& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1216,7 +1339,7 @@ private:
 
     }
 
-    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1249,7 +1372,7 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1271,7 +1394,7 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -1327,6 +1450,265 @@ private:
 
     }
 
+    /* nextGEQ(), prevLEQ() */
+
+    // initialises an unused cursor, otherwise moves it up to the deepest node on its path whose subrow contains x
+    void moveCursorUp(RowTreeCursor& cursor, size_type x) const {
+
+        if (cursor.z.empty()) {
+
+            cursor.n.assign(h_, nPrime_ / k_);
+            cursor.dq.assign(h_, 0);
+            cursor.z.assign(h_, 0);
+            cursor.level = 0;
+
+        } else {
+
+            while (cursor.level > 0 && (x < cursor.dq[cursor.level] || x >= cursor.dq[cursor.level] + cursor.n[cursor.level] * k_)) {
+                cursor.level--;
+            }
+
+        }
+
+    }
+
+    // descends from the node the cursor points to and checks its children from left to right,
+    // skipping 0-bits and backtracking to the parent (next child) when a subrow does not contain an element >= x
+    size_type nextGEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty() || x >= nPrime_) return -1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()] != null_) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                cursor.n[l + 1] = cursor.n[l] / k_;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = R_.rank(z + 1) * k_;
+                l++;
+
+                j = (x > cursor.dq[l]) ? (x - cursor.dq[l]) / cursor.n[l] : 0;
+                continue;
+
+            }
+
+            while (j == k_ - 1) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j++;
+
+        }
+
+    }
+
+    // like nextGEQIterative(), but checks the children from right to left
+    size_type prevLEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty()) return -1;
+        if (x >= nPrime_) x = nPrime_ - 1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()] != null_) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                cursor.n[l + 1] = cursor.n[l] / k_;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = R_.rank(z + 1) * k_;
+                l++;
+
+                j = std::min(k_ - 1, (x - cursor.dq[l]) / cursor.n[l]);
+                continue;
+
+            }
+
+            while (j == 0) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j--;
+
+        }
+
+    }
+
+    /* intersect(), unite() */
+
+    static BasicRowTree* combineInit(const std::vector<BasicRowTree*>& trees, bool intersection) {
+
+        if (trees.empty()) {
+            throw std::runtime_error(std::string() + "Unsuitable parameters! " + "At least one RowTree is needed.");
+        }
+
+        for (auto t : trees) {
+
+            if ((t->k_ != trees[0]->k_) || (t->h_ != trees[0]->h_)) {
+
+                std::string err = std::string() +
+                                  "Unsuitable parameters! " +
+                                  "All RowTrees have to have the same arity (k) and height (h)."
+                ;
+
+                throw std::runtime_error(err);
+
+            }
+
+        }
+
+        auto res = new BasicRowTree();
+
+        res->k_ = trees[0]->k_;
+        res->h_ = trees[0]->h_;
+        res->nPrime_ = trees[0]->nPrime_;
+        res->null_ = trees[0]->null_;
+
+        // nodes on the current level (index of the RowTree and start of the block of children) in all RowTrees containing them
+        std::vector<std::pair<size_type, size_type>> nodes;
+        for (size_type t = 0; t < trees.size(); t++) {
+            if (!trees[t]->L_.empty()) nodes.push_back(std::make_pair(t, 0));
+        }
+
+        if (!nodes.empty() && (!intersection || (nodes.size() == trees.size()))) {
+
+            std::vector<std::vector<bool>> levels(res->h_ - 1);
+            res->combine(trees, intersection, nodes, levels, 1);
+
+            size_type total = 0;
+            for (auto l = 0; l < res->h_ - 1; l++) {
+                total += levels[l].size();
+            }
+            res->T_ = bit_vector_type(total);
+
+            bit_vector_type::iterator outIter = res->T_.begin();
+            for (size_type l = 0; l < res->h_ - 1; l++) {
+
+                outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                levels[l].clear();
+                levels[l].shrink_to_fit();
+
+            }
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // appends the children of the current node (on level l) to levels resp. L_ and returns whether there are any,
+    // nodes contains the index and the start of the block of children of the current node in every relevant RowTree
+    bool combine(const std::vector<BasicRowTree*>& trees, bool intersection, const std::vector<std::pair<size_type, size_type>>& nodes, std::vector<std::vector<bool>>& levels, size_type l) {
+
+        if (l == h_) {
+
+            std::vector<elem_type> C;
+
+            for (size_type j = 0; j < k_; j++) {
+
+                size_type cnt = 0;
+                elem_type val = null_;
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+                    auto& e = t->L_[node.second + j - t->T_.size()];
+
+                    if (e != t->null_) {
+
+                        if (cnt == 0) val = e;
+                        cnt++;
+
+                    }
+
+                }
+
+                C.push_back((intersection && (cnt != trees.size())) ? null_ : val);
+
+            }
+
+            if (isAll(C, null_)) {
+                return false;
+            } else {
+
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        } else {
+
+            std::vector<bool> C;
+            std::vector<std::pair<size_type, size_type>> children;
+
+            for (size_type j = 0; j < k_; j++) {
+
+                children.clear();
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+
+                    if (t->T_[node.second + j]) {
+                        children.push_back(std::make_pair(node.first, t->R_.rank(node.second + j + 1) * k_));
+                    } else if (intersection) {
+                        break;
+                    }
+
+                }
+
+                C.push_back(!children.empty() && (!intersection || (children.size() == trees.size())) && combine(trees, intersection, children, levels, l + 1));
+
+            }
+
+            if (isAllZero(C)) {
+                return false;
+            } else {
+
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        }
+    }
+
 };
 
 
@@ -1336,14 +1718,16 @@ private:
  * Has the same characteristics as the general implementation above,
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
-template<>
-class BasicRowTree<bool> : public virtual RowTree<bool> {
+template<size_type K>
+class BasicRowTree<bool, K> final : public virtual RowTree<bool> {
 
 public:
     typedef bool elem_type;
 
     typedef RelationList list_type;
 
+    static_assert((K != 1) && ((K & (K - 1)) == 0), "The compile-time arity (K) has to be 0 or a power of two.");
+
 
     BasicRowTree() {
         // nothing to do
@@ -1390,6 +1774,7 @@ public:
         null_ = false;
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(v.size(), k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -1435,6 +1820,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxCol + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -1515,6 +1901,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxIndex + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -1539,6 +1926,7 @@ public:
         }
 
         k_ = k;
+        checkArity();
         h_ = std::max((size_type)1, logK(maxCol + 1, k_));
         nPrime_ = size_type(pow(k_, h_));
 
@@ -1552,37 +1940,37 @@ public:
 
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the RowTree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return isNotNull(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
         return std::vector<elem_type>(getPositionsInRange(l, r).size(), 1);
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1592,7 +1980,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1607,19 +1995,24 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countElements(), 1);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
-        fullRangeIterative(positions);
+        QueryContext ctx;
+        fullRangeIterative(positions, ctx);
         return positions;
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    void getAllPositions(std::vector<size_type>& positions, QueryContext& ctx) const override {
+        fullRangeIterative(positions, ctx);
+    }
+
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         std::vector<std::pair<size_type, elem_type>> positions;
         fullRangeValPosIterative(positions);
@@ -1627,12 +2020,12 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
@@ -1645,10 +2038,10 @@ public:
 
 
     BasicRowTree* clone() const override {
-        return new BasicRowTree<elem_type>(*this);
+        return new BasicRowTree(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -1679,11 +2072,52 @@ public:
         setInit(i);
     }
 
-    size_type getFirst() override {
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
 
+    size_type nextGEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return nextGEQIterative(x, cursor);
+
+    }
+
+    size_type prevLEQ(size_type x) const override {
+
+        RowTreeCursor cursor;
+        return prevLEQIterative(x, cursor);
+
+    }
+
+    size_type nextGEQ(size_type x, RowTreeCursor& cursor) const override {
+        return nextGEQIterative(x, cursor);
+    }
+
+    size_type prevLEQ(size_type x, RowTreeCursor& cursor) const override {
+        return prevLEQIterative(x, cursor);
+    }
+
+
+    /*
+     * Set operations on RowTrees with the same parameters (not part of the RowTree interface)
+     */
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in every one of the given RowTrees
+    // (with the values of trees[0]); the RowTrees are traversed in lockstep and a subtree is skipped
+    // as soon as one of them has a 0-bit for it
+    static BasicRowTree* intersect(const std::vector<BasicRowTree*>& trees) {
+        return combineInit(trees, true);
+    }
+
+    // returns a new RowTree (to be deleted by the caller) of all elements that are contained in at least one of the given RowTrees
+    // (with the value of the first RowTree that contains the element); the RowTrees are traversed in lockstep
+    // and a subtree is skipped if all of them have a 0-bit for it
+    static BasicRowTree* unite(const std::vector<BasicRowTree*>& trees) {
+        return combineInit(trees, false);
+    }
+
 
 
 private:
@@ -1702,6 +2136,23 @@ private:
 
     elem_type null_; // null element
 
+    /* helper method to check the arity against the compile-time arity prior to construction */
+
+    void checkArity() const {
+
+        if ((K > 0) && (k_ != K)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The arity (k) has to be equal to the compile-time arity (K)."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
     /* helper method for construction from vector */
 
     bool buildFromVector(const bit_vector_type& v, std::vector<std::vector<bool>>& levels, size_type numCols, size_type l, size_type q) {
@@ -1941,11 +2392,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const list_type::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const list_type::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair - sp.firstCol) / width;
     }
 
-    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(list_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2052,11 +2503,11 @@ private:
 
     /* helper methods for inplace construction from single list of pairs given as iterators */
 
-    size_type computeKey(const std::vector<std::pair<size_type, size_type>>::iterator::value_type& pair, const Subproblem& sp, size_type width) {
+    size_type computeKey(const std::vector<std::pair<size_type, size_type>>::iterator::value_type& pair, const Subproblem& sp, size_type width) const {
         return (pair.second - sp.firstCol) / width;
     }
 
-    void countingSort(const std::vector<std::pair<size_type, size_type>>::iterator& first, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    void countingSort(const std::vector<std::pair<size_type, size_type>>::iterator& first, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2164,11 +2615,20 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
+
+        if (K > 0) {
+
+            size_type z;
+            return !L_.empty() && descend(q, z) && L_[z - T_.size()];
+
+        }
+
         return (L_.empty()) ? false : check(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
+
     }
 
-    bool check(size_type n, size_type q, size_type z) {
+    bool check(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
             return L_[z - T_.size()];
@@ -2178,22 +2638,44 @@ private:
 
     }
 
+    /* isNotNull() and getElement() with compile-time arity */
+
+    // descends to the leaf of q using shifts and masks instead of divisions (requires K > 0);
+    // returns false if a 0-bit is reached, otherwise z is the index of the leaf in (the conceptual concatenation of) T and L
+    bool descend(size_type q, size_type& z) const {
+
+        const size_type logK = log2Pow2(K);
+        size_type s = (h_ - 1) * logK; // log2(n / K) on the current level
+
+        z = q >> s;
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) return false;
+
+            s -= logK;
+            z = R_.rank(z + 1) * K + ((q >> s) & (K - 1));
+
+        }
+
+        return true;
+
+    }
+
     /* getRange() */
 
-    void fullRangeIterative(std::vector<size_type>& elems) {
+    void fullRangeIterative(std::vector<size_type>& elems, QueryContext& ctx) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        auto& queue = ctx.frontier;
+        auto& nextLevelQueue = ctx.nextFrontier;
+        queue.clear();
         size_type lenT = T_.size();
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(i);
-                }
-            }
+            forEachSetBit(L_, 0, nPrime_, [&](size_type i) { elems.push_back(i); });
 
         } else {
 
@@ -2201,73 +2683,62 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
             n /= k_;
             for (; n > 1; n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
-                        for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+                        forEachSetBit(T_, y, k_, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(newDq);
-                        }
-                    }
+                    forEachSetBit(L_, y, k_, [&](size_type j) { elems.push_back(cur.dq + j * n); });
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) {
+    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) const {
 
         if (L_.empty()) return;
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
+        std::vector<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(std::make_pair(i, 1));
-                }
-            }
+            forEachSetBit(L_, 0, nPrime_, [&](size_type i) { elems.push_back(std::make_pair(i, 1)); });
 
         } else {
 
@@ -2275,60 +2746,53 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
-                queue.push(SubrowInfo(dq, z));
+                queue.emplace_back(dq, z);
             }
 
             // range
             n /= k_;
             for (; n > 1; n /= k_) {
 
-                while (!queue.empty()) {
+                for (size_type i = 0; i < queue.size(); i++) {
 
-                    auto& cur = queue.front();
+                    prefetchFrontier(T_, queue, i);
+                    auto& cur = queue[i];
 
                     if (T_[cur.z]) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
-                        for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                            nextLevelQueue.push(SubrowInfo(newDq, y));
-                        }
+                        forEachSetBit(T_, y, k_, [&](size_type j) { nextLevelQueue.emplace_back(cur.dq + j * n, y + j); });
 
                     }
 
-                    queue.pop();
-
                 }
 
                 queue.swap(nextLevelQueue);
+                nextLevelQueue.clear();
 
             }
 
-            while (!queue.empty()) {
+            for (size_type i = 0; i < queue.size(); i++) {
 
-                auto& cur = queue.front();
+                prefetchFrontier(T_, queue, i);
+                auto& cur = queue[i];
 
                 if (T_[cur.z]) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
 
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(std::make_pair(newDq, 1));
-                        }
-                    }
+                    forEachSetBit(L_, y, k_, [&](size_type j) { elems.push_back(std::make_pair(cur.dq + j * n, 1)); });
 
                 }
 
-                queue.pop();
-
             }
 
         }
 
     }
 
-    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2347,7 +2811,7 @@ private:
 
     }
 
-    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -2361,6 +2825,15 @@ private:
 
                 auto y = R_.rank(z + 1) * k_;
 
+                if (y >= T_.size()) {
+
+                    // all children are leaves, i.e. the range is a contiguous part of L_
+                    forEachSetBit(L_, y - T_.size() + l, r - l + 1, [&](size_type j) { elems.push_back(dq + l + j); });
+
+                    return;
+
+                }
+
                 for (auto j = l / (n / k_); j <= r / (n / k_); j++) {
                     range(
                             elems,
@@ -2380,7 +2853,7 @@ private:
 
     /* containsElements() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2402,7 +2875,7 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z) const {
 
         if (z >= T_.size()) {
 
@@ -2460,7 +2933,7 @@ private:
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
@@ -2508,7 +2981,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -2530,7 +3003,7 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         size_type pos = nPrime_;
 
@@ -2564,6 +3037,249 @@ private:
 
     }
 
+    /* nextGEQ(), prevLEQ() */
+
+    // initialises an unused cursor, otherwise moves it up to the deepest node on its path whose subrow contains x
+    void moveCursorUp(RowTreeCursor& cursor, size_type x) const {
+
+        if (cursor.z.empty()) {
+
+            cursor.n.assign(h_, nPrime_ / k_);
+            cursor.dq.assign(h_, 0);
+            cursor.z.assign(h_, 0);
+            cursor.level = 0;
+
+        } else {
+
+            while (cursor.level > 0 && (x < cursor.dq[cursor.level] || x >= cursor.dq[cursor.level] + cursor.n[cursor.level] * k_)) {
+                cursor.level--;
+            }
+
+        }
+
+    }
+
+    // descends from the node the cursor points to and checks its children from left to right,
+    // skipping 0-bits and backtracking to the parent (next child) when a subrow does not contain an element >= x
+    size_type nextGEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty() || x >= nPrime_) return -1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()]) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                cursor.n[l + 1] = cursor.n[l] / k_;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = R_.rank(z + 1) * k_;
+                l++;
+
+                j = (x > cursor.dq[l]) ? (x - cursor.dq[l]) / cursor.n[l] : 0;
+                continue;
+
+            }
+
+            while (j == k_ - 1) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j++;
+
+        }
+
+    }
+
+    // like nextGEQIterative(), but checks the children from right to left
+    size_type prevLEQIterative(size_type x, RowTreeCursor& cursor) const {
+
+        if (L_.empty()) return -1;
+        if (x >= nPrime_) x = nPrime_ - 1;
+
+        moveCursorUp(cursor, x);
+
+        auto& l = cursor.level;
+        size_type j = (x - cursor.dq[l]) / cursor.n[l];
+
+        while (true) {
+
+            auto z = cursor.z[l] + j;
+
+            if (z >= T_.size()) {
+
+                if (L_[z - T_.size()]) {
+                    return cursor.dq[l] + j;
+                }
+
+            } else if (T_[z]) {
+
+                cursor.n[l + 1] = cursor.n[l] / k_;
+                cursor.dq[l + 1] = cursor.dq[l] + j * cursor.n[l];
+                cursor.z[l + 1] = R_.rank(z + 1) * k_;
+                l++;
+
+                j = std::min(k_ - 1, (x - cursor.dq[l]) / cursor.n[l]);
+                continue;
+
+            }
+
+            while (j == 0) {
+
+                if (l == 0) return -1;
+
+                l--;
+                j = (cursor.dq[l + 1] - cursor.dq[l]) / cursor.n[l];
+
+            }
+
+            j--;
+
+        }
+
+    }
+
+    /* intersect(), unite() */
+
+    static BasicRowTree* combineInit(const std::vector<BasicRowTree*>& trees, bool intersection) {
+
+        if (trees.empty()) {
+            throw std::runtime_error(std::string() + "Unsuitable parameters! " + "At least one RowTree is needed.");
+        }
+
+        for (auto t : trees) {
+
+            if ((t->k_ != trees[0]->k_) || (t->h_ != trees[0]->h_)) {
+
+                std::string err = std::string() +
+                                  "Unsuitable parameters! " +
+                                  "All RowTrees have to have the same arity (k) and height (h)."
+                ;
+
+                throw std::runtime_error(err);
+
+            }
+
+        }
+
+        auto res = new BasicRowTree();
+
+        res->k_ = trees[0]->k_;
+        res->h_ = trees[0]->h_;
+        res->nPrime_ = trees[0]->nPrime_;
+        res->null_ = false;
+
+        // nodes on the current level (index of the RowTree and start of the block of children) in all RowTrees containing them
+        std::vector<std::pair<size_type, size_type>> nodes;
+        for (size_type t = 0; t < trees.size(); t++) {
+            if (!trees[t]->L_.empty()) nodes.push_back(std::make_pair(t, 0));
+        }
+
+        if (!nodes.empty() && (!intersection || (nodes.size() == trees.size()))) {
+
+            std::vector<std::vector<bool>> levels(res->h_);
+            res->combine(trees, intersection, nodes, levels, 1);
+
+            size_type total = 0;
+            for (auto l = 0; l < res->h_ - 1; l++) {
+                total += levels[l].size();
+            }
+            res->T_ = bit_vector_type(total);
+
+            bit_vector_type::iterator outIter = res->T_.begin();
+            for (size_type l = 0; l < res->h_ - 1; l++) {
+
+                outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+                levels[l].clear();
+                levels[l].shrink_to_fit();
+
+            }
+
+            res->L_ = bit_vector_type(levels[res->h_ - 1].size());
+            std::move(levels[res->h_ - 1].begin(), levels[res->h_ - 1].end(), res->L_.begin());
+            levels[res->h_ - 1].clear();
+            levels[res->h_ - 1].shrink_to_fit();
+
+        }
+
+        res->R_ = rank_type(&res->T_);
+
+        return res;
+
+    }
+
+    // appends the children of the current node (on level l) to levels resp. L_ and returns whether there are any,
+    // nodes contains the index and the start of the block of children of the current node in every relevant RowTree
+    bool combine(const std::vector<BasicRowTree*>& trees, bool intersection, const std::vector<std::pair<size_type, size_type>>& nodes, std::vector<std::vector<bool>>& levels, size_type l) {
+
+        std::vector<bool> C;
+
+        if (l == h_) {
+
+            for (size_type j = 0; j < k_; j++) {
+
+                size_type cnt = 0;
+
+                for (auto& node : nodes) {
+                    cnt += trees[node.first]->L_[node.second + j - trees[node.first]->T_.size()];
+                }
+
+                C.push_back(intersection ? (cnt == trees.size()) : (cnt > 0));
+
+            }
+
+        } else {
+
+            std::vector<std::pair<size_type, size_type>> children;
+
+            for (size_type j = 0; j < k_; j++) {
+
+                children.clear();
+
+                for (auto& node : nodes) {
+
+                    auto t = trees[node.first];
+
+                    if (t->T_[node.second + j]) {
+                        children.push_back(std::make_pair(node.first, t->R_.rank(node.second + j + 1) * k_));
+                    } else if (intersection) {
+                        break;
+                    }
+
+                }
+
+                C.push_back(!children.empty() && (!intersection || (children.size() == trees.size())) && combine(trees, intersection, children, levels, l + 1));
+
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+    }
+
 };
 
 #endif //K2TREES_STATICROWTREE_HPP
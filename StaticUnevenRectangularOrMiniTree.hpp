@@ -30,10 +30,21 @@
 #include "StaticRowTree.hpp"
 #include "Utility.hpp"
 #include "StaticMiniK2Tree.hpp"
+#include "StaticDenseK2Tree.hpp"
+
+/**
+ * Policies for choosing the representation of the partitions of an UnevenKrKcOrMiniTree.
+ */
+enum PartitionPolicy {
+    PARTITIONS_BY_THRESHOLD, // KrKcTree for partitions with more than mb relation pairs, MiniK2Tree otherwise
+    PARTITIONS_BY_SIZE // MiniK2Tree for partitions with at most mb relation pairs, otherwise the smallest (by estimated size) of KrKcTree, MiniK2Tree and DenseK2Tree
+};
 
 /**
  * Uneven rectangular implementation of K2Tree that uses MiniK2Tree instances
  * for partitions with a number of relation pairs below a specified threshold.
+ * Depending on the PartitionPolicy, larger partitions are either KrKcTrees or
+ * the smallest of KrKcTree, MiniK2Tree and DenseK2Tree for their contents.
  *
  * Uses two different arities for rows and columns (kr, kc) and allows for a different
  * number of levels over rows and columns. This effectively leads to a partitioning
@@ -41,9 +52,11 @@
  * The described relation matrix is rectangular with edge lengths of numRows and numCols,
  * where numRows (numCols) is the smallest power of kr (kc) that exceeds the row (column) numbers
  * of all relation pairs.
+ * Row (column) queries that span several partitions use a small occupancy index (a KrKcTree<bool>
+ * over rows (columns) and partitions) to only visit the partitions containing relation pairs in that row (column).
  */
 template<typename E>
-class UnevenKrKcOrMiniTree : public virtual K2Tree<E> {
+class UnevenKrKcOrMiniTree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -73,10 +86,12 @@ public:
 
         partitions_ = new K2Tree<elem_type>*[other.numPartitions_];
         for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = other.partitions_[k]->clone();
+            partitions_[k] = (other.partitions_[k] != 0) ? other.partitions_[k]->clone() : 0;
         }
-        partitionSize_ = other.partitionSize_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
+        tagPartitions();
 
     }
 
@@ -101,10 +116,12 @@ public:
         delete[] partitions_;
         partitions_ = new K2Tree<elem_type>*[other.numPartitions_];
         for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = other.partitions_[k]->clone();
+            partitions_[k] = (other.partitions_[k] != 0) ? other.partitions_[k]->clone() : 0;
         }
-        partitionSize_ = other.partitionSize_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
+        tagPartitions();
 
         return *this;
 
@@ -113,7 +130,15 @@ public:
     /**
      * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
      */
-    UnevenKrKcOrMiniTree(pairs_type& pairs, const size_type kr, const size_type kc, const size_type mb, const elem_type null = elem_type()) {
+    UnevenKrKcOrMiniTree(pairs_type& pairs, const size_type kr, const size_type kc, const size_type mb, const elem_type null = elem_type())
+        : UnevenKrKcOrMiniTree(pairs, kr, kc, mb, PARTITIONS_BY_THRESHOLD, null) {
+        // nothing to do
+    }
+
+    /**
+     * List-of-pairs-based constructor that chooses the representation of the partitions according to policy
+     */
+    UnevenKrKcOrMiniTree(pairs_type& pairs, const size_type kr, const size_type kc, const size_type mb, const PartitionPolicy policy, const elem_type null = elem_type()) {
 
         null_ = null;
 
@@ -135,7 +160,7 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
             partitions_ = new K2Tree<elem_type>*[numPartitions_];
 
@@ -144,17 +169,13 @@ public:
             countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                if (intervals[i].second - intervals[i].first > mb) {
-                    partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_, null);
-                } else {
-                    partitions_[i] = new MiniK2Tree<elem_type>(pairs.begin() + intervals[i].first, pairs.begin() + intervals[i].second, 0, i * partitionSize_, null);
-                }
+                partitions_[i] = createPartition(pairs, intervals[i].first, intervals[i].second, 0, i * partitionSize_, numRows_, partitionSize_, mb, policy, null);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
             partitions_ = new K2Tree<elem_type>*[numPartitions_];
 
@@ -163,11 +184,7 @@ public:
             countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                if (intervals[j].second - intervals[j].first > mb) {
-                    partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_, null);
-                } else {
-                    partitions_[j] = new MiniK2Tree<elem_type>(pairs.begin() + intervals[j].first, pairs.begin() + intervals[j].second, j * partitionSize_, 0, null);
-                }
+                partitions_[j] = createPartition(pairs, intervals[j].first, intervals[j].second, j * partitionSize_, 0, partitionSize_, numCols_, mb, policy, null);
             }
 
         }
@@ -185,6 +202,9 @@ public:
         }
 #endif
 
+        tagPartitions();
+        buildOccupancy();
+
     }
 
     ~UnevenKrKcOrMiniTree() {
@@ -198,72 +218,83 @@ public:
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
 
-        return (p != 0) && p->isNotNull(pis.row, pis.col);
+        if (krKcPartitions_[pis.partition] != 0) {
+            return krKcPartitions_[pis.partition]->KrKcTree<elem_type>::isNotNull(pis.row, pis.col);
+        } else if (miniPartitions_[pis.partition] != 0) {
+            return miniPartitions_[pis.partition]->MiniK2Tree<elem_type>::isNotNull(pis.row, pis.col);
+        } else if (densePartitions_[pis.partition] != 0) {
+            return densePartitions_[pis.partition]->DenseK2Tree<elem_type>::isNotNull(pis.row, pis.col);
+        } else {
+            return false;
+        }
 
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
 
-        return (p != 0) ? p->getElement(pis.row, pis.col) : null_;
+        if (krKcPartitions_[pis.partition] != 0) {
+            return krKcPartitions_[pis.partition]->KrKcTree<elem_type>::getElement(pis.row, pis.col);
+        } else if (miniPartitions_[pis.partition] != 0) {
+            return miniPartitions_[pis.partition]->MiniK2Tree<elem_type>::getElement(pis.row, pis.col);
+        } else if (densePartitions_[pis.partition] != 0) {
+            return densePartitions_[pis.partition]->DenseK2Tree<elem_type>::getElement(pis.row, pis.col);
+        } else {
+            return null_;
+        }
 
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
 
         if (hc_ > hr_) {
 
-            for (size_type k = 0; k < numPartitions_; k++) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorElements(i);
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
 
-                }
+                auto tmp = p->getSuccessorElements(i);
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
 
             }
 
@@ -281,28 +312,25 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessorPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -319,28 +347,25 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorValuedPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].col += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessorValuedPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].col += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -366,22 +391,19 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
 
         if (hc_ < hr_) {
 
-            for (size_type k = 0; k < numPartitions_; k++) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
 
-                    auto tmp = p->getPredecessorElements(j);
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
-
-                }
+                auto tmp = p->getPredecessorElements(j);
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
 
             }
 
@@ -399,28 +421,25 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessorPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -437,28 +456,25 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorValuedPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].row += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessorValuedPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].row += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -484,7 +500,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
 
@@ -590,7 +606,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -733,7 +749,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type elements;
 
@@ -876,7 +892,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 
         std::vector<elem_type> elements;
 
@@ -897,7 +913,7 @@ public:
 
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
 
         positions_type elements;
         size_type offset = 0;
@@ -933,7 +949,7 @@ public:
 
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type elements;
         size_type offset = 0;
@@ -969,7 +985,7 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1028,7 +1044,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
@@ -1047,7 +1063,7 @@ public:
         return new UnevenKrKcOrMiniTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -1090,23 +1106,21 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getFirstSuccessor(i);
-                    if (tmp != p->getNumCols()) {
-                        pos = offset + tmp;
-                    }
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getFirstSuccessor(i);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
                 }
 
             }
@@ -1125,32 +1139,125 @@ public:
 
     }
 
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = succs.size();
+                p->getSuccessorPositions(i, succs, ctx);
+
+                for (size_type l = first; l < succs.size(); l++) {
+                    succs[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getSuccessorPositions(pis.row, succs, ctx);
+            }
+
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext& ctx) const override {
+
+        if (hc_ < hr_) {
+
+            for (auto k : occupiedPartitions(j, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = preds.size();
+                p->getPredecessorPositions(j, preds, ctx);
+
+                for (size_type l = first; l < preds.size(); l++) {
+                    preds[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(0, j);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getPredecessorPositions(pis.col, preds, ctx);
+            }
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+
+        size_type pos = numCols_;
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                auto tmp = p->getFirstSuccessor(i, ctx);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                pos = p->getFirstSuccessor(pis.row, ctx);
+            }
+
+        }
+
+        return pos;
+
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -1167,27 +1274,233 @@ private:
     K2Tree<elem_type>** partitions_; // representations of the partitions / submatrices
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    size_type partitionShift_; // log2(partitionSize_) if partitionSize_ is a power of two
+    bool shiftRouting_; // whether indices are mapped to partitions with shifts and masks instead of divisions
+
+    // occupancy index: row (column) l of a vertical (horizontal) partitioning contains relation pairs in partition k
+    // iff occupancy_ relates l and k (empty if there is only one partition); fan-out queries only visit these partitions
+    // (after setNull() the index might contain some outdated pairs, which only lead to unnecessary visits)
+    KrKcTree<bool> occupancy_;
+
+    // partitions_[k] with its concrete type if it is a KrKcTree resp. a MiniK2Tree resp. a DenseK2Tree (0 otherwise),
+    // used to call the point queries of the partitions without virtual dispatch
+    std::vector<KrKcTree<elem_type>*> krKcPartitions_;
+    std::vector<MiniK2Tree<elem_type>*> miniPartitions_;
+    std::vector<DenseK2Tree<elem_type>*> densePartitions_;
 
     elem_type null_; // null element
 
 
+    /* helper method for typed access to the partitions */
+
+    void tagPartitions() {
+
+        krKcPartitions_.assign(numPartitions_, 0);
+        miniPartitions_.assign(numPartitions_, 0);
+        densePartitions_.assign(numPartitions_, 0);
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            krKcPartitions_[k] = dynamic_cast<KrKcTree<elem_type>*>(partitions_[k]);
+            miniPartitions_[k] = dynamic_cast<MiniK2Tree<elem_type>*>(partitions_[k]);
+            densePartitions_[k] = dynamic_cast<DenseK2Tree<elem_type>*>(partitions_[k]);
+
+        }
+
+    }
+
+    /* helper methods for creating the partitions */
+
+    // returns a representation of the nr x nc submatrix starting at (x, y) that contains the relation pairs pairs[l], ..., pairs[r - 1],
+    // chosen according to policy
+    K2Tree<elem_type>* createPartition(pairs_type& pairs, size_type l, size_type r, size_type x, size_type y, size_type nr, size_type nc, size_type mb, PartitionPolicy policy, const elem_type null) {
+
+        if (r - l <= mb) {
+            return new MiniK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y, null);
+        }
+
+        if (policy == PARTITIONS_BY_SIZE) {
+
+            size_type valueBits = 8 * sizeof(elem_type);
+            double miniBits = (r - l) * (8.0 * sizeof(std::pair<size_type, size_type>) + valueBits);
+            double denseBits = double(nr) * nc * valueBits;
+            double krKcBits = estimateKrKcBits(pairs, l, r, x, y, nr, nc);
+
+            if (denseBits < std::min(miniBits, krKcBits)) {
+                return new DenseK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y, nr, nc, null);
+            }
+            if (miniBits < krKcBits) {
+                return new MiniK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y, null);
+            }
+
+        }
+
+        return new KrKcTree<elem_type>(pairs, x, y, nr, nc, l, r, kr_, kc_, null);
+
+    }
+
+    // estimates the size (in bits) of a KrKcTree for the partition described by the arguments of createPartition()
+    // by counting the non-empty submatrices on every level
+    double estimateKrKcBits(const pairs_type& pairs, size_type l, size_type r, size_type x, size_type y, size_type nr, size_type nc) {
+
+        size_type h = std::max((size_type)1, std::max(logK(nr, kr_), logK(nc, kc_)));
+
+        // edge lengths of the submatrices on every level (level h consists of single cells)
+        std::vector<size_type> rowLen(h + 1, 1);
+        std::vector<size_type> colLen(h + 1, 1);
+        for (size_type lvl = h; lvl > 0; lvl--) {
+            rowLen[lvl - 1] = rowLen[lvl] * kr_;
+            colLen[lvl - 1] = colLen[lvl] * kc_;
+        }
+
+        // sort the relative positions in the order of a depth-first traversal of the tree,
+        // so that the pairs within the same submatrix are contiguous on every level
+        std::vector<std::pair<size_type, size_type>> pos;
+        pos.reserve(r - l);
+        for (size_type k = l; k < r; k++) {
+            pos.push_back(std::make_pair(pairs[k].row - x, pairs[k].col - y));
+        }
+        std::sort(pos.begin(), pos.end(), [&](const std::pair<size_type, size_type>& a, const std::pair<size_type, size_type>& b) {
+
+            for (size_type lvl = 1; lvl <= h; lvl++) {
+
+                auto ka = std::make_pair(a.first / rowLen[lvl], a.second / colLen[lvl]);
+                auto kb = std::make_pair(b.first / rowLen[lvl], b.second / colLen[lvl]);
+                if (ka != kb) {
+                    return ka < kb;
+                }
+
+            }
+
+            return false;
+
+        });
+
+        // numNodes[lvl] = number of non-empty submatrices on level lvl
+        std::vector<size_type> numNodes(h, pos.empty() ? 0 : 1);
+        for (size_type k = 1; k < pos.size(); k++) {
+
+            for (size_type lvl = 0; lvl < h; lvl++) {
+
+                if (pos[k - 1].first / rowLen[lvl] != pos[k].first / rowLen[lvl] || pos[k - 1].second / colLen[lvl] != pos[k].second / colLen[lvl]) {
+                    numNodes[lvl]++;
+                }
+
+            }
+
+        }
+
+        size_type valueBits = 8 * sizeof(elem_type);
+        double lenT = 0;
+        for (size_type lvl = 0; lvl + 1 < h; lvl++) {
+            lenT += numNodes[lvl] * kr_ * kc_;
+        }
+        double lenL = numNodes[h - 1] * kr_ * kc_ * valueBits;
+
+        return 1.25 * lenT + lenL; // 0.25 bits per bit of T for the rank data structure
+
+    }
+
+    /* helper method for setting the partition size */
+
+    // also prepares the mapping of indices to partitions with shifts and masks if partitionSize is a power of two
+    void setPartitionSize(size_type partitionSize) {
+
+        partitionSize_ = partitionSize;
+        shiftRouting_ = (partitionSize_ & (partitionSize_ - 1)) == 0;
+        partitionShift_ = shiftRouting_ ? logK(partitionSize_, 2) : 0;
+
+    }
+
+    /* helper methods for the occupancy index */
+
+    // builds occupancy_ from the (non-empty) partitions
+    void buildOccupancy() {
+
+        positions_type occupied;
+
+        if (hc_ != hr_) {
+
+            for (size_type k = 0; k < numPartitions_; k++) {
+
+                auto p = partitions_[k];
+                if (p != 0) {
+
+                    for (auto& pos : p->getAllPositions()) {
+                        occupied.push_back(std::make_pair((hc_ > hr_) ? pos.first : pos.second, k));
+                    }
+
+                }
+
+            }
+
+            std::sort(occupied.begin(), occupied.end());
+            occupied.erase(std::unique(occupied.begin(), occupied.end()), occupied.end());
+
+        }
+
+        occupancy_ = (hc_ > hr_) ? KrKcTree<bool>(occupied, kr_, kc_) : KrKcTree<bool>(occupied, kc_, kr_);
+
+    }
+
+    // returns the numbers of all partitions with relation pairs in row (column) l of a vertical (horizontal) partitioning (ascending)
+    std::vector<size_type> occupiedPartitions(size_type l) const {
+
+        std::vector<size_type> parts;
+
+        if (l < occupancy_.getNumRows()) {
+            parts = occupancy_.getSuccessorPositions(l);
+        }
+
+        return parts;
+
+    }
+
+    // same as occupiedPartitions(l), but the result is stored in (and returned from) the scratch memory of ctx
+    const std::vector<size_type>& occupiedPartitions(size_type l, QueryContext& ctx) const {
+
+        ctx.partitions.clear();
+
+        if (l < occupancy_.getNumRows()) {
+            occupancy_.getSuccessorPositions(l, ctx.partitions, ctx);
+        }
+
+        return ctx.partitions;
+
+    }
+
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+            return (hc_ > hr_) ? (j >> partitionShift_) : (i >> partitionShift_);
+        }
+
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
+
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+
+            size_type mask = partitionSize_ - 1;
+            return (hc_ > hr_) ? PartitionIndices(j >> partitionShift_, i, j & mask) : PartitionIndices(i >> partitionShift_, i & mask, j);
+
+        }
+
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
+
     }
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
         return ((pair.row - sp.firstRow) / widthRow) + (pair.col - sp.firstCol) / widthCol;
     }
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -1236,7 +1549,7 @@ private:
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
-class UnevenKrKcOrMiniTree<bool> : public virtual K2Tree<bool> {
+class UnevenKrKcOrMiniTree<bool> final : public virtual K2Tree<bool> {
 
 public:
     typedef bool elem_type;
@@ -1268,8 +1581,10 @@ public:
         for (size_type k = 0; k < other.numPartitions_; k++) {
             partitions_[k] = (other.partitions_[k] != 0) ? other.partitions_[k]->clone() : 0;
         }
-        partitionSize_ = other.partitionSize_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
+        tagPartitions();
 
     }
 
@@ -1296,8 +1611,10 @@ public:
         for (size_type k = 0; k < other.numPartitions_; k++) {
             partitions_[k] = (other.partitions_[k] != 0) ? other.partitions_[k]->clone() : 0;
         }
-        partitionSize_ = other.partitionSize_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
+        tagPartitions();
 
         return *this;
 
@@ -1306,7 +1623,15 @@ public:
     /**
      * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
      */
-    UnevenKrKcOrMiniTree(positions_type& pairs, const size_type kr, const size_type kc, const size_type mb) {
+    UnevenKrKcOrMiniTree(positions_type& pairs, const size_type kr, const size_type kc, const size_type mb)
+        : UnevenKrKcOrMiniTree(pairs, kr, kc, mb, PARTITIONS_BY_THRESHOLD) {
+        // nothing to do
+    }
+
+    /**
+     * List-of-pairs-based constructor that chooses the representation of the partitions according to policy
+     */
+    UnevenKrKcOrMiniTree(positions_type& pairs, const size_type kr, const size_type kc, const size_type mb, const PartitionPolicy policy) {
 
         null_ = false;
 
@@ -1328,7 +1653,7 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
             partitions_ = new K2Tree<elem_type>*[numPartitions_];
 
@@ -1337,17 +1662,13 @@ public:
             countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                if (intervals[i].second - intervals[i].first > mb) {
-                    partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_);
-                } else {
-                    partitions_[i] = new MiniK2Tree<elem_type>(pairs.begin() + intervals[i].first, pairs.begin() + intervals[i].second, 0, i * partitionSize_);
-                }
+                partitions_[i] = createPartition(pairs, intervals[i].first, intervals[i].second, 0, i * partitionSize_, numRows_, partitionSize_, mb, policy);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
             partitions_ = new K2Tree<elem_type>*[numPartitions_];
 
@@ -1356,11 +1677,7 @@ public:
             countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                if (intervals[j].second - intervals[j].first > mb) {
-                    partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_);
-                } else {
-                    partitions_[j] = new MiniK2Tree<elem_type>(pairs.begin() + intervals[j].first, pairs.begin() + intervals[j].second, j * partitionSize_, 0);
-                }
+                partitions_[j] = createPartition(pairs, intervals[j].first, intervals[j].second, j * partitionSize_, 0, partitionSize_, numCols_, mb, policy);
             }
 
         }
@@ -1378,6 +1695,9 @@ public:
         }
 #endif
 
+        tagPartitions();
+        buildOccupancy();
+
     }
 
     ~UnevenKrKcOrMiniTree() {
@@ -1391,69 +1711,73 @@ public:
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
 
-        return (p != 0) && p->areRelated(pis.row, pis.col);
+        if (krKcPartitions_[pis.partition] != 0) {
+            return krKcPartitions_[pis.partition]->KrKcTree<elem_type>::areRelated(pis.row, pis.col);
+        } else if (miniPartitions_[pis.partition] != 0) {
+            return miniPartitions_[pis.partition]->MiniK2Tree<elem_type>::areRelated(pis.row, pis.col);
+        } else if (densePartitions_[pis.partition] != 0) {
+            return densePartitions_[pis.partition]->DenseK2Tree<elem_type>::areRelated(pis.row, pis.col);
+        } else {
+            return false;
+        }
 
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessors(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessors(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -1470,28 +1794,25 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessors(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessors(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -1508,7 +1829,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -1651,7 +1972,7 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1710,7 +2031,7 @@ public:
 
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
@@ -1729,23 +2050,23 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -1758,15 +2079,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -1779,15 +2100,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -1800,15 +2121,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -1821,11 +2142,11 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsLink(i1, i2, j1, j2);
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
@@ -1834,7 +2155,7 @@ public:
         return new UnevenKrKcOrMiniTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -1877,23 +2198,21 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getFirstSuccessor(i);
-                    if (tmp != p->getNumCols()) {
-                        pos = offset + tmp;
-                    }
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getFirstSuccessor(i);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
                 }
 
             }
@@ -1912,6 +2231,99 @@ public:
 
     }
 
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = succs.size();
+                p->getSuccessorPositions(i, succs, ctx);
+
+                for (size_type l = first; l < succs.size(); l++) {
+                    succs[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getSuccessorPositions(pis.row, succs, ctx);
+            }
+
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext& ctx) const override {
+
+        if (hc_ < hr_) {
+
+            for (auto k : occupiedPartitions(j, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = preds.size();
+                p->getPredecessorPositions(j, preds, ctx);
+
+                for (size_type l = first; l < preds.size(); l++) {
+                    preds[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(0, j);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getPredecessorPositions(pis.col, preds, ctx);
+            }
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+
+        size_type pos = numCols_;
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                auto tmp = p->getFirstSuccessor(i, ctx);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                pos = p->getFirstSuccessor(pis.row, ctx);
+            }
+
+        }
+
+        return pos;
+
+    }
+
 
 
 private:
@@ -1925,27 +2337,231 @@ private:
     K2Tree<elem_type>** partitions_; // representations of the partitions / submatrices
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    size_type partitionShift_; // log2(partitionSize_) if partitionSize_ is a power of two
+    bool shiftRouting_; // whether indices are mapped to partitions with shifts and masks instead of divisions
+
+    // occupancy index: row (column) l of a vertical (horizontal) partitioning contains relation pairs in partition k
+    // iff occupancy_ relates l and k (empty if there is only one partition); fan-out queries only visit these partitions
+    // (after setNull() the index might contain some outdated pairs, which only lead to unnecessary visits)
+    KrKcTree<bool> occupancy_;
+
+    // partitions_[k] with its concrete type if it is a KrKcTree resp. a MiniK2Tree resp. a DenseK2Tree (0 otherwise),
+    // used to call the point queries of the partitions without virtual dispatch
+    std::vector<KrKcTree<elem_type>*> krKcPartitions_;
+    std::vector<MiniK2Tree<elem_type>*> miniPartitions_;
+    std::vector<DenseK2Tree<elem_type>*> densePartitions_;
 
     elem_type null_; // null element
 
 
+    /* helper method for typed access to the partitions */
+
+    void tagPartitions() {
+
+        krKcPartitions_.assign(numPartitions_, 0);
+        miniPartitions_.assign(numPartitions_, 0);
+        densePartitions_.assign(numPartitions_, 0);
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            krKcPartitions_[k] = dynamic_cast<KrKcTree<elem_type>*>(partitions_[k]);
+            miniPartitions_[k] = dynamic_cast<MiniK2Tree<elem_type>*>(partitions_[k]);
+            densePartitions_[k] = dynamic_cast<DenseK2Tree<elem_type>*>(partitions_[k]);
+
+        }
+
+    }
+
+    /* helper methods for creating the partitions */
+
+    // returns a representation of the nr x nc submatrix starting at (x, y) that contains the relation pairs pairs[l], ..., pairs[r - 1],
+    // chosen according to policy
+    K2Tree<elem_type>* createPartition(positions_type& pairs, size_type l, size_type r, size_type x, size_type y, size_type nr, size_type nc, size_type mb, PartitionPolicy policy) {
+
+        if (r - l <= mb) {
+            return new MiniK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y);
+        }
+
+        if (policy == PARTITIONS_BY_SIZE) {
+
+            double miniBits = (r - l) * 8.0 * sizeof(std::pair<size_type, size_type>);
+            double denseBits = double(nr) * nc;
+            double krKcBits = estimateKrKcBits(pairs, l, r, x, y, nr, nc);
+
+            if (denseBits < std::min(miniBits, krKcBits)) {
+                return new DenseK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y, nr, nc);
+            }
+            if (miniBits < krKcBits) {
+                return new MiniK2Tree<elem_type>(pairs.begin() + l, pairs.begin() + r, x, y);
+            }
+
+        }
+
+        return new KrKcTree<elem_type>(pairs, x, y, nr, nc, l, r, kr_, kc_);
+
+    }
+
+    // estimates the size (in bits) of a KrKcTree for the partition described by the arguments of createPartition()
+    // by counting the non-empty submatrices on every level
+    double estimateKrKcBits(const positions_type& pairs, size_type l, size_type r, size_type x, size_type y, size_type nr, size_type nc) {
+
+        size_type h = std::max((size_type)1, std::max(logK(nr, kr_), logK(nc, kc_)));
+
+        // edge lengths of the submatrices on every level (level h consists of single cells)
+        std::vector<size_type> rowLen(h + 1, 1);
+        std::vector<size_type> colLen(h + 1, 1);
+        for (size_type lvl = h; lvl > 0; lvl--) {
+            rowLen[lvl - 1] = rowLen[lvl] * kr_;
+            colLen[lvl - 1] = colLen[lvl] * kc_;
+        }
+
+        // sort the relative positions in the order of a depth-first traversal of the tree,
+        // so that the pairs within the same submatrix are contiguous on every level
+        std::vector<std::pair<size_type, size_type>> pos;
+        pos.reserve(r - l);
+        for (size_type k = l; k < r; k++) {
+            pos.push_back(std::make_pair(pairs[k].first - x, pairs[k].second - y));
+        }
+        std::sort(pos.begin(), pos.end(), [&](const std::pair<size_type, size_type>& a, const std::pair<size_type, size_type>& b) {
+
+            for (size_type lvl = 1; lvl <= h; lvl++) {
+
+                auto ka = std::make_pair(a.first / rowLen[lvl], a.second / colLen[lvl]);
+                auto kb = std::make_pair(b.first / rowLen[lvl], b.second / colLen[lvl]);
+                if (ka != kb) {
+                    return ka < kb;
+                }
+
+            }
+
+            return false;
+
+        });
+
+        // numNodes[lvl] = number of non-empty submatrices on level lvl
+        std::vector<size_type> numNodes(h, pos.empty() ? 0 : 1);
+        for (size_type k = 1; k < pos.size(); k++) {
+
+            for (size_type lvl = 0; lvl < h; lvl++) {
+
+                if (pos[k - 1].first / rowLen[lvl] != pos[k].first / rowLen[lvl] || pos[k - 1].second / colLen[lvl] != pos[k].second / colLen[lvl]) {
+                    numNodes[lvl]++;
+                }
+
+            }
+
+        }
+
+        double lenT = 0;
+        for (size_type lvl = 0; lvl + 1 < h; lvl++) {
+            lenT += numNodes[lvl] * kr_ * kc_;
+        }
+        double lenL = numNodes[h - 1] * kr_ * kc_;
+
+        return 1.25 * lenT + lenL; // 0.25 bits per bit of T for the rank data structure
+
+    }
+
+    /* helper method for setting the partition size */
+
+    // also prepares the mapping of indices to partitions with shifts and masks if partitionSize is a power of two
+    void setPartitionSize(size_type partitionSize) {
+
+        partitionSize_ = partitionSize;
+        shiftRouting_ = (partitionSize_ & (partitionSize_ - 1)) == 0;
+        partitionShift_ = shiftRouting_ ? logK(partitionSize_, 2) : 0;
+
+    }
+
+    /* helper methods for the occupancy index */
+
+    // builds occupancy_ from the (non-empty) partitions
+    void buildOccupancy() {
+
+        positions_type occupied;
+
+        if (hc_ != hr_) {
+
+            for (size_type k = 0; k < numPartitions_; k++) {
+
+                auto p = partitions_[k];
+                if (p != 0) {
+
+                    for (auto& pos : p->getAllPositions()) {
+                        occupied.push_back(std::make_pair((hc_ > hr_) ? pos.first : pos.second, k));
+                    }
+
+                }
+
+            }
+
+            std::sort(occupied.begin(), occupied.end());
+            occupied.erase(std::unique(occupied.begin(), occupied.end()), occupied.end());
+
+        }
+
+        occupancy_ = (hc_ > hr_) ? KrKcTree<bool>(occupied, kr_, kc_) : KrKcTree<bool>(occupied, kc_, kr_);
+
+    }
+
+    // returns the numbers of all partitions with relation pairs in row (column) l of a vertical (horizontal) partitioning (ascending)
+    std::vector<size_type> occupiedPartitions(size_type l) const {
+
+        std::vector<size_type> parts;
+
+        if (l < occupancy_.getNumRows()) {
+            parts = occupancy_.getSuccessorPositions(l);
+        }
+
+        return parts;
+
+    }
+
+    // same as occupiedPartitions(l), but the result is stored in (and returned from) the scratch memory of ctx
+    const std::vector<size_type>& occupiedPartitions(size_type l, QueryContext& ctx) const {
+
+        ctx.partitions.clear();
+
+        if (l < occupancy_.getNumRows()) {
+            occupancy_.getSuccessorPositions(l, ctx.partitions, ctx);
+        }
+
+        return ctx.partitions;
+
+    }
+
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+            return (hc_ > hr_) ? (j >> partitionShift_) : (i >> partitionShift_);
+        }
+
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
+
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+
+            size_type mask = partitionSize_ - 1;
+            return (hc_ > hr_) ? PartitionIndices(j >> partitionShift_, i, j & mask) : PartitionIndices(i >> partitionShift_, i & mask, j);
+
+        }
+
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
+
     }
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
         return ((pair.first - sp.firstRow) / widthRow) + (pair.second - sp.firstCol) / widthCol;
     }
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -22,6 +22,7 @@
 #ifndef K2TREES_STATICUNEVENRECTANGULARTREE_HPP
 #define K2TREES_STATICUNEVENRECTANGULARTREE_HPP
 
+#include <memory>
 #include <queue>
 
 #include "K2Tree.hpp"
@@ -38,9 +39,13 @@
  * The described relation matrix is rectangular with edge lengths of numRows and numCols,
  * where numRows (numCols) is the smallest power of kr (kc) that exceeds the row (column) numbers
  * of all relation pairs.
+ * Row (column) queries that span several partitions use a small occupancy index (a KrKcTree<bool>
+ * over rows (columns) and partitions) to only visit the partitions containing relation pairs in that row (column).
+ * The partitions are stored contiguously (cf. PartitionArena) and shared by copies of a tree
+ * until one of them is modified, i.e. copying and cloning take constant time.
  */
 template<typename E>
-class UnevenKrKcTree : public virtual K2Tree<E> {
+class UnevenKrKcTree final : public virtual K2Tree<E> {
 
 public:
     typedef E elem_type;
@@ -68,12 +73,11 @@ public:
         numCols_ = other.numCols_;
         null_ = other.null_;
 
-        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
-        for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
-        }
-        partitionSize_ = other.partitionSize_;
+        arena_ = other.arena_; // shared until one of the trees is modified (cf. setNull())
+        partitions_ = other.partitions_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
 
     }
 
@@ -92,16 +96,11 @@ public:
         numCols_ = other.numCols_;
         null_ = other.null_;
 
-        for (size_type k = 0; k < numPartitions_; k++) {
-            delete partitions_[k];
-        }
-        delete[] partitions_;
-        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
-        for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
-        }
-        partitionSize_ = other.partitionSize_;
+        arena_ = other.arena_; // shared until one of the trees is modified (cf. setNull())
+        partitions_ = other.partitions_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
 
         return *this;
 
@@ -126,39 +125,30 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(mat, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, null);
+                arena_->emplace(i, mat, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, null);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(mat, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, null);
+                arena_->emplace(j, mat, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, null);
             }
 
         }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-                delete partitions_[k];
-                partitions_[k] = 0;
-
-            }
-
-        }
-#endif
+        buildOccupancy();
 
     }
 
@@ -189,39 +179,30 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(lists, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, mode, null);
+                arena_->emplace(i, lists, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, mode, null);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(lists, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, mode, null);
+                arena_->emplace(j, lists, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, mode, null);
             }
 
         }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-                delete partitions_[k];
-                partitions_[k] = 0;
-
-            }
-
-        }
-#endif
+        buildOccupancy();
 
     }
 
@@ -250,127 +231,106 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
             std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
             countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_, null);
+                arena_->emplace(i, pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_, null);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
             std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
             countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_, null);
-            }
-
-        }
-
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
-
-                delete partitions_[k];
-                partitions_[k] = 0;
-
+                arena_->emplace(j, pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_, null);
             }
 
         }
-#endif
 
-    }
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-    ~UnevenKrKcTree() {
-
-        for (size_type k = 0; k < numPartitions_; k++) {
-            delete partitions_[k];
-        }
-        delete[] partitions_;
+        buildOccupancy();
 
     }
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
         auto p = partitions_[pis.partition];
 
-        return (p != 0) && p->isNotNull(pis.row, pis.col);
+        return (p != 0) && p->KrKcTree<elem_type>::isNotNull(pis.row, pis.col);
 
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
         auto p = partitions_[pis.partition];
 
-        return (p != 0) ? p->getElement(pis.row, pis.col) : null_;
+        return (p != 0) ? p->KrKcTree<elem_type>::getElement(pis.row, pis.col) : null_;
 
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
 
         if (hc_ > hr_) {
 
-            for (size_type k = 0; k < numPartitions_; k++) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorElements(i);
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
 
-                }
+                auto tmp = p->getSuccessorElements(i);
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
 
             }
 
@@ -388,28 +348,25 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessorPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -426,28 +383,25 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorValuedPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].col += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessorValuedPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].col += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -473,22 +427,19 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
 
         if (hc_ < hr_) {
 
-            for (size_type k = 0; k < numPartitions_; k++) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
 
-                    auto tmp = p->getPredecessorElements(j);
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
-
-                }
+                auto tmp = p->getPredecessorElements(j);
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
 
             }
 
@@ -506,28 +457,25 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessorPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -544,28 +492,25 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorValuedPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].row += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessorValuedPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].row += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -591,7 +536,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
 
@@ -697,7 +642,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -840,7 +785,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type elements;
 
@@ -983,7 +928,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 
         std::vector<elem_type> elements;
 
@@ -1004,7 +949,7 @@ public:
 
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
 
         positions_type elements;
         size_type offset = 0;
@@ -1040,7 +985,7 @@ public:
 
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type elements;
         size_type offset = 0;
@@ -1076,7 +1021,7 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1135,7 +1080,7 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
@@ -1154,7 +1099,7 @@ public:
         return new UnevenKrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -1189,31 +1134,31 @@ public:
     void setNull(size_type i, size_type j) override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
 
-        if (p != 0) {
-            p->setNull(pis.row, pis.col);
+        if (partitions_[pis.partition] != 0) {
+
+            detachArena();
+            partitions_[pis.partition]->setNull(pis.row, pis.col);
+
         }
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getFirstSuccessor(i);
-                    if (tmp != p->getNumCols()) {
-                        pos = offset + tmp;
-                    }
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getFirstSuccessor(i);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
                 }
 
             }
@@ -1232,36 +1177,165 @@ public:
 
     }
 
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = succs.size();
+                p->getSuccessorPositions(i, succs, ctx);
+
+                for (size_type l = first; l < succs.size(); l++) {
+                    succs[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getSuccessorPositions(pis.row, succs, ctx);
+            }
+
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext& ctx) const override {
+
+        if (hc_ < hr_) {
+
+            for (auto k : occupiedPartitions(j, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = preds.size();
+                p->getPredecessorPositions(j, preds, ctx);
+
+                for (size_type l = first; l < preds.size(); l++) {
+                    preds[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(0, j);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getPredecessorPositions(pis.col, preds, ctx);
+            }
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+
+        size_type pos = numCols_;
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                auto tmp = p->getFirstSuccessor(i, ctx);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                pos = p->getFirstSuccessor(pis.row, ctx);
+            }
+
+        }
+
+        return pos;
+
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
 
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    // (the rows are distributed among the partitions, i.e. only their partitions are queried in a horizontal partitioning)
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
+
 
 private:
     size_type hr_; // row height of the K2Tree
@@ -1271,30 +1345,138 @@ private:
     size_type numRows_; // number of rows in the represented relation matrix
     size_type numCols_; // number of columns in the represented relation matrix
 
-    KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices
+    typedef PartitionArena<KrKcTree<elem_type>> arena_type;
+
+    std::shared_ptr<arena_type> arena_; // contiguous storage of the partitions, shared by copies of the tree until one of them is modified
+    KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices (offset table of arena_)
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    size_type partitionShift_; // log2(partitionSize_) if partitionSize_ is a power of two
+    bool shiftRouting_; // whether indices are mapped to partitions with shifts and masks instead of divisions
+
+    // occupancy index: row (column) l of a vertical (horizontal) partitioning contains relation pairs in partition k
+    // iff occupancy_ relates l and k (empty if there is only one partition); fan-out queries only visit these partitions
+    // (after setNull() the index might contain some outdated pairs, which only lead to unnecessary visits);
+    // never modified after construction and thus shared by all copies
+    std::shared_ptr<const KrKcTree<bool>> occupancy_;
 
     elem_type null_; // null element
 
 
+    /* helper method for setting the partition size */
+
+    // also prepares the mapping of indices to partitions with shifts and masks if partitionSize is a power of two
+    void setPartitionSize(size_type partitionSize) {
+
+        partitionSize_ = partitionSize;
+        shiftRouting_ = (partitionSize_ & (partitionSize_ - 1)) == 0;
+        partitionShift_ = shiftRouting_ ? logK(partitionSize_, 2) : 0;
+
+    }
+
+    /* helper method for modifying the partitions */
+
+    // gives this tree its own copy of the partitions if they are shared with other trees (copy-on-write)
+    void detachArena() {
+
+        if (arena_.use_count() > 1) {
+
+            arena_ = std::make_shared<arena_type>(*arena_);
+            partitions_ = arena_->partitions.data();
+
+        }
+
+    }
+
+    /* helper methods for the occupancy index */
+
+    // builds occupancy_ from the (non-empty) partitions
+    void buildOccupancy() {
+
+        positions_type occupied;
+
+        if (hc_ != hr_) {
+
+            for (size_type k = 0; k < numPartitions_; k++) {
+
+                auto p = partitions_[k];
+                if (p != 0) {
+
+                    for (auto& pos : p->getAllPositions()) {
+                        occupied.push_back(std::make_pair((hc_ > hr_) ? pos.first : pos.second, k));
+                    }
+
+                }
+
+            }
+
+            std::sort(occupied.begin(), occupied.end());
+            occupied.erase(std::unique(occupied.begin(), occupied.end()), occupied.end());
+
+        }
+
+        occupancy_ = std::make_shared<KrKcTree<bool>>(occupied, (hc_ > hr_) ? kr_ : kc_, (hc_ > hr_) ? kc_ : kr_);
+
+    }
+
+    // returns the numbers of all partitions with relation pairs in row (column) l of a vertical (horizontal) partitioning (ascending)
+    std::vector<size_type> occupiedPartitions(size_type l) const {
+
+        std::vector<size_type> parts;
+
+        if (l < occupancy_->getNumRows()) {
+            parts = occupancy_->getSuccessorPositions(l);
+        }
+
+        return parts;
+
+    }
+
+    // same as occupiedPartitions(l), but the result is stored in (and returned from) the scratch memory of ctx
+    const std::vector<size_type>& occupiedPartitions(size_type l, QueryContext& ctx) const {
+
+        ctx.partitions.clear();
+
+        if (l < occupancy_->getNumRows()) {
+            occupancy_->getSuccessorPositions(l, ctx.partitions, ctx);
+        }
+
+        return ctx.partitions;
+
+    }
+
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+            return (hc_ > hr_) ? (j >> partitionShift_) : (i >> partitionShift_);
+        }
+
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
+
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+
+            size_type mask = partitionSize_ - 1;
+            return (hc_ > hr_) ? PartitionIndices(j >> partitionShift_, i, j & mask) : PartitionIndices(i >> partitionShift_, i & mask, j);
+
+        }
+
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
+
     }
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
         return ((pair.row - sp.firstRow) / widthRow) + (pair.col - sp.firstCol) / widthCol;
     }
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -1333,6 +1515,57 @@ private:
 
     }
 
+    /* getSuccessorPositionsBatch(), expandRows() */
+
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
+
+        if (hc_ > hr_) {
+
+            // every partition covers all rows, but only hand over the rows with relation pairs in the respective partition
+            size_type cut = std::lower_bound(rows.begin() + first, rows.begin() + last, occupancy_->getNumRows()) - rows.begin();
+            std::vector<std::pair<size_type, size_type>> occupied; // (partition, row)
+            occupancy_->getSuccessorPositionsBatch(rows, first, cut, [&](size_type i, size_type k) { occupied.push_back(std::make_pair(k, i)); });
+            std::sort(occupied.begin(), occupied.end());
+
+            for (size_type t = 0; t < occupied.size();) {
+
+                size_type k = occupied[t].first;
+                size_type offset = k * partitionSize_;
+
+                std::vector<size_type> sub;
+                for (; (t < occupied.size()) && (occupied[t].first == k); t++) {
+                    sub.push_back(occupied[t].second);
+                }
+
+                partitions_[k]->getSuccessorPositionsBatch(sub, 0, sub.size(), [&](size_type i, size_type j) { func(i, j + offset); });
+
+            }
+
+        } else {
+
+            // the (sorted) rows of every partition form a contiguous run
+            for (size_type t = first; t < last;) {
+
+                size_type k = rows[t] / partitionSize_;
+                size_type offset = k * partitionSize_;
+
+                std::vector<size_type> sub;
+                for (; (t < last) && (rows[t] / partitionSize_ == k); t++) {
+                    sub.push_back(rows[t] - offset);
+                }
+
+                auto p = partitions_[k];
+                if (p != 0) {
+                    p->getSuccessorPositionsBatch(sub, [&](size_type i, size_type j) { func(i + offset, j); });
+                }
+
+            }
+
+        }
+
+    }
+
 };
 
 
@@ -1343,7 +1576,7 @@ private:
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
-class UnevenKrKcTree<bool> : public virtual K2Tree<bool> {
+class UnevenKrKcTree<bool> final : public virtual K2Tree<bool> {
 
 public:
     typedef bool elem_type;
@@ -1371,12 +1604,11 @@ public:
         numCols_ = other.numCols_;
         null_ = other.null_;
 
-        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
-        for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
-        }
-        partitionSize_ = other.partitionSize_;
+        arena_ = other.arena_; // shared until one of the trees is modified (cf. setNull())
+        partitions_ = other.partitions_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
 
     }
 
@@ -1395,16 +1627,11 @@ public:
         numCols_ = other.numCols_;
         null_ = other.null_;
 
-        for (size_type k = 0; k < numPartitions_; k++) {
-            delete partitions_[k];
-        }
-        delete[] partitions_;
-        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
-        for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
-        }
-        partitionSize_ = other.partitionSize_;
+        arena_ = other.arena_; // shared until one of the trees is modified (cf. setNull())
+        partitions_ = other.partitions_;
+        setPartitionSize(other.partitionSize_);
         numPartitions_ = other.numPartitions_;
+        occupancy_ = other.occupancy_;
 
         return *this;
 
@@ -1429,39 +1656,30 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(mat, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_);
+                arena_->emplace(i, mat, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(mat, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_);
+                arena_->emplace(j, mat, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_);
             }
 
         }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-                delete partitions_[k];
-                partitions_[k] = 0;
-
-            }
-
-        }
-#endif
+        buildOccupancy();
 
     }
 
@@ -1492,39 +1710,30 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(lists, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, mode);
+                arena_->emplace(i, lists, 0, i * partitionSize_, numRows_, partitionSize_, kr_, kc_, mode);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(lists, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, mode);
+                arena_->emplace(j, lists, j * partitionSize_, 0, partitionSize_, numCols_, kr_, kc_, mode);
             }
 
         }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
-
-                delete partitions_[k];
-                partitions_[k] = 0;
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-            }
-
-        }
-#endif
+        buildOccupancy();
 
     }
 
@@ -1553,124 +1762,103 @@ public:
 
         if (hc_ > hr_) {
 
-            partitionSize_ = size_type(pow(kc_, hr_));
+            setPartitionSize(size_type(pow(kc_, hr_)));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
             std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
             countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
 
             for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_);
+                arena_->emplace(i, pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_);
             }
 
 
         } else {
 
-            partitionSize_ = size_type(pow(kr_, hc_));
+            setPartitionSize(size_type(pow(kr_, hc_)));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+            arena_ = std::make_shared<arena_type>(numPartitions_);
 
             Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
             std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
             countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
 
             for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_);
-            }
-
-        }
-
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
-
-            if (partitions_[k]->getNumRows() == 0) {
-
-                delete partitions_[k];
-                partitions_[k] = 0;
-
+                arena_->emplace(j, pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_);
             }
 
         }
-#endif
 
-    }
+        partitions_ = arena_->partitions.data(); // empty partitions are not stored (0)
 
-    ~UnevenKrKcTree() {
-
-        for (size_type k = 0; k < numPartitions_; k++) {
-            delete partitions_[k];
-        }
-        delete[] partitions_;
+        buildOccupancy();
 
     }
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
         auto p = partitions_[pis.partition];
 
-        return (p != 0) && p->areRelated(pis.row, pis.col);
+        return (p != 0) && p->KrKcTree<elem_type>::areRelated(pis.row, pis.col);
 
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessors(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getSuccessors(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                succs.reserve(succs.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+
             }
 
         } else {
@@ -1687,28 +1875,25 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(j)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessors(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getPredecessors(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += offset;
                 }
 
+                preds.reserve(preds.size() + tmp.size());
+                std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+
             }
 
         } else {
@@ -1725,7 +1910,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -1868,7 +2053,7 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1927,7 +2112,7 @@ public:
 
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
@@ -1946,23 +2131,23 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -1975,15 +2160,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -1996,15 +2181,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2017,15 +2202,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -2038,11 +2223,11 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsLink(i1, i2, j1, j2);
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
@@ -2051,7 +2236,7 @@ public:
         return new UnevenKrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -2086,31 +2271,31 @@ public:
     void setNull(size_type i, size_type j) override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
 
-        if (p != 0) {
-            p->setNull(pis.row, pis.col);
+        if (partitions_[pis.partition] != 0) {
+
+            detachArena();
+            partitions_[pis.partition]->setNull(pis.row, pis.col);
+
         }
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
+            for (auto k : occupiedPartitions(i)) {
 
                 auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getFirstSuccessor(i);
-                    if (tmp != p->getNumCols()) {
-                        pos = offset + tmp;
-                    }
+                size_type offset = k * partitionSize_;
 
+                auto tmp = p->getFirstSuccessor(i);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
                 }
 
             }
@@ -2129,6 +2314,135 @@ public:
 
     }
 
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs, QueryContext& ctx) const override {
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = succs.size();
+                p->getSuccessorPositions(i, succs, ctx);
+
+                for (size_type l = first; l < succs.size(); l++) {
+                    succs[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getSuccessorPositions(pis.row, succs, ctx);
+            }
+
+        }
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds, QueryContext& ctx) const override {
+
+        if (hc_ < hr_) {
+
+            for (auto k : occupiedPartitions(j, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                size_type first = preds.size();
+                p->getPredecessorPositions(j, preds, ctx);
+
+                for (size_type l = first; l < preds.size(); l++) {
+                    preds[l] += offset;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(0, j);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                p->getPredecessorPositions(pis.col, preds, ctx);
+            }
+
+        }
+
+    }
+
+    size_type getFirstSuccessor(size_type i, QueryContext& ctx) const override {
+
+        size_type pos = numCols_;
+
+        if (hc_ > hr_) {
+
+            for (auto k : occupiedPartitions(i, ctx)) {
+
+                auto p = partitions_[k];
+                size_type offset = k * partitionSize_;
+
+                auto tmp = p->getFirstSuccessor(i, ctx);
+                if (tmp != p->getNumCols()) {
+                    pos = offset + tmp;
+                    break;
+                }
+
+            }
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partitions_[pis.partition];
+            if (p != 0) {
+                pos = p->getFirstSuccessor(pis.row, ctx);
+            }
+
+        }
+
+        return pos;
+
+    }
+
+
+    /*
+     * Batched queries (not part of the K2Tree interface)
+     */
+
+    // calls func(i, j) for every pair (i,j) in R with i in rows (in no particular order); the rows are sorted first,
+    // so that the submatrices shared by several rows are descended into only once
+    // (the rows are distributed among the partitions, i.e. only their partitions are queried in a horizontal partitioning)
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, Func func) const {
+
+        std::vector<size_type> sorted(rows);
+        std::sort(sorted.begin(), sorted.end());
+
+        successorsBatchInit(sorted, 0, sorted.size(), func);
+
+    }
+
+    // like getSuccessorPositionsBatch(rows, func), but only for the rows rows[first], ..., rows[last - 1],
+    // which have to be sorted ascending already
+    template<typename Func>
+    void getSuccessorPositionsBatch(const std::vector<size_type>& rows, size_type first, size_type last, Func func) const {
+        successorsBatchInit(rows, first, last, func);
+    }
+
+
+
+protected:
+    // batched version for breadthFirstSearch() (cf. getSuccessorPositionsBatch())
+    void expandRows(const std::vector<size_type>& rows, size_type first, size_type last, std::vector<size_type>& succs) const override {
+
+        auto func = [&](size_type, size_type j) { succs.push_back(j); };
+        successorsBatchInit(rows, first, last, func);
+
+    }
+
 
 
 private:
@@ -2139,30 +2453,138 @@ private:
     size_type numRows_; // number of rows in the represented relation matrix
     size_type numCols_; // number of columns in the represented relation matrix
 
-    KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices
+    typedef PartitionArena<KrKcTree<elem_type>> arena_type;
+
+    std::shared_ptr<arena_type> arena_; // contiguous storage of the partitions, shared by copies of the tree until one of them is modified
+    KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices (offset table of arena_)
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    size_type partitionShift_; // log2(partitionSize_) if partitionSize_ is a power of two
+    bool shiftRouting_; // whether indices are mapped to partitions with shifts and masks instead of divisions
+
+    // occupancy index: row (column) l of a vertical (horizontal) partitioning contains relation pairs in partition k
+    // iff occupancy_ relates l and k (empty if there is only one partition); fan-out queries only visit these partitions
+    // (after setNull() the index might contain some outdated pairs, which only lead to unnecessary visits);
+    // never modified after construction and thus shared by all copies
+    std::shared_ptr<const KrKcTree<bool>> occupancy_;
 
     elem_type null_; // null element
 
 
+    /* helper method for setting the partition size */
+
+    // also prepares the mapping of indices to partitions with shifts and masks if partitionSize is a power of two
+    void setPartitionSize(size_type partitionSize) {
+
+        partitionSize_ = partitionSize;
+        shiftRouting_ = (partitionSize_ & (partitionSize_ - 1)) == 0;
+        partitionShift_ = shiftRouting_ ? logK(partitionSize_, 2) : 0;
+
+    }
+
+    /* helper method for modifying the partitions */
+
+    // gives this tree its own copy of the partitions if they are shared with other trees (copy-on-write)
+    void detachArena() {
+
+        if (arena_.use_count() > 1) {
+
+            arena_ = std::make_shared<arena_type>(*arena_);
+            partitions_ = arena_->partitions.data();
+
+        }
+
+    }
+
+    /* helper methods for the occupancy index */
+
+    // builds occupancy_ from the (non-empty) partitions
+    void buildOccupancy() {
+
+        positions_type occupied;
+
+        if (hc_ != hr_) {
+
+            for (size_type k = 0; k < numPartitions_; k++) {
+
+                auto p = partitions_[k];
+                if (p != 0) {
+
+                    for (auto& pos : p->getAllPositions()) {
+                        occupied.push_back(std::make_pair((hc_ > hr_) ? pos.first : pos.second, k));
+                    }
+
+                }
+
+            }
+
+            std::sort(occupied.begin(), occupied.end());
+            occupied.erase(std::unique(occupied.begin(), occupied.end()), occupied.end());
+
+        }
+
+        occupancy_ = std::make_shared<KrKcTree<bool>>(occupied, (hc_ > hr_) ? kr_ : kc_, (hc_ > hr_) ? kc_ : kr_);
+
+    }
+
+    // returns the numbers of all partitions with relation pairs in row (column) l of a vertical (horizontal) partitioning (ascending)
+    std::vector<size_type> occupiedPartitions(size_type l) const {
+
+        std::vector<size_type> parts;
+
+        if (l < occupancy_->getNumRows()) {
+            parts = occupancy_->getSuccessorPositions(l);
+        }
+
+        return parts;
+
+    }
+
+    // same as occupiedPartitions(l), but the result is stored in (and returned from) the scratch memory of ctx
+    const std::vector<size_type>& occupiedPartitions(size_type l, QueryContext& ctx) const {
+
+        ctx.partitions.clear();
+
+        if (l < occupancy_->getNumRows()) {
+            occupancy_->getSuccessorPositions(l, ctx.partitions, ctx);
+        }
+
+        return ctx.partitions;
+
+    }
+
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+            return (hc_ > hr_) ? (j >> partitionShift_) : (i >> partitionShift_);
+        }
+
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
+
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
+
+        if (shiftRouting_) {
+
+            size_type mask = partitionSize_ - 1;
+            return (hc_ > hr_) ? PartitionIndices(j >> partitionShift_, i, j & mask) : PartitionIndices(i >> partitionShift_, i & mask, j);
+
+        }
+
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
+
     }
 
     /* helper methods for inplace construction from single list of pairs */
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) const {
         return ((pair.first - sp.firstRow) / widthRow) + (pair.second - sp.firstCol) / widthCol;
     }
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) const {
 
         std::vector<size_type> counts(sup);
 
@@ -2201,6 +2623,57 @@ private:
 
     }
 
+    /* getSuccessorPositionsBatch(), expandRows() */
+
+    template<typename Func>
+    void successorsBatchInit(const std::vector<size_type>& rows, size_type first, size_type last, Func& func) const {
+
+        if (hc_ > hr_) {
+
+            // every partition covers all rows, but only hand over the rows with relation pairs in the respective partition
+            size_type cut = std::lower_bound(rows.begin() + first, rows.begin() + last, occupancy_->getNumRows()) - rows.begin();
+            std::vector<std::pair<size_type, size_type>> occupied; // (partition, row)
+            occupancy_->getSuccessorPositionsBatch(rows, first, cut, [&](size_type i, size_type k) { occupied.push_back(std::make_pair(k, i)); });
+            std::sort(occupied.begin(), occupied.end());
+
+            for (size_type t = 0; t < occupied.size();) {
+
+                size_type k = occupied[t].first;
+                size_type offset = k * partitionSize_;
+
+                std::vector<size_type> sub;
+                for (; (t < occupied.size()) && (occupied[t].first == k); t++) {
+                    sub.push_back(occupied[t].second);
+                }
+
+                partitions_[k]->getSuccessorPositionsBatch(sub, 0, sub.size(), [&](size_type i, size_type j) { func(i, j + offset); });
+
+            }
+
+        } else {
+
+            // the (sorted) rows of every partition form a contiguous run
+            for (size_type t = first; t < last;) {
+
+                size_type k = rows[t] / partitionSize_;
+                size_type offset = k * partitionSize_;
+
+                std::vector<size_type> sub;
+                for (; (t < last) && (rows[t] / partitionSize_ == k); t++) {
+                    sub.push_back(rows[t] - offset);
+                }
+
+                auto p = partitions_[k];
+                if (p != 0) {
+                    p->getSuccessorPositionsBatch(sub, [&](size_type i, size_type j) { func(i + offset, j); });
+                }
+
+            }
+
+        }
+
+    }
+
 };
 
 #endif //K2TREES_STATICUNEVENRECTANGULARTREE_HPP
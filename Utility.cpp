@@ -44,6 +44,27 @@ void printRanks(const rank_type& r) {
 
 }
 
+bool isInResult(SetOperation op, bool inFirst, bool inSecond) {
+
+    switch (op) {
+        case SET_UNION: return inFirst || inSecond;
+        case SET_INTERSECTION: return inFirst && inSecond;
+        case SET_DIFFERENCE: return inFirst && !inSecond;
+        default: return inFirst != inSecond;
+    }
+
+}
+
+bool mayBeInResult(SetOperation op, bool inFirst, bool inSecond) {
+
+    switch (op) {
+        case SET_INTERSECTION: return inFirst && inSecond;
+        case SET_DIFFERENCE: return inFirst;
+        default: return inFirst || inSecond;
+    }
+
+}
+
 
 
 
@@ -24,8 +24,15 @@
 
 #include <algorithm>
 #include <cmath>
+#include <type_traits>
 #include <vector>
 
+#if defined(__AVX__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
 #include <sdsl/rank_support_v.hpp>
 
 typedef unsigned long size_type;
@@ -94,6 +101,58 @@ struct PartitionIndices {
 };
 
 
+/**
+ * Contiguous storage of the partitions of K2Tree-implementations such as UnevenKrKcTree.
+ *
+ * All non-empty partitions are kept in one vector (i.e. one allocation for all partition objects),
+ * partitions[k] is the address of partition k in trees or 0 if it is empty.
+ * The capacity of trees is reserved upfront, so these addresses never change.
+ */
+template<typename T>
+struct PartitionArena {
+
+    std::vector<T> trees; // non-empty partitions in ascending order
+    std::vector<T*> partitions; // offset table: partition number -> representation in trees (0 if empty)
+
+    PartitionArena(size_type numPartitions) {
+
+        trees.reserve(numPartitions);
+        partitions.assign(numPartitions, 0);
+
+    }
+
+    PartitionArena(const PartitionArena& other) {
+
+        trees.reserve(other.trees.capacity());
+        trees = other.trees;
+        partitions.assign(other.partitions.size(), 0);
+        for (size_type k = 0; k < partitions.size(); k++) {
+            if (other.partitions[k] != 0) {
+                partitions[k] = trees.data() + (other.partitions[k] - other.trees.data());
+            }
+        }
+
+    }
+
+    PartitionArena& operator=(const PartitionArena& other) = delete;
+
+    // constructs partition k from args, but only keeps it if it is not empty (i.e. has at least one row);
+    // partitions have to be added in ascending order
+    template<typename... Args>
+    void emplace(size_type k, Args&&... args) {
+
+        trees.emplace_back(std::forward<Args>(args)...);
+
+        if (trees.back().getNumRows() == 0) {
+            trees.pop_back();
+        } else {
+            partitions[k] = &trees.back();
+        }
+
+    }
+
+};
+
 /**
  * Parameters handed over in iterative versions of getting all positions in a row.
  */
@@ -136,15 +195,319 @@ struct ExtendedSubrowInfo {
 
 };
 
+/**
+ * Parameters handed over in traversals of whole submatrices.
+ */
+struct SubmatrixInfo {
+
+    size_type dp; // row offset
+    size_type dq; // column offset
+    size_type z; // index in (conceptual concatenation of) T and L
+
+    SubmatrixInfo(size_type dpp, size_type dqq, size_type zz) {
+
+        dp = dpp;
+        dq = dqq;
+        z = zz;
+
+    }
+
+};
+
+/**
+ * Path from the root of a RowTree to the element found by the last successor / predecessor search
+ * (cf. RowTree::nextGEQ() and RowTree::prevLEQ()), the next search on the same RowTree starts from there.
+ */
+struct RowTreeCursor {
+
+    std::vector<size_type> n; // length of the subrows of the children of the node on every level of the path
+    std::vector<size_type> dq; // relative column number of the node on every level of the path
+    std::vector<size_type> z; // index of the first child of the node on every level of the path
+    size_type level; // level of the last node on the path
+
+    RowTreeCursor() {
+        level = 0;
+    }
+
+};
+
+/**
+ * Reusable scratch memory for the row and column enumerations, i.e. the query variants taking a QueryContext
+ * (getSuccessorPositions(), getPredecessorPositions(), getFirstSuccessor() and getFirstPredecessorIn() of K2Tree,
+ * getAllPositions() of RowTree); all other queries (ranges, single elements, batches, ...) still allocate internally.
+ * The buffers only grow, so repeated queries with the same context do not allocate once they are large enough;
+ * a context must not be shared by concurrent queries, every thread should use its own.
+ */
+struct QueryContext {
+
+    std::vector<SubrowInfo> frontier; // nodes of the current level in level-wise descents
+    std::vector<SubrowInfo> nextFrontier; // nodes of the next level in level-wise descents
+    std::vector<ExtendedSubrowInfo> stack; // path of depth-first descents
+    std::vector<size_type> partitions; // partitions visited by row (column) queries of partitioned trees
+
+};
+
+/**
+ * Parameters handed over in best-first (top-k) versions of range queries.
+ */
+template<typename T>
+struct RangeCandidate {
+
+    T bound; // maximum value in the subtree (actual value for leaves)
+    size_type nr; // number of rows (on this level)
+    size_type nc; // number of columns (on this level)
+    size_type p1; // first relative row number of the range (on this level)
+    size_type p2; // last relative row number of the range (on this level)
+    size_type q1; // first relative column number of the range (on this level)
+    size_type q2; // last relative column number of the range (on this level)
+    size_type dp; // row offset
+    size_type dq; // column offset
+    size_type z; // index in (conceptual concatenation of) T and L
+
+    RangeCandidate(T b, size_type nrr, size_type ncc, size_type pp1, size_type pp2, size_type qq1, size_type qq2, size_type dpp, size_type dqq, size_type zz) {
+
+        bound = b;
+        nr = nrr;
+        nc = ncc;
+        p1 = pp1;
+        p2 = pp2;
+        q1 = qq1;
+        q2 = qq2;
+        dp = dpp;
+        dq = dqq;
+        z = zz;
+
+    }
+
+    bool operator<(const RangeCandidate& other) const {
+        return bound < other.bound;
+    }
+
+};
+
+/**
+ * Set operations on two relations (cf. unite(), intersect(), subtract() and symmetricDifference() of BasicK2Tree and KrKcTree).
+ */
+enum SetOperation {
+    SET_UNION, // pairs in at least one of the relations
+    SET_INTERSECTION, // pairs in both relations
+    SET_DIFFERENCE, // pairs in the first, but not in the second relation
+    SET_SYMMETRIC_DIFFERENCE // pairs in exactly one of the relations
+};
+
 // helper method for computation of log_k(n)
 size_type logK(const size_type n, const size_type k);
 
+// helper method for computation of log_2(k) for a power of two k (usable in constant expressions)
+constexpr size_type log2Pow2(const size_type k) {
+    return (k <= 1) ? 0 : 1 + log2Pow2(k >> 1);
+}
+
 // helper method for checking whether all elements of a vector have a certain value
 template<typename T>
 bool isAll(const std::vector<T>& v, const T val) {
     return std::all_of(v.begin(), v.end(), [&val](const T& elem) {return val == elem;});
 }
 
+// helper methods for scanning len consecutive values for non-null entries: calls func(i) for every i < len
+// with values[i] != null (ascending); values of integral types are compared 16 (with AVX2: 32) bytes at a time
+// and float / double values 4 resp. 2 (with AVX: 8 resp. 4) at a time, matching lanes are extracted from the movemask
+template<typename T, typename Func>
+typename std::enable_if<!std::is_integral<T>::value>::type forEachNonNull(const T* values, size_type len, const T& null, Func func) {
+
+    for (size_type i = 0; i < len; i++) {
+        if (values[i] != null) {
+            func(i);
+        }
+    }
+
+}
+
+template<typename T, typename Func>
+typename std::enable_if<std::is_integral<T>::value>::type forEachNonNull(const T* values, size_type len, const T& null, Func func) {
+
+    size_type i = 0;
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    // a lane differs from null iff at least one of its bytes does
+    const unsigned laneMask = (1u << sizeof(T)) - 1;
+    T nulls[32 / sizeof(T)];
+    std::fill(nulls, nulls + 32 / sizeof(T), null);
+#endif
+
+#ifdef __AVX2__
+    const __m256i nulls256 = _mm256_loadu_si256((const __m256i*) nulls);
+    for (; i + 32 / sizeof(T) <= len; i += 32 / sizeof(T)) {
+
+        __m256i v = _mm256_loadu_si256((const __m256i*) (values + i));
+        unsigned mask = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nulls256));
+
+        while (mask != 0) {
+
+            unsigned lane = __builtin_ctz(mask) / sizeof(T);
+            func(i + lane);
+            mask &= ~(laneMask << (lane * sizeof(T)));
+
+        }
+
+    }
+#endif
+
+#ifdef __SSE4_1__
+    const __m128i nulls128 = _mm_loadu_si128((const __m128i*) nulls);
+    for (; i + 16 / sizeof(T) <= len; i += 16 / sizeof(T)) {
+
+        __m128i v = _mm_loadu_si128((const __m128i*) (values + i));
+        unsigned mask = ~(unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, nulls128)) & 0xFFFF;
+
+        while (mask != 0) {
+
+            unsigned lane = __builtin_ctz(mask) / sizeof(T);
+            func(i + lane);
+            mask &= ~(laneMask << (lane * sizeof(T)));
+
+        }
+
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (values[i] != null) {
+            func(i);
+        }
+    }
+
+}
+
+template<typename Func>
+void forEachNonNull(const float* values, size_type len, const float& null, Func func) {
+
+    size_type i = 0;
+
+#ifdef __AVX__
+    const __m256 nulls256 = _mm256_set1_ps(null);
+    for (; i + 8 <= len; i += 8) {
+
+        // unordered comparison, i.e. NaN differs from everything (like operator!=)
+        unsigned mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + i), nulls256, _CMP_NEQ_UQ));
+
+        while (mask != 0) {
+
+            func(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+
+        }
+
+    }
+#endif
+
+#ifdef __SSE4_1__
+    const __m128 nulls128 = _mm_set1_ps(null);
+    for (; i + 4 <= len; i += 4) {
+
+        // _mm_cmpneq_ps is an unordered comparison as well
+        unsigned mask = _mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(values + i), nulls128));
+
+        while (mask != 0) {
+
+            func(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+
+        }
+
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (values[i] != null) {
+            func(i);
+        }
+    }
+
+}
+
+template<typename Func>
+void forEachNonNull(const double* values, size_type len, const double& null, Func func) {
+
+    size_type i = 0;
+
+#ifdef __AVX__
+    const __m256d nulls256 = _mm256_set1_pd(null);
+    for (; i + 4 <= len; i += 4) {
+
+        unsigned mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), nulls256, _CMP_NEQ_UQ));
+
+        while (mask != 0) {
+
+            func(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+
+        }
+
+    }
+#endif
+
+#ifdef __SSE4_1__
+    const __m128d nulls128 = _mm_set1_pd(null);
+    for (; i + 2 <= len; i += 2) {
+
+        unsigned mask = _mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(values + i), nulls128));
+
+        while (mask != 0) {
+
+            func(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+
+        }
+
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (values[i] != null) {
+            func(i);
+        }
+    }
+
+}
+
+// helper method for enumerating the 1-bits in bits[first, first + len): calls func(i) for every i < len with bits[first + i] == 1
+// (ascending); fetches up to 64 bits at once with get_int and extracts the 1-bits with ctz and x & (x - 1) (tzcnt / blsr),
+// so that groups of zeros are skipped with a single test
+template<typename Func>
+void forEachSetBit(const bit_vector_type& bits, size_type first, size_type len, Func func) {
+
+    for (size_type i = 0; i < len; i += 64) {
+
+        uint64_t word = bits.get_int(first + i, std::min(len - i, (size_type) 64));
+
+        while (word != 0) {
+
+            func(i + __builtin_ctzll(word));
+            word &= word - 1;
+
+        }
+
+    }
+
+}
+
+#ifndef K2TREES_PREFETCH_DISTANCE
+#define K2TREES_PREFETCH_DISTANCE 8 // number of frontier entries the level-wise descents prefetch ahead (0 disables)
+#endif
+
+// helper method for level-wise descents: requests the word of bits holding the node K2TREES_PREFETCH_DISTANCE entries
+// ahead of frontier[i], so that its T test and rank (which reads the same word) do not stall on a cache miss
+inline void prefetchFrontier(const bit_vector_type& bits, const std::vector<SubrowInfo>& frontier, size_type i) {
+
+#if K2TREES_PREFETCH_DISTANCE > 0
+    if (i + K2TREES_PREFETCH_DISTANCE < frontier.size()) {
+        __builtin_prefetch(bits.data() + (frontier[i + K2TREES_PREFETCH_DISTANCE].z >> 6));
+    }
+#endif
+
+}
+
 // helper methods for checking whether all bits are zero
 bool isAllZero(const std::vector<bool>& v);
 bool isAllZero(const bit_vector_type& v);
@@ -152,6 +515,11 @@ bool isAllZero(const bit_vector_type& v);
 // helper method for printing contents of a rank data structure
 void printRanks(const rank_type& r);
 
+// helper methods for set operations: checks whether a pair resp. a submatrix that is (not) contained in the first
+// and (not) contained in the second relation belongs to resp. may contain pairs of the result of op
+bool isInResult(SetOperation op, bool inFirst, bool inSecond);
+bool mayBeInResult(SetOperation op, bool inFirst, bool inSecond);
+
 
 
 /* Data structures for representing a relation R = A x B & conversion methods between them */